@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file           : blog.h
+  * @brief          : Header for blog.c file.
+  *                   Binary log: format string ids and raw arguments, the
+  *                   text is produced on the host from the ELF file.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BLOG_H
+#define __BLOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define BLOG_RING_WORDS           1024U         /* power of two */
+#define BLOG_MAX_ARGS             4U
+
+/*
+ * Record, little-endian 32-bit words, always whole in a BLOG_Read chunk:
+ *   word 0: bit 31 set, bits 27:24 argument count n, bits 23:0 id
+ *   word 1: DWT cycle count when logged
+ *   word 2..n+1: arguments
+ * The id is the address of the format string in the .blog_fmt section of the
+ * ELF file, which is not loaded to the target, or one of the ids below.
+ * Tools/blog_decode.py turns a capture back into text with the ELF file.
+ */
+#define BLOG_ID_TEXT              0xFFFFFFU     /* _write output, 4 bytes per argument, NUL padded */
+#define BLOG_ID_DROP              0xFFFFFEU     /* argument: records lost since the last one */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Records;       /* records written to the ring */
+  uint32_t Dropped;       /* records lost to a full ring */
+  uint32_t Bytes;         /* bytes handed out by BLOG_Read */
+} BLOG_StatsTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+#define BLOG_HDR(id, n)   (0x80000000UL | ((uint32_t)(n) << 24) | ((uint32_t)(id) & 0xFFFFFFUL))
+
+#define BLOG_NARGS(...)                         BLOG_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define BLOG_NARGS_(z, a, b, c, d, n, ...)      n
+#define BLOG_CAT(a, b)                          BLOG_CAT_(a, b)
+#define BLOG_CAT_(a, b)                         a##b
+
+#define BLOG_LOG_0(h)             BLOG_Log((h), 0U, 0U, 0U, 0U)
+#define BLOG_LOG_1(h, a)          BLOG_Log((h), (uint32_t)(a), 0U, 0U, 0U)
+#define BLOG_LOG_2(h, a, b)       BLOG_Log((h), (uint32_t)(a), (uint32_t)(b), 0U, 0U)
+#define BLOG_LOG_3(h, a, b, c)    BLOG_Log((h), (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0U)
+#define BLOG_LOG_4(h, a, b, c, d) BLOG_Log((h), (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d))
+
+/*
+ * BLOG("fmt", args...): up to BLOG_MAX_ARGS integer or pointer arguments.
+ * Safe from any context, including interrupt handlers; a full ring drops
+ * the record and counts it.
+ */
+#define BLOG(fmt, ...) \
+  do \
+  { \
+    static const char blog_fmt[] __attribute__((section(".blog_fmt"), used)) = fmt; \
+    BLOG_CAT(BLOG_LOG_, BLOG_NARGS(__VA_ARGS__))(BLOG_HDR((uint32_t)blog_fmt, BLOG_NARGS(__VA_ARGS__)), \
+                                                ##__VA_ARGS__); \
+  } while (0)
+
+/* Exported functions prototypes ---------------------------------------------*/
+void BLOG_Log(uint32_t Hdr, uint32_t A0, uint32_t A1, uint32_t A2, uint32_t A3);
+uint32_t BLOG_Read(uint8_t *pBuf, uint32_t Size);
+void BLOG_Discard(const uint8_t *pBuf, uint32_t Len);
+void BLOG_GetStats(BLOG_StatsTypeDef *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLOG_H */
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file           : clkgov.h
+  * @brief          : Header for clkgov.c file.
+  *                   Load driven HCLK governor, PLL and 48 MHz clock untouched.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLKGOV_H
+#define __CLKGOV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define CLKGOV_LEVEL_NUM          4U            /* HCLK = SYSCLK / 1, 2, 4, 8 */
+#define CLKGOV_LEVEL_FULL         0U
+
+/* Exported types ------------------------------------------------------------*/
+/* Work waiting for the CPU, in any unit the thresholds below use */
+typedef uint32_t (*CLKGOV_LoadFuncTypeDef)(void);
+
+typedef struct
+{
+  CLKGOV_LoadFuncTypeDef LoadFunc;
+  uint32_t               UpLoad;     /* load that switches straight to full speed */
+  uint32_t               IdleMs;     /* time without load before each step down */
+  uint32_t               MinLevel;   /* slowest level allowed, CLKGOV_LEVEL_NUM - 1 at most */
+} CLKGOV_InitTypeDef;
+
+typedef struct
+{
+  uint32_t Level;            /* current level, 0 is full speed */
+  uint32_t Switches;
+  uint32_t RampUps;          /* switches to full speed */
+  uint32_t RampUpUsLast;     /* boost request or load sample to full speed reached */
+  uint32_t RampUpUsMax;
+  uint32_t LevelMs[CLKGOV_LEVEL_NUM];
+} CLKGOV_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CLKGOV_Init(const CLKGOV_InitTypeDef *pInit, uint32_t TaskId);
+void CLKGOV_Task(void *pArg);
+void CLKGOV_Boost(void);
+void CLKGOV_Resync(void);
+void CLKGOV_GetStats(CLKGOV_StatsTypeDef *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLKGOV_H */
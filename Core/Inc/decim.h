@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file           : decim.h
+  * @brief          : Header for decim.c file.
+  *                   CIC and FIR decimation of q15 samples.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DECIM_H
+#define __DECIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define DECIM_CIC_MAX_ORDER       5U
+#define DECIM_CIC_MAX_GROWTH      16U           /* bits, q15 in and 32-bit registers */
+
+/* Exported types ------------------------------------------------------------*/
+/*
+ * A CIC stage decimating by CicRate, then a FIR decimating by FirRate:
+ * the CIC takes the bulk of the rate down without a multiply, the FIR
+ * flattens its droop and sets the final anti-aliasing cut-off. Either
+ * can be left out. As with CMSIS-DSP the caller owns the coefficients,
+ * stored time reversed, and the state buffer.
+ */
+typedef struct
+{
+  uint32_t      CicOrder;      /* 1 to DECIM_CIC_MAX_ORDER integrator/comb pairs */
+  uint32_t      CicRate;       /* 1 leaves the CIC out */
+  uint32_t      FirRate;       /* 1 filters without decimating */
+  uint32_t      FirTaps;       /* 0 leaves the FIR out, FirRate must then be 1 */
+  const int16_t *pFirCoeffs;   /* q15, {b[FirTaps - 1], ..., b[0]} */
+  int16_t       *pFirState;    /* 2 * FirTaps samples */
+} DECIM_InitTypeDef;
+
+typedef struct
+{
+  DECIM_InitTypeDef Init;
+  uint32_t          CicShift;  /* bits dropped to bring the CIC gain back to 1 */
+  uint32_t          CicPhase;
+  int32_t           Integ[DECIM_CIC_MAX_ORDER];
+  int32_t           Comb[DECIM_CIC_MAX_ORDER];
+  uint32_t          FirPhase;
+  uint32_t          FirPos;
+} DECIM_InstanceTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef DECIM_Init(DECIM_InstanceTypeDef *pDec, const DECIM_InitTypeDef *pInit);
+void DECIM_Reset(DECIM_InstanceTypeDef *pDec);
+uint32_t DECIM_Process(DECIM_InstanceTypeDef *pDec, const int16_t *pSrc, uint32_t *pSrcLen,
+                       int16_t *pDst, uint32_t DstLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DECIM_H */
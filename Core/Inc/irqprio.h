@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file           : irqprio.h
+  * @brief          : Header for irqprio.c file.
+  *                   Interrupt priority map and handler latency monitor.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IRQPRIO_H
+#define __IRQPRIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+/*
+ * Preemption priorities, NVIC_PRIORITYGROUP_4: 16 levels, no sub-priority,
+ * 0 is the most urgent. A source may only sit above the USB if its handler
+ * is a few hundred cycles at most: the 512 B Rx FIFO holds 8 packets of
+ * 64 B, 4096 bits or about 340 us of back to back full speed traffic, and
+ * the USB handler has to start draining it within that.
+ */
+#define IRQPRIO_ACQ_CAPTURE       0U    /* capture/trigger timestamping only */
+#define IRQPRIO_USB               2U    /* OTG FS FIFO service */
+#define IRQPRIO_DMA_ACQ           4U    /* acquisition DMA, double buffered */
+#define IRQPRIO_DMA_COMM          6U    /* UART/SPI bridge DMA */
+#define IRQPRIO_COMM              7U    /* UART/SPI error and idle events */
+#define IRQPRIO_TIMER             8U    /* periodic timers */
+#define IRQPRIO_TICK              TICK_INT_PRIORITY
+
+#define IRQPRIO_USB_BUDGET_US     340U  /* Rx FIFO fill time at 12 Mbit/s */
+
+/*
+ * Monitored interrupts: X(source, IRQn, preemption priority, latency budget
+ * in microseconds). Add a row with each new interrupt and bracket its
+ * handler with IRQPRIO_ENTER/IRQPRIO_EXIT.
+ */
+#define IRQPRIO_TABLE(X) \
+  X(USB,      OTG_FS_IRQn,       IRQPRIO_USB,      IRQPRIO_USB_BUDGET_US) \
+  X(UART3_RX, DMA1_Stream1_IRQn, IRQPRIO_DMA_COMM, 200U) \
+  X(UART3_TX, DMA1_Stream3_IRQn, IRQPRIO_DMA_COMM, 200U) \
+  X(UART6_RX, DMA2_Stream1_IRQn, IRQPRIO_DMA_COMM, 200U) \
+  X(UART6_TX, DMA2_Stream6_IRQn, IRQPRIO_DMA_COMM, 200U) \
+  X(SPI1_RX,  DMA2_Stream0_IRQn, IRQPRIO_DMA_COMM, 100U) \
+  X(UART3,    USART3_IRQn,       IRQPRIO_COMM,     200U) \
+  X(UART6,    USART6_IRQn,       IRQPRIO_COMM,     200U) \
+  X(TICK,     SysTick_IRQn,      IRQPRIO_TICK,     1000U)
+
+/* Exported types ------------------------------------------------------------*/
+#define IRQPRIO_SRC_ENUM(src, irqn, prio, budget)  IRQPRIO_SRC_##src,
+typedef enum
+{
+  IRQPRIO_TABLE(IRQPRIO_SRC_ENUM)
+  IRQPRIO_SRC_NUM
+} IRQPRIO_SourceTypeDef;
+
+typedef struct
+{
+  uint32_t Count;
+  uint32_t SelfMax;        /* longest run without the handlers nested in it, cycles */
+  uint32_t TotalMax;       /* longest run including nested handlers, cycles */
+  uint32_t EntryMax;       /* worst measured entry latency, cycles, SysTick only */
+  uint32_t BoundUs;        /* worst-case latency bound from the other handlers */
+  uint32_t BudgetUs;
+  uint32_t OverBudget;     /* 1 if BoundUs or EntryMax exceeds BudgetUs */
+} IRQPRIO_ReportTypeDef;
+
+typedef struct
+{
+  uint32_t Entry;
+  uint32_t Nested;
+} IRQPRIO_FrameTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+#define IRQPRIO_ENTER(src)   IRQPRIO_FrameTypeDef irqprio_frame; IRQPRIO_Enter(&irqprio_frame)
+#define IRQPRIO_EXIT(src)    IRQPRIO_Exit(IRQPRIO_SRC_##src, &irqprio_frame)
+
+/* Exported functions prototypes ---------------------------------------------*/
+void IRQPRIO_Init(void);
+void IRQPRIO_Enter(IRQPRIO_FrameTypeDef *pFrame);
+void IRQPRIO_Exit(IRQPRIO_SourceTypeDef Src, const IRQPRIO_FrameTypeDef *pFrame);
+void IRQPRIO_TickEntry(void);
+HAL_StatusTypeDef IRQPRIO_GetReport(IRQPRIO_SourceTypeDef Src, IRQPRIO_ReportTypeDef *pReport);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IRQPRIO_H */
@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file           : memmon.h
+  * @brief          : Header for memmon.c file.
+  *                   Stack and heap watermarks and static memory budget.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MEMMON_H
+#define __MEMMON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define MEMMON_PAINT              0xC5C5C5C5U   /* fill of the unused stack */
+#define MEMMON_PAINT_MARGIN       256U          /* bytes below SP left alone by MEMMON_Init */
+#define MEMMON_SCAN_WORDS         2048U         /* words checked per MEMMON_Task run */
+
+#define MEMMON_MAX_MODULES        12U
+#define MEMMON_NAME_LEN           12U
+
+/* MEMMON_ReportTypeDef Flags */
+#define MEMMON_FLAG_STACK_RESERVE 0x01U         /* stack deeper than _Min_Stack_Size */
+#define MEMMON_FLAG_HEAP_RESERVE  0x02U         /* heap larger than _Min_Heap_Size */
+#define MEMMON_FLAG_COLLISION     0x04U         /* no paint left between heap and stack */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  const char *Name;
+  uint32_t   Size;              /* bytes */
+} MEMMON_ModuleTypeDef;
+
+/* Sent by CDC_VENDOR_GET_MEMORY, little endian */
+typedef struct
+{
+  char     Name[MEMMON_NAME_LEN];  /* zero padded, not always terminated */
+  uint32_t Size;
+} MEMMON_ModuleReportTypeDef;
+
+typedef struct
+{
+  uint32_t DataBss;             /* .data and .bss */
+  uint32_t HeapReserve;         /* _Min_Heap_Size */
+  uint32_t HeapMax;             /* highest _sbrk break above _end */
+  uint32_t StackReserve;        /* _Min_Stack_Size */
+  uint32_t StackMax;            /* deepest MSP use found in the paint, all contexts */
+  uint32_t ThreadMax;           /* deepest MSP seen when an interrupt preempted thread mode */
+  uint32_t IsrMax;              /* StackMax - ThreadMax, what the handlers add at most */
+  uint32_t Free;                /* paint left between the heap and the stack */
+  uint32_t Flags;               /* MEMMON_FLAG_xxx */
+  uint32_t ModuleNum;
+  MEMMON_ModuleReportTypeDef Modules[MEMMON_MAX_MODULES];
+} MEMMON_ReportTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void MEMMON_Init(const MEMMON_ModuleTypeDef *pModules, uint32_t ModuleNum);
+void MEMMON_Task(void *pArg);
+void MEMMON_IrqEntry(void);
+uint32_t MEMMON_GetReport(uint8_t *pBuf, uint32_t Len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MEMMON_H */
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file           : sched.h
+  * @brief          : Header for sched.c file.
+  *                   Priority based, run-to-completion cooperative scheduler.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SCHED_MAX_TASKS           8U            /* at most 32, one pending bit each */
+
+#define SCHED_NO_TASK             0xFFFFFFFFU   /* id of a task that was never added */
+
+#define SCHED_PERIOD_NONE         0U            /* runs on SCHED_Signal only */
+#define SCHED_PERIOD_CONTINUOUS   0xFFFFFFFFU   /* ready whenever no more urgent task is */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*SCHED_FuncTypeDef)(void *pArg);
+
+typedef struct
+{
+  const char        *Name;
+  SCHED_FuncTypeDef Func;
+  void              *pArg;
+  uint8_t           Priority;      /* 0 is the most urgent, ties run in id order */
+  uint32_t          PeriodMs;      /* SCHED_PERIOD_NONE, SCHED_PERIOD_CONTINUOUS or a period */
+  uint32_t          BudgetCycles;  /* longest expected run in CPU cycles, 0 for none */
+} SCHED_TaskInitTypeDef;
+
+typedef struct
+{
+  uint32_t Runs;
+  uint32_t Signals;        /* SCHED_Signal calls, a pending task counts once per run */
+  uint32_t Overruns;       /* runs longer than BudgetCycles */
+  uint32_t Late;           /* periodic runs started a whole period late */
+  uint32_t CyclesLast;
+  uint32_t CyclesMax;
+  uint64_t CyclesTotal;
+} SCHED_TaskStatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void SCHED_Init(void);
+HAL_StatusTypeDef SCHED_AddTask(const SCHED_TaskInitTypeDef *pInit, uint32_t *pId);
+void SCHED_Signal(uint32_t Id);
+uint32_t SCHED_RunOnce(void);
+void SCHED_Idle(void);
+HAL_StatusTypeDef SCHED_GetStats(uint32_t Id, SCHED_TaskStatsTypeDef *pStats);
+uint64_t SCHED_GetIdleCycles(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCHED_H */
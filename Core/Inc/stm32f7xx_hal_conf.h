@@ -190,6 +190,13 @@
 #define  USE_HAL_USART_REGISTER_CALLBACKS       0U /* USART register callback disabled     */
 #define  USE_HAL_WWDG_REGISTER_CALLBACKS        0U /* WWDG register callback disabled      */
 
+/* ########################## PCD Configuration ############################# */
+/**
+  * @brief Endpoints given state in the PCD handle, EP0 included: the OTG FS
+  *        core has 6 but the device only uses EP0 to EP3
+  */
+#define  PCD_MAX_EP_NUM                         4U
+
 /* ########################## Assert Selection ############################## */
 /**
   * @brief Uncomment the line below to expanse the "assert_param" macro in the
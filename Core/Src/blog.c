@@ -0,0 +1,242 @@
+/**
+  ******************************************************************************
+  * @file           : blog.c
+  * @brief          : Binary log ring.
+  *
+  *                   Producers in any context reserve whole records with one
+  *                   exclusive access on Head, fill them and publish them by
+  *                   writing the header word last. The single reader,
+  *                   BLOG_Read, stops at the first header still zero, so a
+  *                   record reserved by an interrupted producer is never
+  *                   read half written, and zeroes what it has taken.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "blog.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define BLOG_MASK                 (BLOG_RING_WORDS - 1U)
+
+#if ((BLOG_RING_WORDS & BLOG_MASK) != 0U)
+#error "BLOG_RING_WORDS must be a power of two"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t BLOG_Ring[BLOG_RING_WORDS];
+static __IO uint32_t BLOG_Head;
+static __IO uint32_t BLOG_Tail;
+
+static __IO uint32_t BLOG_Records;
+static __IO uint32_t BLOG_Dropped;
+static uint32_t BLOG_DroppedSent;
+static uint32_t BLOG_Bytes;
+
+/* Private function prototypes -----------------------------------------------*/
+static void BLOG_Count(__IO uint32_t *pCounter, uint32_t Count);
+
+/**
+  * @brief  Write one record, see BLOG.
+  * @param  Hdr header word from BLOG_HDR
+  * @param  A0 first argument
+  * @param  A1 second argument
+  * @param  A2 third argument
+  * @param  A3 fourth argument
+  * @retval None
+  */
+void BLOG_Log(uint32_t Hdr, uint32_t A0, uint32_t A1, uint32_t A2, uint32_t A3)
+{
+  uint32_t n = (Hdr >> 24) & 0xFU;
+  uint32_t words = n + 2U;
+  uint32_t head;
+
+  do
+  {
+    head = __LDREXW(&BLOG_Head);
+    if (((head + words) - BLOG_Tail) > BLOG_RING_WORDS)
+    {
+      __CLREX();
+      BLOG_Count(&BLOG_Dropped, 1U);
+      return;
+    }
+  } while (__STREXW(head + words, &BLOG_Head) != 0U);
+
+  BLOG_Ring[(head + 1U) & BLOG_MASK] = DWT->CYCCNT;
+  switch (n)
+  {
+    case 4U:
+      BLOG_Ring[(head + 5U) & BLOG_MASK] = A3;
+      /* fall through */
+    case 3U:
+      BLOG_Ring[(head + 4U) & BLOG_MASK] = A2;
+      /* fall through */
+    case 2U:
+      BLOG_Ring[(head + 3U) & BLOG_MASK] = A1;
+      /* fall through */
+    case 1U:
+      BLOG_Ring[(head + 2U) & BLOG_MASK] = A0;
+      break;
+
+    default:
+      break;
+  }
+
+  /* Body before header: the reader takes a non-zero header as complete */
+  __DMB();
+  BLOG_Ring[head & BLOG_MASK] = Hdr;
+
+  BLOG_Count(&BLOG_Records, 1U);
+}
+
+/**
+  * @brief  Take whole records out of the ring. Single reader: the log task
+  *         of the second CDC function, or the CDC_VENDOR_GET_LOG request
+  *         without one.
+  * @param  pBuf destination, word aligned
+  * @param  Size destination size in bytes, at least 4 * (BLOG_MAX_ARGS + 2)
+  * @retval bytes written to pBuf, a multiple of 4
+  */
+uint32_t BLOG_Read(uint8_t *pBuf, uint32_t Size)
+{
+  uint32_t *dst = (uint32_t *)pBuf;
+  uint32_t room = Size / 4U;
+  uint32_t tail = BLOG_Tail;
+  uint32_t dropped = BLOG_Dropped;
+  uint32_t len = 0U;
+  uint32_t hdr;
+  uint32_t words;
+  uint32_t i;
+
+  if ((dropped != BLOG_DroppedSent) && (room >= 3U))
+  {
+    dst[0] = BLOG_HDR(BLOG_ID_DROP, 1U);
+    dst[1] = DWT->CYCCNT;
+    dst[2] = dropped - BLOG_DroppedSent;
+    BLOG_DroppedSent = dropped;
+    len = 3U;
+  }
+
+  while (tail != BLOG_Head)
+  {
+    hdr = BLOG_Ring[tail & BLOG_MASK];
+    if (hdr == 0U)
+    {
+      /* Reserved but not published yet */
+      break;
+    }
+    __DMB();
+
+    words = ((hdr >> 24) & 0xFU) + 2U;
+    if ((len + words) > room)
+    {
+      break;
+    }
+
+    for (i = 0U; i < words; i++)
+    {
+      dst[len + i] = BLOG_Ring[(tail + i) & BLOG_MASK];
+      BLOG_Ring[(tail + i) & BLOG_MASK] = 0U;
+    }
+    len += words;
+    tail += words;
+  }
+
+  /* Zeroes before the space is handed back to the producers */
+  __DMB();
+  BLOG_Tail = tail;
+  BLOG_Bytes += len * 4U;
+
+  return len * 4U;
+}
+
+/**
+  * @brief  A chunk from BLOG_Read never reached the host: count its records
+  *         as dropped, so the next drop record reports them.
+  * @param  pBuf chunk as BLOG_Read wrote it
+  * @param  Len its length in bytes
+  * @retval None
+  */
+void BLOG_Discard(const uint8_t *pBuf, uint32_t Len)
+{
+  const uint32_t *src = (const uint32_t *)pBuf;
+  uint32_t words = Len / 4U;
+  uint32_t lost = 0U;
+  uint32_t pos = 0U;
+
+  while (pos < words)
+  {
+    /* A drop record stands for the records it counts */
+    if (((src[pos] & 0xFFFFFFU) == BLOG_ID_DROP) && ((pos + 2U) < words))
+    {
+      lost += src[pos + 2U];
+    }
+    else
+    {
+      lost++;
+    }
+    pos += ((src[pos] >> 24) & 0xFU) + 2U;
+  }
+
+  BLOG_Count(&BLOG_Dropped, lost);
+}
+
+/**
+  * @brief  Copy the log accounting.
+  * @param  pStats destination
+  * @retval None
+  */
+void BLOG_GetStats(BLOG_StatsTypeDef *pStats)
+{
+  pStats->Records = BLOG_Records;
+  pStats->Dropped = BLOG_Dropped;
+  pStats->Bytes = BLOG_Bytes;
+}
+
+/**
+  * @brief  printf and friends end up here: the text goes to the log as
+  *         BLOG_ID_TEXT records instead of nowhere.
+  * @param  file unused
+  * @param  ptr text
+  * @param  len text length
+  * @retval len
+  */
+int _write(int file, char *ptr, int len)
+{
+  uint32_t w[BLOG_MAX_ARGS];
+  uint32_t done = 0U;
+  uint32_t chunk;
+
+  UNUSED(file);
+
+  while (done < (uint32_t)len)
+  {
+    chunk = (uint32_t)len - done;
+    if (chunk > sizeof(w))
+    {
+      chunk = sizeof(w);
+    }
+    (void)memset(w, 0, sizeof(w));
+    (void)memcpy(w, &ptr[done], chunk);
+    BLOG_Log(BLOG_HDR(BLOG_ID_TEXT, (chunk + 3U) / 4U), w[0], w[1], w[2], w[3]);
+    done += chunk;
+  }
+
+  return len;
+}
+
+/**
+  * @brief  Add to a counter shared with interrupt handlers.
+  * @param  pCounter counter
+  * @param  Count amount added
+  * @retval None
+  */
+static void BLOG_Count(__IO uint32_t *pCounter, uint32_t Count)
+{
+  uint32_t v;
+
+  do
+  {
+    v = __LDREXW(pCounter);
+  } while (__STREXW(v + Count, pCounter) != 0U);
+}
@@ -0,0 +1,221 @@
+/**
+  ******************************************************************************
+  * @file           : clkgov.c
+  * @brief          : Load driven HCLK governor.
+  *
+  *                   Only the AHB prescaler moves: the PLL keeps running at
+  *                   432 MHz VCO, so SYSCLK stays 216 MHz and the PLLQ 48 MHz
+  *                   USB clock is never disturbed. HCLK steps down one level
+  *                   after IdleMs without load and jumps straight back to
+  *                   216 MHz when the load reaches UpLoad or CLKGOV_Boost is
+  *                   called. Every level keeps HCLK above the 14.2 MHz the
+  *                   OTG FS core needs; the APB prescalers are left alone, so
+  *                   the APB clocks scale with HCLK.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "clkgov.h"
+#include "sched.h"
+#include "blog.h"
+#include <string.h>
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Hpre;            /* RCC_CFGR HPRE field */
+  uint32_t FlashLatency;    /* wait states for this HCLK, voltage scale 1 */
+} CLKGOV_LevelTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const CLKGOV_LevelTypeDef CLKGOV_Levels[CLKGOV_LEVEL_NUM] =
+{
+  { RCC_SYSCLK_DIV1, FLASH_LATENCY_7 },     /* 216 MHz */
+  { RCC_SYSCLK_DIV2, FLASH_LATENCY_3 },     /* 108 MHz */
+  { RCC_SYSCLK_DIV4, FLASH_LATENCY_1 },     /*  54 MHz */
+  { RCC_SYSCLK_DIV8, FLASH_LATENCY_0 },     /*  27 MHz */
+};
+
+static CLKGOV_InitTypeDef CLKGOV_Config;
+static uint32_t CLKGOV_TaskId = SCHED_NO_TASK;
+static CLKGOV_StatsTypeDef CLKGOV_Stats;
+static uint32_t CLKGOV_IdleMs;
+static uint32_t CLKGOV_LastTick;
+
+/* Set by CLKGOV_Boost from any context */
+static __IO uint8_t CLKGOV_BoostPending;
+static __IO uint32_t CLKGOV_BoostStart;
+
+/* Private function prototypes -----------------------------------------------*/
+static void CLKGOV_SetLevel(uint32_t level, uint32_t start);
+
+/**
+  * @brief  Start the governor at full speed. SystemClock_Config must have set
+  *         up the PLL for 216 MHz.
+  * @param  pInit settings, copied
+  * @param  TaskId scheduler task running CLKGOV_Task, signalled by CLKGOV_Boost
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CLKGOV_Init(const CLKGOV_InitTypeDef *pInit, uint32_t TaskId)
+{
+  if ((pInit == NULL) || (pInit->LoadFunc == NULL) || (pInit->MinLevel >= CLKGOV_LEVEL_NUM))
+  {
+    return HAL_ERROR;
+  }
+
+  CLKGOV_Config = *pInit;
+  CLKGOV_TaskId = TaskId;
+  (void)memset(&CLKGOV_Stats, 0, sizeof(CLKGOV_Stats));
+  CLKGOV_IdleMs = 0U;
+  CLKGOV_BoostPending = 0U;
+  CLKGOV_LastTick = HAL_GetTick();
+
+  CLKGOV_SetLevel(CLKGOV_LEVEL_FULL, DWT->CYCCNT);
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Governor task, periodic and signalled by CLKGOV_Boost.
+  * @param  pArg unused
+  * @retval None
+  */
+void CLKGOV_Task(void *pArg)
+{
+  uint32_t tick = HAL_GetTick();
+  uint32_t elapsed = tick - CLKGOV_LastTick;
+  uint32_t level = CLKGOV_Stats.Level;
+  uint32_t start = DWT->CYCCNT;
+  uint32_t load;
+
+  UNUSED(pArg);
+
+  CLKGOV_LastTick = tick;
+  CLKGOV_Stats.LevelMs[level] += elapsed;
+
+  if (CLKGOV_BoostPending != 0U)
+  {
+    start = CLKGOV_BoostStart;
+    CLKGOV_BoostPending = 0U;
+    CLKGOV_IdleMs = 0U;
+    CLKGOV_SetLevel(CLKGOV_LEVEL_FULL, start);
+    return;
+  }
+
+  load = CLKGOV_Config.LoadFunc();
+
+  if (load >= CLKGOV_Config.UpLoad)
+  {
+    CLKGOV_IdleMs = 0U;
+    CLKGOV_SetLevel(CLKGOV_LEVEL_FULL, start);
+  }
+  else if (load != 0U)
+  {
+    /* Some work: hold the current speed */
+    CLKGOV_IdleMs = 0U;
+  }
+  else
+  {
+    CLKGOV_IdleMs += elapsed;
+    if ((CLKGOV_IdleMs >= CLKGOV_Config.IdleMs) && (level < CLKGOV_Config.MinLevel))
+    {
+      CLKGOV_IdleMs = 0U;
+      CLKGOV_SetLevel(level + 1U, start);
+    }
+  }
+}
+
+/**
+  * @brief  Ask for full speed as soon as possible, e.g. when data arrives.
+  *         Safe from interrupt handlers.
+  * @retval None
+  */
+void CLKGOV_Boost(void)
+{
+  if ((CLKGOV_Stats.Level == CLKGOV_LEVEL_FULL) || (CLKGOV_BoostPending != 0U))
+  {
+    return;
+  }
+
+  CLKGOV_BoostStart = DWT->CYCCNT;
+  CLKGOV_BoostPending = 1U;
+  SCHED_Signal(CLKGOV_TaskId);
+}
+
+/**
+  * @brief  The clocks were set up again behind the governor, by
+  *         SystemClock_Config on a wakeup from STOP: HCLK runs at full
+  *         speed whatever level was recorded. The task records the switch
+  *         and restarts the idle count from there. Safe from interrupt
+  *         handlers.
+  * @retval None
+  */
+void CLKGOV_Resync(void)
+{
+  CLKGOV_Boost();
+}
+
+/**
+  * @brief  Copy the governor accounting. Call from thread context.
+  * @param  pStats destination
+  * @retval None
+  */
+void CLKGOV_GetStats(CLKGOV_StatsTypeDef *pStats)
+{
+  *pStats = CLKGOV_Stats;
+}
+
+/**
+  * @brief  Switch HCLK, ordering the FLASH wait states around the change.
+  * @param  level new level
+  * @param  start DWT cycle count when the need for the switch was seen
+  * @retval None
+  */
+static void CLKGOV_SetLevel(uint32_t level, uint32_t start)
+{
+  const CLKGOV_LevelTypeDef *to = &CLKGOV_Levels[level];
+  uint32_t mhz = SystemCoreClock / 1000000U;
+  uint32_t us;
+
+  if ((level == CLKGOV_Stats.Level) && (READ_BIT(RCC->CFGR, RCC_CFGR_HPRE) == to->Hpre))
+  {
+    return;
+  }
+
+  if (to->FlashLatency > __HAL_FLASH_GET_LATENCY())
+  {
+    /* Faster: more wait states first */
+    __HAL_FLASH_SET_LATENCY(to->FlashLatency);
+    while (__HAL_FLASH_GET_LATENCY() != to->FlashLatency)
+    {
+    }
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE, to->Hpre);
+  }
+  else
+  {
+    /* Slower: clock down first, then drop the wait states */
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE, to->Hpre);
+    __HAL_FLASH_SET_LATENCY(to->FlashLatency);
+    while (__HAL_FLASH_GET_LATENCY() != to->FlashLatency)
+    {
+    }
+  }
+
+  SystemCoreClock = HAL_RCC_GetSysClockFreq() >> AHBPrescTable[to->Hpre >> RCC_CFGR_HPRE_Pos];
+  (void)HAL_InitTick(uwTickPrio);
+
+  BLOG("clkgov: level %u -> %u, HCLK %u Hz", CLKGOV_Stats.Level, level, SystemCoreClock);
+  CLKGOV_Stats.Switches++;
+  if ((level == CLKGOV_LEVEL_FULL) && (CLKGOV_Stats.Level != CLKGOV_LEVEL_FULL))
+  {
+    /* Counted at the old, slower HCLK where nearly all of it was spent */
+    us = (DWT->CYCCNT - start) / ((mhz != 0U) ? mhz : 1U);
+    CLKGOV_Stats.RampUps++;
+    CLKGOV_Stats.RampUpUsLast = us;
+    if (us > CLKGOV_Stats.RampUpUsMax)
+    {
+      CLKGOV_Stats.RampUpUsMax = us;
+    }
+  }
+  CLKGOV_Stats.Level = level;
+}
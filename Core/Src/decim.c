@@ -0,0 +1,209 @@
+/**
+  ******************************************************************************
+  * @file           : decim.c
+  * @brief          : CIC and FIR decimation of q15 samples.
+  *
+  *                   Runs between the acquisition buffers and a CDC stream
+  *                   so a sample rate above what the IN endpoint carries is
+  *                   filtered down on the device instead of in analog.
+  *
+  *                   The CIC only adds and subtracts in 32-bit registers
+  *                   whose wrap-around cancels out in the combs, so the
+  *                   bit growth Order * log2(Rate) must stay within
+  *                   DECIM_CIC_MAX_GROWTH. The FIR keeps its delay line
+  *                   twice over so the last FirTaps samples are always
+  *                   contiguous, and computes only the outputs it keeps:
+  *                   one dot product per FirRate inputs, two taps per
+  *                   SMLALD into a 64-bit accumulator.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "decim.h"
+#include <string.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static int16_t DECIM_Fir(const DECIM_InstanceTypeDef *pDec);
+
+/**
+  * @brief  Check a configuration and start from silence
+  * @param  pDec instance
+  * @param  pInit configuration, copied; its buffers stay the caller's
+  * @retval HAL_ERROR for a configuration the stage cannot run
+  */
+HAL_StatusTypeDef DECIM_Init(DECIM_InstanceTypeDef *pDec, const DECIM_InitTypeDef *pInit)
+{
+  uint64_t gain = 1U;
+  uint32_t shift = 0U;
+  uint32_t i;
+
+  if ((pDec == NULL) || (pInit == NULL) || (pInit->CicRate == 0U) || (pInit->FirRate == 0U))
+  {
+    return HAL_ERROR;
+  }
+
+  if (pInit->CicRate > 1U)
+  {
+    if ((pInit->CicOrder == 0U) || (pInit->CicOrder > DECIM_CIC_MAX_ORDER))
+    {
+      return HAL_ERROR;
+    }
+    /* Gain Rate^Order, brought back by the next power of two up. Past
+       2^DECIM_CIC_MAX_GROWTH it is refused anyway, stop there before the
+       product wraps */
+    for (i = 0U; (i < pInit->CicOrder) && (gain <= ((uint64_t)1U << DECIM_CIC_MAX_GROWTH)); i++)
+    {
+      gain *= pInit->CicRate;
+    }
+    while ((shift <= DECIM_CIC_MAX_GROWTH) && (((uint64_t)1U << shift) < gain))
+    {
+      shift++;
+    }
+    if (shift > DECIM_CIC_MAX_GROWTH)
+    {
+      return HAL_ERROR;
+    }
+  }
+
+  if (pInit->FirTaps == 0U)
+  {
+    if (pInit->FirRate != 1U)
+    {
+      return HAL_ERROR;
+    }
+  }
+  else if ((pInit->pFirCoeffs == NULL) || (pInit->pFirState == NULL))
+  {
+    return HAL_ERROR;
+  }
+
+  pDec->Init = *pInit;
+  pDec->CicShift = shift;
+  DECIM_Reset(pDec);
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Clear the filter state, for a new acquisition
+  * @param  pDec instance
+  * @retval None
+  */
+void DECIM_Reset(DECIM_InstanceTypeDef *pDec)
+{
+  (void)memset(pDec->Integ, 0, sizeof(pDec->Integ));
+  (void)memset(pDec->Comb, 0, sizeof(pDec->Comb));
+  pDec->CicPhase = 0U;
+  pDec->FirPhase = 0U;
+  pDec->FirPos = 0U;
+  if (pDec->Init.FirTaps != 0U)
+  {
+    (void)memset(pDec->Init.pFirState, 0, 2U * pDec->Init.FirTaps * sizeof(int16_t));
+  }
+}
+
+/**
+  * @brief  Decimate a block. Stops once DstLen samples are out, so a full
+  *         destination leaves the rest of the input for the next call.
+  * @param  pDec instance
+  * @param  pSrc input samples
+  * @param  pSrcLen in: input samples, out: samples consumed
+  * @param  pDst output samples, NULL runs the filters and drops the output
+  *         so the state stays continuous across a gap downstream
+  * @param  DstLen room in pDst, ignored without pDst
+  * @retval samples written to pDst, or dropped without it
+  */
+uint32_t DECIM_Process(DECIM_InstanceTypeDef *pDec, const int16_t *pSrc, uint32_t *pSrcLen,
+                       int16_t *pDst, uint32_t DstLen)
+{
+  const uint32_t order = pDec->Init.CicOrder;
+  const uint32_t taps = pDec->Init.FirTaps;
+  uint32_t in = 0U;
+  uint32_t out = 0U;
+  int32_t acc;
+  int32_t prev;
+  uint32_t k;
+
+  while ((in < *pSrcLen) && ((pDst == NULL) || (out < DstLen)))
+  {
+    acc = pSrc[in];
+    in++;
+
+    if (pDec->Init.CicRate > 1U)
+    {
+      /* Integrators at the input rate, wrapping freely */
+      pDec->Integ[0] = (int32_t)((uint32_t)pDec->Integ[0] + (uint32_t)acc);
+      for (k = 1U; k < order; k++)
+      {
+        pDec->Integ[k] = (int32_t)((uint32_t)pDec->Integ[k] + (uint32_t)pDec->Integ[k - 1U]);
+      }
+      if (++pDec->CicPhase < pDec->Init.CicRate)
+      {
+        continue;
+      }
+      pDec->CicPhase = 0U;
+
+      /* Combs at the output rate undo the wrap */
+      acc = pDec->Integ[order - 1U];
+      for (k = 0U; k < order; k++)
+      {
+        prev = pDec->Comb[k];
+        pDec->Comb[k] = acc;
+        acc = (int32_t)((uint32_t)acc - (uint32_t)prev);
+      }
+      acc = __SSAT(acc >> pDec->CicShift, 16);
+    }
+
+    if (taps != 0U)
+    {
+      pDec->Init.pFirState[pDec->FirPos] = (int16_t)acc;
+      pDec->Init.pFirState[pDec->FirPos + taps] = (int16_t)acc;
+      if (++pDec->FirPos == taps)
+      {
+        pDec->FirPos = 0U;
+      }
+      if (++pDec->FirPhase < pDec->Init.FirRate)
+      {
+        continue;
+      }
+      pDec->FirPhase = 0U;
+      acc = DECIM_Fir(pDec);
+    }
+
+    if (pDst != NULL)
+    {
+      pDst[out] = (int16_t)acc;
+    }
+    out++;
+  }
+
+  *pSrcLen = in;
+
+  return out;
+}
+
+/**
+  * @brief  One FIR output over the last FirTaps samples
+  * @param  pDec instance
+  * @retval q15 output, saturated
+  */
+static int16_t DECIM_Fir(const DECIM_InstanceTypeDef *pDec)
+{
+  const int16_t *x = &pDec->Init.pFirState[pDec->FirPos];   /* oldest first */
+  const int16_t *b = pDec->Init.pFirCoeffs;
+  const uint32_t taps = pDec->Init.FirTaps;
+  uint64_t acc = 0U;
+  uint32_t i;
+
+  /* Two taps per SMLALD, both halves signed 16 x 16 */
+  for (i = 0U; (i + 1U) < taps; i += 2U)
+  {
+    acc = __SMLALD(__UNALIGNED_UINT32_READ(&x[i]), __UNALIGNED_UINT32_READ(&b[i]), acc);
+  }
+  if (i < taps)
+  {
+    acc = (uint64_t)((int64_t)acc + ((int32_t)x[i] * (int32_t)b[i]));
+  }
+
+  return (int16_t)__SSAT((int32_t)((int64_t)acc >> 15), 16);
+}
@@ -0,0 +1,182 @@
+/**
+  ******************************************************************************
+  * @file           : irqprio.c
+  * @brief          : Interrupt priority map and handler latency monitor.
+  *
+  *                   IRQPRIO_Init applies IRQPRIO_TABLE. Handlers bracketed
+  *                   with IRQPRIO_ENTER/IRQPRIO_EXIT have their run time
+  *                   measured with the DWT cycle counter, split into their
+  *                   own time and the time of the handlers that preempted
+  *                   them. The worst-case entry latency of a source is then
+  *                   bounded by one run of every more urgent handler plus
+  *                   the longest handler of its own level it may have to
+  *                   wait for; the SysTick entry latency is also measured
+  *                   directly from the SysTick counter.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "irqprio.h"
+#include "memmon.h"
+#include <string.h>
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  IRQn_Type Irqn;
+  uint32_t  Prio;
+  uint32_t  BudgetUs;
+} IRQPRIO_MapTypeDef;
+
+typedef struct
+{
+  uint32_t Count;
+  uint32_t SelfMax;
+  uint32_t TotalMax;
+  uint32_t EntryMax;
+} IRQPRIO_StatsTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+#define IRQPRIO_MAP_ROW(src, irqn, prio, budget)  { (irqn), (prio), (budget) },
+static const IRQPRIO_MapTypeDef IRQPRIO_Map[IRQPRIO_SRC_NUM] =
+{
+  IRQPRIO_TABLE(IRQPRIO_MAP_ROW)
+};
+
+static IRQPRIO_StatsTypeDef IRQPRIO_Stats[IRQPRIO_SRC_NUM];
+
+/* Own run time of every handler that has finished, for the nesting split */
+static __IO uint32_t IRQPRIO_SelfTotal;
+
+/**
+  * @brief  Apply the priority map and clear the measurements. Call after
+  *         HAL_Init, before the interrupts of the table are enabled.
+  * @retval None
+  */
+void IRQPRIO_Init(void)
+{
+  uint32_t i;
+
+  HAL_NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+  for (i = 0U; i < (uint32_t)IRQPRIO_SRC_NUM; i++)
+  {
+    HAL_NVIC_SetPriority(IRQPRIO_Map[i].Irqn, IRQPRIO_Map[i].Prio, 0U);
+  }
+
+  (void)memset(IRQPRIO_Stats, 0, sizeof(IRQPRIO_Stats));
+}
+
+/**
+  * @brief  Start of a monitored handler, see IRQPRIO_ENTER.
+  * @param  pFrame state kept on the handler's stack
+  * @retval None
+  */
+void IRQPRIO_Enter(IRQPRIO_FrameTypeDef *pFrame)
+{
+  pFrame->Entry = DWT->CYCCNT;
+  pFrame->Nested = IRQPRIO_SelfTotal;
+
+  MEMMON_IrqEntry();
+}
+
+/**
+  * @brief  End of a monitored handler, see IRQPRIO_EXIT.
+  * @param  Src source
+  * @param  pFrame state saved by IRQPRIO_Enter
+  * @retval None
+  */
+void IRQPRIO_Exit(IRQPRIO_SourceTypeDef Src, const IRQPRIO_FrameTypeDef *pFrame)
+{
+  IRQPRIO_StatsTypeDef *stats = &IRQPRIO_Stats[Src];
+  uint32_t total;
+  uint32_t self;
+  uint32_t sum;
+
+  /* Only more urgent handlers can nest here, and they leave SelfTotal
+     updated before we resume, so each exchange below is uncontended */
+  do
+  {
+    sum = __LDREXW(&IRQPRIO_SelfTotal);
+    total = DWT->CYCCNT - pFrame->Entry;
+    self = total - (sum - pFrame->Nested);
+  } while (__STREXW(sum + self, &IRQPRIO_SelfTotal) != 0U);
+
+  stats->Count++;
+  if (self > stats->SelfMax)
+  {
+    stats->SelfMax = self;
+  }
+  if (total > stats->TotalMax)
+  {
+    stats->TotalMax = total;
+  }
+}
+
+/**
+  * @brief  Measure the SysTick entry latency, first thing in SysTick_Handler:
+  *         the counter has been running down from LOAD since the tick was due.
+  * @retval None
+  */
+void IRQPRIO_TickEntry(void)
+{
+  uint32_t late = SysTick->LOAD - SysTick->VAL;
+
+  if (late > IRQPRIO_Stats[IRQPRIO_SRC_TICK].EntryMax)
+  {
+    IRQPRIO_Stats[IRQPRIO_SRC_TICK].EntryMax = late;
+  }
+}
+
+/**
+  * @brief  Measurements of one source and its latency bound. Call from
+  *         thread context; the bound uses the current HCLK.
+  * @param  Src source
+  * @param  pReport destination
+  * @retval HAL status
+  */
+HAL_StatusTypeDef IRQPRIO_GetReport(IRQPRIO_SourceTypeDef Src, IRQPRIO_ReportTypeDef *pReport)
+{
+  uint32_t prio;
+  uint32_t higher = 0U;
+  uint32_t same = 0U;
+  uint32_t mhz = SystemCoreClock / 1000000U;
+  uint32_t i;
+
+  if ((Src >= IRQPRIO_SRC_NUM) || (pReport == NULL))
+  {
+    return HAL_ERROR;
+  }
+
+  prio = IRQPRIO_Map[Src].Prio;
+  for (i = 0U; i < (uint32_t)IRQPRIO_SRC_NUM; i++)
+  {
+    if (IRQPRIO_Map[i].Prio < prio)
+    {
+      higher += IRQPRIO_Stats[i].SelfMax;
+    }
+    else if ((IRQPRIO_Map[i].Prio == prio) && (i != (uint32_t)Src) &&
+             (IRQPRIO_Stats[i].SelfMax > same))
+    {
+      same = IRQPRIO_Stats[i].SelfMax;
+    }
+    else
+    {
+      /* Less urgent handlers are preempted at once */
+    }
+  }
+
+  pReport->Count = IRQPRIO_Stats[Src].Count;
+  pReport->SelfMax = IRQPRIO_Stats[Src].SelfMax;
+  pReport->TotalMax = IRQPRIO_Stats[Src].TotalMax;
+  pReport->EntryMax = IRQPRIO_Stats[Src].EntryMax;
+  if (mhz == 0U)
+  {
+    mhz = 1U;
+  }
+  pReport->BoundUs = (higher + same) / mhz;
+  pReport->BudgetUs = IRQPRIO_Map[Src].BudgetUs;
+  pReport->OverBudget = ((pReport->BoundUs > pReport->BudgetUs) ||
+                         ((pReport->EntryMax / mhz) > pReport->BudgetUs)) ? 1U : 0U;
+
+  return HAL_OK;
+}
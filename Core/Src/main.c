@@ -22,6 +22,16 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "usbd_core.h"
+#include "usbd_cdc_if.h"
+#include "usbd_cdc_stream.h"
+#include "sched.h"
+#include "clkgov.h"
+#include "irqprio.h"
+#include "blog.h"
+#include "memmon.h"
+#include "usbd_cdc_uart.h"
+#include "usbd_cdc_spi.h"
 
 /* USER CODE END Includes */
 
@@ -32,6 +42,16 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+/* 1: the CDC functions bridge USART3 (and USART6) instead of echoing and logging */
+#define APP_UART_BRIDGE           0U
+/* 1: the first CDC function runs SPI1 transaction lists instead of echoing */
+#define APP_SPI_BRIDGE            0U
+/* 1: the first CDC function carries decimated acquisition instead of echoing */
+#define APP_ACQ_DECIM             0U
+
+#if ((APP_UART_BRIDGE + APP_SPI_BRIDGE + APP_ACQ_DECIM) > 1U)
+#error "APP_UART_BRIDGE, APP_SPI_BRIDGE and APP_ACQ_DECIM all want the first CDC function"
+#endif
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -42,6 +62,100 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+#if (USBD_POLLING_MODE == 1U)
+static void USB_PollTask(void *pArg);
+
+static const SCHED_TaskInitTypeDef UsbPollTaskInit =
+{
+  "usb_poll", USB_PollTask, NULL, 255U, SCHED_PERIOD_CONTINUOUS, 0U
+};
+#endif /* USBD_POLLING_MODE */
+
+/* Owns the CDC IN endpoint, drains the streams of the producer tasks */
+static const SCHED_TaskInitTypeDef CdcStreamTaskInit =
+{
+  "usb_tx", CDC_Stream_Task, NULL, 0U, SCHED_PERIOD_NONE, 5000U
+};
+
+/* Wakes a suspended host for urgent streams, times the resume signalling */
+static const SCHED_TaskInitTypeDef CdcWakeTaskInit =
+{
+  "usb_wake", CDC_Stream_WakeTask, NULL, 0U, 1U, 2000U
+};
+
+/* Lowers HCLK while the USB data path is idle */
+static uint32_t App_UsbLoad(void);
+
+static const SCHED_TaskInitTypeDef ClkGovTaskInit =
+{
+  "clk_gov", CLKGOV_Task, NULL, 0U, 1U, 2000U
+};
+
+static const CLKGOV_InitTypeDef ClkGovInit =
+{
+  App_UsbLoad, 2U * CDC_DATA_FS_MAX_PACKET_SIZE, 20U, CLKGOV_LEVEL_NUM - 1U
+};
+
+#if (USBD_CDC_FUNC_NUM > 1U) && (APP_UART_BRIDGE == 0U)
+/* Drains the binary log over the second function, after everything else */
+static const SCHED_TaskInitTypeDef CdcLogTaskInit =
+{
+  "cdc_log", CDC_LogTask_FS, NULL, 254U, 10U, 20000U
+};
+#endif /* USBD_CDC_FUNC_NUM */
+
+#if (APP_SPI_BRIDGE == 1U)
+/* Starts transaction lists and returns their results, the period retries a result */
+static const SCHED_TaskInitTypeDef CdcSpiTaskInit =
+{
+  "spi_br", CDC_Spi_Task, NULL, 1U, 1U, 20000U
+};
+#elif (APP_ACQ_DECIM == 1U)
+/* Decimates the capture blocks into the acquisition stream */
+static const SCHED_TaskInitTypeDef CdcAcqTaskInit =
+{
+  "cdc_acq", CDC_AcqTask_FS, NULL, 1U, SCHED_PERIOD_NONE, 20000U
+};
+#elif (APP_UART_BRIDGE == 0U)
+static const SCHED_TaskInitTypeDef CdcTaskInit =
+{
+  "cdc_echo", CDC_Task_FS, NULL, 1U, SCHED_PERIOD_NONE, 20000U
+};
+#else
+/* Moves the CDC data to and from the USARTs, the period applies line coding */
+static const SCHED_TaskInitTypeDef CdcUartTaskInit =
+{
+  "uart_br", CDC_Uart_Task, NULL, 1U, 1U, 20000U
+};
+#endif /* APP_UART_BRIDGE */
+
+/* Finds the stack watermark in the background */
+static const SCHED_TaskInitTypeDef MemMonTaskInit =
+{
+  "mem_mon", MEMMON_Task, NULL, 253U, 10U, 20000U
+};
+
+/* Static allocations reported by CDC_VENDOR_GET_MEMORY, class handles are on the heap */
+static const MEMMON_ModuleTypeDef MemMonModules[] =
+{
+  { "usb_rx",      APP_RX_DATA_SIZE },
+  { "usb_tx",      APP_TX_DATA_SIZE },
+#if (USBD_CDC_FUNC_NUM > 1U)
+  { "usb_rx2",     APP_RX_DATA_SIZE },
+#endif /* USBD_CDC_FUNC_NUM */
+  { "cdc_class",   sizeof(USBD_CDC_HandleTypeDef) * USBD_CDC_FUNC_NUM },
+  { "dev_desc",    USB_LEN_DEV_DESC },
+  { "cfg_desc",    USB_CDC_CONFIG_DESC_SIZ },
+  { "str_desc",    USBD_MAX_STR_DESC_SIZ },
+  { "usbd_handle", sizeof(USBD_HandleTypeDef) },
+  { "pcd_handle",  sizeof(PCD_HandleTypeDef) },
+  { "blog_ring",   BLOG_RING_WORDS * 4U },
+  { "usb_acq",     CDC_ACQ_STREAM_SIZE + (2U * CDC_ACQ_FIR_TAPS * sizeof(int16_t)) },
+  { "spi_bridge",  (CDC_SPI_LIST_BUF_NUM * CDC_SPI_LIST_SIZE) + sizeof(CDC_Spi_ResultTypeDef) + CDC_SPI_RESULT_SIZE },
+  { "uart_bridge", CDC_UART_PORT_NUM * (CDC_UART_RX_RING_SIZE + (CDC_UART_OUT_BUF_NUM * CDC_UART_OUT_BUF_SIZE)) },
+};
 
 /* USER CODE END PV */
 
@@ -49,11 +163,31 @@
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 /* USER CODE BEGIN PFP */
+static void App_CycleCounterInit(void);
 
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+/**
+  * @brief  USB data path load for the clock governor: bytes moved since the
+  *         last call plus bytes still waiting in the streams.
+  * @retval load in bytes
+  */
+static uint32_t App_UsbLoad(void)
+{
+  static uint32_t last_bytes;
+  USBD_CDC_StatsTypeDef stats;
+  uint32_t bytes;
+  uint32_t load;
+
+  USBD_CDC_GetStats(&stats);
+  bytes = stats.In.Bytes + stats.Out.Bytes;
+  load = (bytes - last_bytes) + CDC_Stream_Pending();
+  last_bytes = bytes;
+
+  return load;
+}
 
 /* USER CODE END 0 */
 
@@ -64,6 +198,7 @@ static void MX_GPIO_Init(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
+  MEMMON_Init(MemMonModules, sizeof(MemMonModules) / sizeof(MemMonModules[0]));
 
   /* USER CODE END 1 */
 
@@ -73,6 +208,8 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
+  App_CycleCounterInit();
+  IRQPRIO_Init();
 
   /* USER CODE END Init */
 
@@ -87,6 +224,65 @@ int main(void)
   MX_GPIO_Init();
   MX_USB_DEVICE_Init();
   /* USER CODE BEGIN 2 */
+  uint32_t task_id;
+
+  SCHED_Init();
+#if (USBD_POLLING_MODE == 1U)
+  if (SCHED_AddTask(&UsbPollTaskInit, &task_id) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif /* USBD_POLLING_MODE */
+  if (SCHED_AddTask(&CdcStreamTaskInit, &task_id) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  CDC_Stream_SetTask(task_id);
+  if (SCHED_AddTask(&CdcWakeTaskInit, &task_id) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#if (APP_SPI_BRIDGE == 1U)
+  if ((SCHED_AddTask(&CdcSpiTaskInit, &task_id) != HAL_OK) ||
+      (CDC_Spi_Init(task_id) != HAL_OK))
+  {
+    Error_Handler();
+  }
+#elif (APP_ACQ_DECIM == 1U)
+  if ((SCHED_AddTask(&CdcAcqTaskInit, &task_id) != HAL_OK) ||
+      (CDC_SetAcqTask_FS(task_id) != HAL_OK))
+  {
+    Error_Handler();
+  }
+#elif (APP_UART_BRIDGE == 1U)
+  if ((SCHED_AddTask(&CdcUartTaskInit, &task_id) != HAL_OK) ||
+      (CDC_Uart_Init(task_id) != HAL_OK))
+  {
+    Error_Handler();
+  }
+#else
+  if (SCHED_AddTask(&CdcTaskInit, &task_id) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  CDC_SetTask_FS(task_id);
+#endif /* APP_UART_BRIDGE */
+  if ((SCHED_AddTask(&ClkGovTaskInit, &task_id) != HAL_OK) ||
+      (CLKGOV_Init(&ClkGovInit, task_id) != HAL_OK))
+  {
+    Error_Handler();
+  }
+#if (USBD_CDC_FUNC_NUM > 1U) && (APP_UART_BRIDGE == 0U)
+  if (SCHED_AddTask(&CdcLogTaskInit, &task_id) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  CDC_SetLogTask_FS(task_id);
+#endif /* USBD_CDC_FUNC_NUM */
+  if (SCHED_AddTask(&MemMonTaskInit, &task_id) != HAL_OK)
+  {
+    Error_Handler();
+  }
 
   /* USER CODE END 2 */
 
@@ -97,6 +293,11 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
+    if (SCHED_RunOnce() == 0U)
+    {
+      /* Nothing ready: sleep until the next interrupt, at worst the tick */
+      SCHED_Idle();
+    }
   }
   /* USER CODE END 3 */
 }
@@ -169,6 +370,33 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief  Start the DWT cycle counter, once for every module timing with
+  *         it: scheduler budgets, interrupt monitor, log timestamps, clock
+  *         governor, stream wakeups and the CDC dispatch profile.
+  * @retval None
+  */
+static void App_CycleCounterInit(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#if (USBD_POLLING_MODE == 1U)
+/**
+  * @brief  Drain the USB events in batches. Always ready at the lowest
+  *         urgency, it takes whatever time the other tasks leave: the OTG
+  *         interrupt is not used in polling mode.
+  * @param  pArg unused
+  * @retval None
+  */
+static void USB_PollTask(void *pArg)
+{
+  UNUSED(pArg);
+  (void)USBD_LL_Poll(&hUsbDeviceFS, USBD_POLL_MAX_PASSES);
+}
+#endif /* USBD_POLLING_MODE */
 
 /* USER CODE END 4 */
 
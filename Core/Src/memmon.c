@@ -0,0 +1,198 @@
+/**
+  ******************************************************************************
+  * @file           : memmon.c
+  * @brief          : Stack and heap watermarks and static memory budget.
+  *
+  *                   MEMMON_Init paints the RAM between the heap break and
+  *                   the stack pointer. Thread mode and every handler share
+  *                   the MSP, so the lowest overwritten word gives the stack
+  *                   high watermark of all contexts; MEMMON_Task finds it a
+  *                   slice at a time. The thread part is sampled by
+  *                   MEMMON_IrqEntry when an interrupt preempts thread mode,
+  *                   the rest is what the handlers add. The heap watermark
+  *                   is the highest break _sbrk has handed out.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "memmon.h"
+#include <string.h>
+
+/* Private macro -------------------------------------------------------------*/
+#define MEMMON_ALIGN_UP(a)        (((a) + 3U) & ~3U)
+#define MEMMON_ALIGN_DOWN(a)      ((a) & ~3U)
+
+/* External variables --------------------------------------------------------*/
+/* Symbols defined in the linker script */
+extern uint8_t _sdata;
+extern uint8_t _ebss;
+extern uint8_t _end;
+extern uint8_t _estack;
+extern uint32_t _Min_Heap_Size;
+extern uint32_t _Min_Stack_Size;
+
+/* Defined in sysmem.c */
+extern uint8_t *_sbrk_max(void);
+
+/* Private variables ---------------------------------------------------------*/
+static const MEMMON_ModuleTypeDef *MEMMON_Modules;
+static uint32_t MEMMON_ModuleNum;
+
+static uint32_t MEMMON_PaintBase;
+static uint32_t MEMMON_Cursor;
+
+/* Lowest word found overwritten, only ever decreases */
+static __IO uint32_t MEMMON_Low;
+
+static __IO uint32_t MEMMON_ThreadMax;
+
+/**
+  * @brief  Paint the free stack and keep the module table. Call first thing
+  *         in main, before anything deep has run on the stack.
+  * @param  pModules static allocations to report, kept by reference
+  * @param  ModuleNum entries, at most MEMMON_MAX_MODULES are reported
+  * @retval None
+  */
+void MEMMON_Init(const MEMMON_ModuleTypeDef *pModules, uint32_t ModuleNum)
+{
+  uint32_t top = MEMMON_ALIGN_DOWN(__get_MSP() - MEMMON_PAINT_MARGIN);
+  uint32_t addr;
+
+  MEMMON_Modules = pModules;
+  MEMMON_ModuleNum = (pModules != NULL) ? ModuleNum : 0U;
+  if (MEMMON_ModuleNum > MEMMON_MAX_MODULES)
+  {
+    MEMMON_ModuleNum = MEMMON_MAX_MODULES;
+  }
+
+  MEMMON_PaintBase = MEMMON_ALIGN_UP((uint32_t)_sbrk_max());
+  for (addr = MEMMON_PaintBase; addr < top; addr += 4U)
+  {
+    *(uint32_t *)addr = MEMMON_PAINT;
+  }
+
+  MEMMON_Cursor = MEMMON_PaintBase;
+  MEMMON_Low = top;
+  MEMMON_ThreadMax = 0U;
+}
+
+/**
+  * @brief  Look for the lowest overwritten word, MEMMON_SCAN_WORDS at a time
+  *         from the heap break up. A full pass restarts from the bottom so a
+  *         deeper excursion is found on the next one.
+  * @param  pArg unused
+  * @retval None
+  */
+void MEMMON_Task(void *pArg)
+{
+  uint32_t base = MEMMON_ALIGN_UP((uint32_t)_sbrk_max());
+  uint32_t low = MEMMON_Low;
+  uint32_t addr;
+  uint32_t end;
+
+  UNUSED(pArg);
+
+  if (base < MEMMON_PaintBase)
+  {
+    base = MEMMON_PaintBase;
+  }
+  if (MEMMON_Cursor < base)
+  {
+    MEMMON_Cursor = base;
+  }
+
+  end = MEMMON_Cursor + (MEMMON_SCAN_WORDS * 4U);
+  if (end > low)
+  {
+    end = low;
+  }
+  for (addr = MEMMON_Cursor; addr < end; addr += 4U)
+  {
+    if (*(const uint32_t *)addr != MEMMON_PAINT)
+    {
+      MEMMON_Low = addr;
+      break;
+    }
+  }
+
+  MEMMON_Cursor = ((addr < end) || (end == low)) ? base : end;
+}
+
+/**
+  * @brief  Sample the thread stack depth, first thing in a monitored handler
+  *         (see IRQPRIO_Enter). Only the outermost handler samples: the MSP
+  *         then holds the thread frames, one exception frame and our own.
+  * @retval None
+  */
+void MEMMON_IrqEntry(void)
+{
+  uint32_t depth;
+
+  if ((SCB->ICSR & SCB_ICSR_RETTOBASE_Msk) != 0U)
+  {
+    depth = (uint32_t)&_estack - __get_MSP();
+    if (depth > MEMMON_ThreadMax)
+    {
+      MEMMON_ThreadMax = depth;
+    }
+  }
+}
+
+/**
+  * @brief  Build the memory report, see MEMMON_ReportTypeDef. Safe from the
+  *         USB interrupt: only reads what the task and handlers keep.
+  * @param  pBuf destination, may be shorter than the report
+  * @param  Len size of pBuf
+  * @retval bytes written
+  */
+uint32_t MEMMON_GetReport(uint8_t *pBuf, uint32_t Len)
+{
+  MEMMON_ReportTypeDef report;
+  uint32_t heap_end = MEMMON_ALIGN_UP((uint32_t)_sbrk_max());
+  uint32_t low = MEMMON_Low;
+  uint32_t i;
+
+  if (pBuf == NULL)
+  {
+    return 0U;
+  }
+
+  (void)memset(&report, 0, sizeof(report));
+
+  report.DataBss = (uint32_t)&_ebss - (uint32_t)&_sdata;
+  report.HeapReserve = (uint32_t)&_Min_Heap_Size;
+  report.HeapMax = heap_end - (uint32_t)&_end;
+  report.StackReserve = (uint32_t)&_Min_Stack_Size;
+  report.StackMax = (uint32_t)&_estack - low;
+  report.ThreadMax = MEMMON_ThreadMax;
+  report.IsrMax = (report.StackMax > report.ThreadMax) ? (report.StackMax - report.ThreadMax) : 0U;
+  report.Free = (low > heap_end) ? (low - heap_end) : 0U;
+
+  if (report.StackMax > report.StackReserve)
+  {
+    report.Flags |= MEMMON_FLAG_STACK_RESERVE;
+  }
+  if (report.HeapMax > report.HeapReserve)
+  {
+    report.Flags |= MEMMON_FLAG_HEAP_RESERVE;
+  }
+  if ((low <= heap_end) || (low == MEMMON_PaintBase))
+  {
+    report.Flags |= MEMMON_FLAG_COLLISION;
+  }
+
+  report.ModuleNum = MEMMON_ModuleNum;
+  for (i = 0U; i < MEMMON_ModuleNum; i++)
+  {
+    (void)strncpy(report.Modules[i].Name, MEMMON_Modules[i].Name, MEMMON_NAME_LEN);
+    report.Modules[i].Size = MEMMON_Modules[i].Size;
+  }
+
+  if (Len > sizeof(report))
+  {
+    Len = sizeof(report);
+  }
+  (void)memcpy(pBuf, &report, Len);
+
+  return Len;
+}
@@ -0,0 +1,266 @@
+/**
+  ******************************************************************************
+  * @file           : sched.c
+  * @brief          : Priority based, run-to-completion cooperative scheduler.
+  *
+  *                   Tasks are plain functions that return when their work is
+  *                   done. SCHED_RunOnce picks the most urgent ready task and
+  *                   runs it to completion: no task is ever preempted by
+  *                   another, interrupt handlers only make tasks ready with
+  *                   SCHED_Signal. Every run is timed with the DWT cycle
+  *                   counter and checked against the task's budget.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sched.h"
+#include <string.h>
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  SCHED_TaskInitTypeDef  Init;
+  uint32_t               NextTick;
+  SCHED_TaskStatsTypeDef Stats;
+} SCHED_TaskTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static SCHED_TaskTypeDef SCHED_Tasks[SCHED_MAX_TASKS];
+static uint32_t SCHED_TaskNum;
+
+/* One bit per task, set from any context, cleared by SCHED_RunOnce */
+static __IO uint32_t SCHED_Pending;
+
+static uint64_t SCHED_IdleCycles;
+static uint32_t SCHED_IdleStart;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t SCHED_IsReady(const SCHED_TaskTypeDef *pTask, uint32_t id, uint32_t pending,
+                              uint32_t tick);
+
+/**
+  * @brief  Forget all tasks. The DWT cycle counter the budgets are checked
+  *         with must already run, see App_CycleCounterInit.
+  * @retval None
+  */
+void SCHED_Init(void)
+{
+  SCHED_TaskNum = 0U;
+  SCHED_Pending = 0U;
+  SCHED_IdleCycles = 0U;
+  SCHED_IdleStart = DWT->CYCCNT;
+}
+
+/**
+  * @brief  Add a task. Call from thread context before or between runs.
+  * @param  pInit task description, copied
+  * @param  pId receives the id to pass to SCHED_Signal and SCHED_GetStats
+  * @retval HAL status
+  */
+HAL_StatusTypeDef SCHED_AddTask(const SCHED_TaskInitTypeDef *pInit, uint32_t *pId)
+{
+  SCHED_TaskTypeDef *task;
+
+  if ((pInit == NULL) || (pInit->Func == NULL) || (pId == NULL) ||
+      (SCHED_TaskNum >= SCHED_MAX_TASKS))
+  {
+    return HAL_ERROR;
+  }
+
+  task = &SCHED_Tasks[SCHED_TaskNum];
+  task->Init = *pInit;
+  task->NextTick = HAL_GetTick() + pInit->PeriodMs;
+  (void)memset(&task->Stats, 0, sizeof(task->Stats));
+
+  *pId = SCHED_TaskNum;
+  SCHED_TaskNum++;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Make a task ready. Safe from interrupt handlers and DMA or USB
+  *         callbacks; several signals before the task runs give one run.
+  * @param  Id task id, SCHED_NO_TASK is ignored
+  * @retval None
+  */
+void SCHED_Signal(uint32_t Id)
+{
+  uint32_t pending;
+  uint32_t signals;
+
+  if (Id >= SCHED_TaskNum)
+  {
+    return;
+  }
+
+  do
+  {
+    pending = __LDREXW(&SCHED_Pending);
+  } while (__STREXW(pending | (1UL << Id), &SCHED_Pending) != 0U);
+
+  /* Signalled from several interrupt priorities, counted the same way */
+  do
+  {
+    signals = __LDREXW(&SCHED_Tasks[Id].Stats.Signals);
+  } while (__STREXW(signals + 1U, &SCHED_Tasks[Id].Stats.Signals) != 0U);
+}
+
+/**
+  * @brief  Run the most urgent ready task to completion.
+  * @retval 1 if a task ran, 0 if none was ready and the caller may sleep
+  */
+uint32_t SCHED_RunOnce(void)
+{
+  SCHED_TaskTypeDef *task;
+  uint32_t tick = HAL_GetTick();
+  uint32_t pending = SCHED_Pending;
+  uint32_t best = SCHED_NO_TASK;
+  uint32_t id;
+  uint32_t start;
+  uint32_t cycles;
+
+  for (id = 0U; id < SCHED_TaskNum; id++)
+  {
+    if ((SCHED_IsReady(&SCHED_Tasks[id], id, pending, tick) != 0U) &&
+        ((best == SCHED_NO_TASK) || (SCHED_Tasks[id].Init.Priority < SCHED_Tasks[best].Init.Priority)))
+    {
+      best = id;
+    }
+  }
+
+  if (best == SCHED_NO_TASK)
+  {
+    return 0U;
+  }
+
+  task = &SCHED_Tasks[best];
+
+  /* Cleared before the run, so a signal raised meanwhile is not lost */
+  do
+  {
+    pending = __LDREXW(&SCHED_Pending);
+  } while (__STREXW(pending & ~(1UL << best), &SCHED_Pending) != 0U);
+
+  if ((task->Init.PeriodMs != SCHED_PERIOD_NONE) && (task->Init.PeriodMs != SCHED_PERIOD_CONTINUOUS) &&
+      ((int32_t)(tick - task->NextTick) >= 0))
+  {
+    task->NextTick += task->Init.PeriodMs;
+    if ((int32_t)(tick - task->NextTick) >= 0)
+    {
+      /* Skip the periods already missed instead of running back to back */
+      task->Stats.Late++;
+      task->NextTick = tick + task->Init.PeriodMs;
+    }
+  }
+
+  start = DWT->CYCCNT;
+  SCHED_IdleCycles += start - SCHED_IdleStart;
+
+  task->Init.Func(task->Init.pArg);
+
+  SCHED_IdleStart = DWT->CYCCNT;
+  cycles = SCHED_IdleStart - start;
+
+  task->Stats.Runs++;
+  task->Stats.CyclesLast = cycles;
+  task->Stats.CyclesTotal += cycles;
+  if (cycles > task->Stats.CyclesMax)
+  {
+    task->Stats.CyclesMax = cycles;
+  }
+  if ((task->Init.BudgetCycles != 0U) && (cycles > task->Init.BudgetCycles))
+  {
+    task->Stats.Overruns++;
+  }
+
+  return 1U;
+}
+
+/**
+  * @brief  Sleep until the next interrupt unless a task is ready. Interrupts
+  *         are masked from the check to the WFI, so a signal raised after
+  *         SCHED_RunOnce found nothing still wakes the core: a pending
+  *         interrupt ends WFI even while masked, and runs once unmasked.
+  * @retval None
+  */
+void SCHED_Idle(void)
+{
+  uint32_t tick;
+  uint32_t pending;
+  uint32_t id;
+
+  __disable_irq();
+
+  tick = HAL_GetTick();
+  pending = SCHED_Pending;
+  for (id = 0U; id < SCHED_TaskNum; id++)
+  {
+    if (SCHED_IsReady(&SCHED_Tasks[id], id, pending, tick) != 0U)
+    {
+      break;
+    }
+  }
+  if (id == SCHED_TaskNum)
+  {
+    __WFI();
+  }
+
+  __enable_irq();
+}
+
+/**
+  * @brief  Copy the accounting of one task. Call from thread context.
+  * @param  Id task id
+  * @param  pStats destination
+  * @retval HAL status
+  */
+HAL_StatusTypeDef SCHED_GetStats(uint32_t Id, SCHED_TaskStatsTypeDef *pStats)
+{
+  if ((Id >= SCHED_TaskNum) || (pStats == NULL))
+  {
+    return HAL_ERROR;
+  }
+
+  *pStats = SCHED_Tasks[Id].Stats;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Cycles spent outside the tasks: selection, sleep and interrupts.
+  * @retval cycle count since SCHED_Init, up to the start of the last run
+  */
+uint64_t SCHED_GetIdleCycles(void)
+{
+  return SCHED_IdleCycles;
+}
+
+/**
+  * @brief  Whether a task has work to do.
+  * @param  pTask task
+  * @param  id task id
+  * @param  pending snapshot of the pending bits
+  * @param  tick current HAL tick
+  * @retval 1 if ready
+  */
+static uint32_t SCHED_IsReady(const SCHED_TaskTypeDef *pTask, uint32_t id, uint32_t pending,
+                              uint32_t tick)
+{
+  if ((pending & (1UL << id)) != 0U)
+  {
+    return 1U;
+  }
+
+  if (pTask->Init.PeriodMs == SCHED_PERIOD_CONTINUOUS)
+  {
+    return 1U;
+  }
+
+  if ((pTask->Init.PeriodMs != SCHED_PERIOD_NONE) && ((int32_t)(tick - pTask->NextTick) >= 0))
+  {
+    return 1U;
+  }
+
+  return 0U;
+}
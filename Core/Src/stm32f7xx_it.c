@@ -22,6 +22,9 @@
 #include "stm32f7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "irqprio.h"
+#include "usbd_cdc_uart.h"
+#include "usbd_cdc_spi.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -183,11 +186,12 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  IRQPRIO_TickEntry();
+  IRQPRIO_ENTER(TICK);
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  IRQPRIO_EXIT(TICK);
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -204,14 +208,86 @@ void SysTick_Handler(void)
 void OTG_FS_IRQHandler(void)
 {
   /* USER CODE BEGIN OTG_FS_IRQn 0 */
-
+  IRQPRIO_ENTER(USB);
+  USBD_LL_TrafficBoost(&hpcd_USB_OTG_FS);
   /* USER CODE END OTG_FS_IRQn 0 */
   HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
   /* USER CODE BEGIN OTG_FS_IRQn 1 */
-
+  IRQPRIO_EXIT(USB);
   /* USER CODE END OTG_FS_IRQn 1 */
 }
 
 /* USER CODE BEGIN 1 */
+/**
+  * @brief This function handles USART3 global interrupt.
+  */
+void USART3_IRQHandler(void)
+{
+  IRQPRIO_ENTER(UART3);
+  CDC_Uart_IRQHandler(0U);
+  IRQPRIO_EXIT(UART3);
+}
+
+/**
+  * @brief This function handles DMA1 stream1 global interrupt, USART3 RX.
+  */
+void DMA1_Stream1_IRQHandler(void)
+{
+  IRQPRIO_ENTER(UART3_RX);
+  CDC_Uart_DmaRxIRQHandler(0U);
+  IRQPRIO_EXIT(UART3_RX);
+}
+
+/**
+  * @brief This function handles DMA1 stream3 global interrupt, USART3 TX.
+  */
+void DMA1_Stream3_IRQHandler(void)
+{
+  IRQPRIO_ENTER(UART3_TX);
+  CDC_Uart_DmaTxIRQHandler(0U);
+  IRQPRIO_EXIT(UART3_TX);
+}
+
+/**
+  * @brief This function handles DMA2 stream0 global interrupt, SPI1 RX.
+  */
+void DMA2_Stream0_IRQHandler(void)
+{
+  IRQPRIO_ENTER(SPI1_RX);
+  CDC_Spi_DmaRxIRQHandler();
+  IRQPRIO_EXIT(SPI1_RX);
+}
+
+#if (USBD_CDC_FUNC_NUM > 1U)
+/**
+  * @brief This function handles USART6 global interrupt.
+  */
+void USART6_IRQHandler(void)
+{
+  IRQPRIO_ENTER(UART6);
+  CDC_Uart_IRQHandler(1U);
+  IRQPRIO_EXIT(UART6);
+}
+
+/**
+  * @brief This function handles DMA2 stream1 global interrupt, USART6 RX.
+  */
+void DMA2_Stream1_IRQHandler(void)
+{
+  IRQPRIO_ENTER(UART6_RX);
+  CDC_Uart_DmaRxIRQHandler(1U);
+  IRQPRIO_EXIT(UART6_RX);
+}
+
+/**
+  * @brief This function handles DMA2 stream6 global interrupt, USART6 TX.
+  */
+void DMA2_Stream6_IRQHandler(void)
+{
+  IRQPRIO_ENTER(UART6_TX);
+  CDC_Uart_DmaTxIRQHandler(1U);
+  IRQPRIO_EXIT(UART6_TX);
+}
+#endif /* USBD_CDC_FUNC_NUM */
 
 /* USER CODE END 1 */
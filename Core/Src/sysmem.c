@@ -29,6 +29,11 @@
  */
 static uint8_t *__sbrk_heap_end = NULL;
 
+/**
+ * Highest heap end ever reached, for the memory report
+ */
+static uint8_t *__sbrk_heap_max = NULL;
+
 /**
  * @brief _sbrk() allocates memory to the newlib heap and is used by malloc
  *        and others from the C library
@@ -74,6 +79,22 @@ void *_sbrk(ptrdiff_t incr)
 
   prev_heap_end = __sbrk_heap_end;
   __sbrk_heap_end += incr;
+  if (__sbrk_heap_end > __sbrk_heap_max)
+  {
+    __sbrk_heap_max = __sbrk_heap_end;
+  }
 
   return (void *)prev_heap_end;
 }
+
+/**
+ * @brief _sbrk_max() reports the heap high watermark
+ *
+ * @return Highest heap end handed out so far, '_end' before the first _sbrk()
+ */
+uint8_t *_sbrk_max(void)
+{
+  extern uint8_t _end; /* Symbol defined in the linker script */
+
+  return (NULL == __sbrk_heap_max) ? &_end : __sbrk_heap_max;
+}
@@ -5,7 +5,13 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Core/Src/blog.c \
+../Core/Src/clkgov.c \
+../Core/Src/decim.c \
+../Core/Src/irqprio.c \
 ../Core/Src/main.c \
+../Core/Src/memmon.c \
+../Core/Src/sched.c \
 ../Core/Src/stm32f7xx_hal_msp.c \
 ../Core/Src/stm32f7xx_it.c \
 ../Core/Src/syscalls.c \
@@ -13,7 +19,13 @@ C_SRCS += \
 ../Core/Src/system_stm32f7xx.c 
 
 OBJS += \
+./Core/Src/blog.o \
+./Core/Src/clkgov.o \
+./Core/Src/decim.o \
+./Core/Src/irqprio.o \
 ./Core/Src/main.o \
+./Core/Src/memmon.o \
+./Core/Src/sched.o \
 ./Core/Src/stm32f7xx_hal_msp.o \
 ./Core/Src/stm32f7xx_it.o \
 ./Core/Src/syscalls.o \
@@ -21,7 +33,13 @@ OBJS += \
 ./Core/Src/system_stm32f7xx.o 
 
 C_DEPS += \
+./Core/Src/blog.d \
+./Core/Src/clkgov.d \
+./Core/Src/decim.d \
+./Core/Src/irqprio.d \
 ./Core/Src/main.d \
+./Core/Src/memmon.d \
+./Core/Src/sched.d \
 ./Core/Src/stm32f7xx_hal_msp.d \
 ./Core/Src/stm32f7xx_it.d \
 ./Core/Src/syscalls.d \
@@ -36,7 +54,7 @@ Core/Src/%.o Core/Src/%.su: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f7xx_hal_msp.d ./Core/Src/stm32f7xx_hal_msp.o ./Core/Src/stm32f7xx_hal_msp.su ./Core/Src/stm32f7xx_it.d ./Core/Src/stm32f7xx_it.o ./Core/Src/stm32f7xx_it.su ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f7xx.d ./Core/Src/system_stm32f7xx.o ./Core/Src/system_stm32f7xx.su
+	-$(RM) ./Core/Src/blog.d ./Core/Src/blog.o ./Core/Src/blog.su ./Core/Src/clkgov.d ./Core/Src/clkgov.o ./Core/Src/clkgov.su ./Core/Src/decim.d ./Core/Src/decim.o ./Core/Src/decim.su ./Core/Src/irqprio.d ./Core/Src/irqprio.o ./Core/Src/irqprio.su ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/memmon.d ./Core/Src/memmon.o ./Core/Src/memmon.su ./Core/Src/sched.d ./Core/Src/sched.o ./Core/Src/sched.su ./Core/Src/stm32f7xx_hal_msp.d ./Core/Src/stm32f7xx_hal_msp.o ./Core/Src/stm32f7xx_hal_msp.su ./Core/Src/stm32f7xx_it.d ./Core/Src/stm32f7xx_it.o ./Core/Src/stm32f7xx_it.su ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f7xx.d ./Core/Src/system_stm32f7xx.o ./Core/Src/system_stm32f7xx.su
 
 .PHONY: clean-Core-2f-Src
 
@@ -7,16 +7,25 @@
 C_SRCS += \
 ../USB_DEVICE/App/usb_device.c \
 ../USB_DEVICE/App/usbd_cdc_if.c \
+../USB_DEVICE/App/usbd_cdc_spi.c \
+../USB_DEVICE/App/usbd_cdc_stream.c \
+../USB_DEVICE/App/usbd_cdc_uart.c \
 ../USB_DEVICE/App/usbd_desc.c 
 
 OBJS += \
 ./USB_DEVICE/App/usb_device.o \
 ./USB_DEVICE/App/usbd_cdc_if.o \
+./USB_DEVICE/App/usbd_cdc_spi.o \
+./USB_DEVICE/App/usbd_cdc_stream.o \
+./USB_DEVICE/App/usbd_cdc_uart.o \
 ./USB_DEVICE/App/usbd_desc.o 
 
 C_DEPS += \
 ./USB_DEVICE/App/usb_device.d \
 ./USB_DEVICE/App/usbd_cdc_if.d \
+./USB_DEVICE/App/usbd_cdc_spi.d \
+./USB_DEVICE/App/usbd_cdc_stream.d \
+./USB_DEVICE/App/usbd_cdc_uart.d \
 ./USB_DEVICE/App/usbd_desc.d 
 
 
@@ -27,7 +36,7 @@ USB_DEVICE/App/%.o USB_DEVICE/App/%.su: ../USB_DEVICE/App/%.c USB_DEVICE/App/sub
 clean: clean-USB_DEVICE-2f-App
 
 clean-USB_DEVICE-2f-App:
-	-$(RM) ./USB_DEVICE/App/usb_device.d ./USB_DEVICE/App/usb_device.o ./USB_DEVICE/App/usb_device.su ./USB_DEVICE/App/usbd_cdc_if.d ./USB_DEVICE/App/usbd_cdc_if.o ./USB_DEVICE/App/usbd_cdc_if.su ./USB_DEVICE/App/usbd_desc.d ./USB_DEVICE/App/usbd_desc.o ./USB_DEVICE/App/usbd_desc.su
+	-$(RM) ./USB_DEVICE/App/usb_device.d ./USB_DEVICE/App/usb_device.o ./USB_DEVICE/App/usb_device.su ./USB_DEVICE/App/usbd_cdc_if.d ./USB_DEVICE/App/usbd_cdc_if.o ./USB_DEVICE/App/usbd_cdc_if.su ./USB_DEVICE/App/usbd_cdc_spi.d ./USB_DEVICE/App/usbd_cdc_spi.o ./USB_DEVICE/App/usbd_cdc_spi.su ./USB_DEVICE/App/usbd_cdc_stream.d ./USB_DEVICE/App/usbd_cdc_stream.o ./USB_DEVICE/App/usbd_cdc_stream.su ./USB_DEVICE/App/usbd_cdc_uart.d ./USB_DEVICE/App/usbd_cdc_uart.o ./USB_DEVICE/App/usbd_cdc_uart.su ./USB_DEVICE/App/usbd_desc.d ./USB_DEVICE/App/usbd_desc.o ./USB_DEVICE/App/usbd_desc.su
 
 .PHONY: clean-USB_DEVICE-2f-App
 
@@ -80,12 +80,31 @@ typedef enum
 
 } PCD_BCD_MsgTypeDef;
 
+/**
+  * @brief  PCD Tx FIFO refill statistics, one entry per IN endpoint
+  */
+typedef struct
+{
+  uint32_t refills;    /*!< Tx FIFO empty interrupts serviced                       */
+  uint32_t prefills;   /*!< Transfers whose first packets were queued at start      */
+  uint32_t starved;    /*!< Refills that found the FIFO completely drained          */
+} PCD_TxFifoStatsTypeDef;
+
 #if defined (USB_OTG_FS) || defined (USB_OTG_HS)
 typedef USB_OTG_GlobalTypeDef  PCD_TypeDef;
 typedef USB_OTG_CfgTypeDef     PCD_InitTypeDef;
 typedef USB_OTG_EPTypeDef      PCD_EPTypeDef;
+typedef USB_OTG_SegTypeDef     PCD_SegTypeDef;
 #endif /* defined (USB_OTG_FS) || defined (USB_OTG_HS) */
 
+/**
+  * @brief  Number of endpoints given state in the PCD handle, EP0 included.
+  *         Override in stm32f7xx_hal_conf.h to save RAM and cache lines.
+  */
+#ifndef PCD_MAX_EP_NUM
+#define PCD_MAX_EP_NUM          16U
+#endif /* PCD_MAX_EP_NUM */
+
 /**
   * @brief  PCD Handle Structure definition
   */
@@ -98,8 +117,8 @@ typedef struct
   PCD_TypeDef             *Instance;   /*!< Register base address             */
   PCD_InitTypeDef         Init;        /*!< PCD required parameters           */
   __IO uint8_t            USB_Address; /*!< USB Address                       */
-  PCD_EPTypeDef           IN_ep[16];   /*!< IN endpoint parameters            */
-  PCD_EPTypeDef           OUT_ep[16];  /*!< OUT endpoint parameters           */
+  PCD_EPTypeDef           IN_ep[PCD_MAX_EP_NUM];   /*!< IN endpoint parameters  */
+  PCD_EPTypeDef           OUT_ep[PCD_MAX_EP_NUM];  /*!< OUT endpoint parameters */
   HAL_LockTypeDef         Lock;        /*!< PCD peripheral status             */
   __IO PCD_StateTypeDef   State;       /*!< PCD communication state           */
   __IO  uint32_t          ErrorCode;   /*!< PCD Error code                    */
@@ -111,6 +130,9 @@ typedef struct
 
   uint32_t lpm_active;                 /*!< Enable or disable the Link Power Management .
                                        This parameter can be set to ENABLE or DISABLE        */
+  uint32_t                TxFifoPrefill; /*!< Queue IN packets at transfer start instead of
+                                              waiting for the first Tx FIFO empty interrupt */
+  PCD_TxFifoStatsTypeDef  TxFifoStats[PCD_MAX_EP_NUM]; /*!< Tx FIFO refill statistics per IN endpoint */
   void                    *pData;      /*!< Pointer to upper stack Handler */
 
 #if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
@@ -165,6 +187,15 @@ typedef struct
   * @}
   */
 
+/** @defgroup PCD_TxFIFO_Empty_Level PCD Tx FIFO Empty Level
+  * @{
+  */
+#define PCD_TXFIFO_EMPTY_LVL_HALF      0U                         /*!< TXFE raised when the Tx FIFO is half empty, reset value */
+#define PCD_TXFIFO_EMPTY_LVL_COMPLETE  USB_OTG_GAHBCFG_TXFELVL    /*!< TXFE raised when the Tx FIFO is completely empty */
+/**
+  * @}
+  */
+
 /** @defgroup PCD_Error_Code_definition PCD Error Code definition
   * @brief  PCD Error Code definition
   * @{
@@ -353,7 +384,12 @@ HAL_StatusTypeDef HAL_PCD_SetAddress(PCD_HandleTypeDef *hpcd, uint8_t address);
 HAL_StatusTypeDef HAL_PCD_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t ep_mps, uint8_t ep_type);
 HAL_StatusTypeDef HAL_PCD_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
 HAL_StatusTypeDef HAL_PCD_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len);
+HAL_StatusTypeDef HAL_PCD_EP_ReceiveSplit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr,
+                                          uint8_t *pHdr, uint32_t hdr_len,
+                                          uint8_t *pBuf, uint32_t len);
 HAL_StatusTypeDef HAL_PCD_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len);
+HAL_StatusTypeDef HAL_PCD_EP_TransmitSeg(PCD_HandleTypeDef *hpcd, uint8_t ep_addr,
+                                         const PCD_SegTypeDef *pSeg, uint32_t SegNum);
 HAL_StatusTypeDef HAL_PCD_EP_SetStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
 HAL_StatusTypeDef HAL_PCD_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
 HAL_StatusTypeDef HAL_PCD_EP_Flush(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
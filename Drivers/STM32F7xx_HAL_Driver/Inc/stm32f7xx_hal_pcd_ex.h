@@ -49,6 +49,8 @@ extern "C" {
 #if defined (USB_OTG_FS) || defined (USB_OTG_HS)
 HAL_StatusTypeDef HAL_PCDEx_SetTxFiFo(PCD_HandleTypeDef *hpcd, uint8_t fifo, uint16_t size);
 HAL_StatusTypeDef HAL_PCDEx_SetRxFiFo(PCD_HandleTypeDef *hpcd, uint16_t size);
+HAL_StatusTypeDef HAL_PCDEx_ConfigTxFiFoRefill(PCD_HandleTypeDef *hpcd, uint32_t EmptyLevel, uint32_t Prefill);
+uint32_t HAL_PCDEx_Poll(PCD_HandleTypeDef *hpcd, uint32_t MaxPasses);
 #endif /* defined (USB_OTG_FS) || defined (USB_OTG_HS) */
 
 
@@ -123,21 +123,55 @@ typedef struct
 
 typedef struct
 {
+  uint8_t   *pbuf;                /*!< Pointer to the segment data                                              */
+
+  uint32_t  len;                  /*!< Segment length in bytes                                                  */
+} USB_OTG_SegTypeDef;
+
+typedef struct
+{
+  /* Touched for every packet by the interrupt handler, kept together */
+
+  uint8_t   *xfer_buff;           /*!< Pointer to transfer buffer                                               */
+
+  uint32_t  xfer_len;             /*!< Current transfer length                                                  */
+
+  uint32_t  xfer_count;           /*!< Partial transfer length in case of multi packet transfer                 */
+
+  uint32_t  maxpacket;            /*!< Endpoint Max packet size
+                                       This parameter must be a number between Min_Data = 0 and Max_Data = 64KB */
+
+  uint32_t  xfer_size;            /*!< requested transfer size                                                  */
+
   uint8_t   num;                  /*!< Endpoint number
                                        This parameter must be a number between Min_Data = 1 and Max_Data = 15   */
 
   uint8_t   is_in;                /*!< Endpoint direction
                                        This parameter must be a number between Min_Data = 0 and Max_Data = 1    */
 
+  uint8_t   type;                 /*!< Endpoint type
+                                       This parameter can be any value of @ref USB_LL_EP_Type                   */
+
   uint8_t   is_stall;             /*!< Endpoint stall condition
                                        This parameter must be a number between Min_Data = 0 and Max_Data = 1    */
 
+  const USB_OTG_SegTypeDef *xfer_seg; /*!< Scatter-gather segment list, NULL for a contiguous transfer       */
+
+  uint32_t  xfer_seg_num;         /*!< Number of entries in the segment list                                    */
+
+  uint32_t  xfer_seg_idx;         /*!< Segment currently being written to the FIFO                              */
+
+  uint32_t  xfer_seg_off;         /*!< Offset inside the current segment                                        */
+
+  uint8_t   *xfer_hdr;            /*!< OUT header buffer for a split receive, NULL when not used                */
+
+  uint32_t  xfer_hdr_len;         /*!< Number of leading bytes routed to xfer_hdr                               */
+
+  /* Set up once per transfer or when the endpoint is opened */
+
   uint8_t   is_iso_incomplete;    /*!< Endpoint isoc condition
                                        This parameter must be a number between Min_Data = 0 and Max_Data = 1    */
 
-  uint8_t   type;                 /*!< Endpoint type
-                                       This parameter can be any value of @ref USB_LL_EP_Type                   */
-
   uint8_t   data_pid_start;       /*!< Initial data PID
                                        This parameter must be a number between Min_Data = 0 and Max_Data = 1    */
 
@@ -147,18 +181,7 @@ typedef struct
   uint16_t  tx_fifo_num;          /*!< Transmission FIFO number
                                        This parameter must be a number between Min_Data = 1 and Max_Data = 15   */
 
-  uint32_t  maxpacket;            /*!< Endpoint Max packet size
-                                       This parameter must be a number between Min_Data = 0 and Max_Data = 64KB */
-
-  uint8_t   *xfer_buff;           /*!< Pointer to transfer buffer                                               */
-
   uint32_t  dma_addr;             /*!< 32 bits aligned transfer buffer address                                  */
-
-  uint32_t  xfer_len;             /*!< Current transfer length                                                  */
-
-  uint32_t  xfer_size;            /*!< requested transfer size                                                  */
-
-  uint32_t  xfer_count;           /*!< Partial transfer length in case of multi packet transfer                 */
 } USB_OTG_EPTypeDef;
 
 typedef struct
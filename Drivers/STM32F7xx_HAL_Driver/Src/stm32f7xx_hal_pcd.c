@@ -79,6 +79,10 @@
   */
 #define PCD_MIN(a, b)  (((a) < (b)) ? (a) : (b))
 #define PCD_MAX(a, b)  (((a) > (b)) ? (a) : (b))
+
+/* Endpoints with state in IN_ep/OUT_ep, the hardware may have more */
+#define PCD_EP_NUM(hpcd)            PCD_MIN((hpcd)->Init.dev_endpoints, PCD_MAX_EP_NUM)
+#define PCD_EP_IS_VALID(ep_addr)    ((((uint32_t)(ep_addr) & EP_ADDR_MSK) < PCD_MAX_EP_NUM) ? 1U : 0U)
 /**
   * @}
   */
@@ -89,6 +93,9 @@
   */
 #if defined (USB_OTG_FS) || defined (USB_OTG_HS)
 static HAL_StatusTypeDef PCD_WriteEmptyTxFifo(PCD_HandleTypeDef *hpcd, uint32_t epnum);
+static void PCD_PrefillTxFifo(PCD_HandleTypeDef *hpcd, uint32_t epnum);
+static void PCD_WriteSegPacket(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep, uint32_t epnum, uint32_t len);
+static void PCD_ReadSplitPacket(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep, uint32_t len);
 static HAL_StatusTypeDef PCD_EP_OutXfrComplete_int(PCD_HandleTypeDef *hpcd, uint32_t epnum);
 static HAL_StatusTypeDef PCD_EP_OutSetupPacket_int(PCD_HandleTypeDef *hpcd, uint32_t epnum);
 #endif /* defined (USB_OTG_FS) || defined (USB_OTG_HS) */
@@ -189,7 +196,7 @@ HAL_StatusTypeDef HAL_PCD_Init(PCD_HandleTypeDef *hpcd)
   (void)USB_SetCurrentMode(hpcd->Instance, USB_DEVICE_MODE);
 
   /* Init endpoints structures */
-  for (i = 0U; i < hpcd->Init.dev_endpoints; i++)
+  for (i = 0U; i < PCD_EP_NUM(hpcd); i++)
   {
     /* Init ep structure */
     hpcd->IN_ep[i].is_in = 1U;
@@ -200,9 +207,10 @@ HAL_StatusTypeDef HAL_PCD_Init(PCD_HandleTypeDef *hpcd)
     hpcd->IN_ep[i].maxpacket = 0U;
     hpcd->IN_ep[i].xfer_buff = 0U;
     hpcd->IN_ep[i].xfer_len = 0U;
+    hpcd->IN_ep[i].xfer_seg = NULL;
   }
 
-  for (i = 0U; i < hpcd->Init.dev_endpoints; i++)
+  for (i = 0U; i < PCD_EP_NUM(hpcd); i++)
   {
     hpcd->OUT_ep[i].is_in = 0U;
     hpcd->OUT_ep[i].num = i;
@@ -211,6 +219,7 @@ HAL_StatusTypeDef HAL_PCD_Init(PCD_HandleTypeDef *hpcd)
     hpcd->OUT_ep[i].maxpacket = 0U;
     hpcd->OUT_ep[i].xfer_buff = 0U;
     hpcd->OUT_ep[i].xfer_len = 0U;
+    hpcd->OUT_ep[i].xfer_hdr = NULL;
   }
 
   /* Init Device */
@@ -1000,11 +1009,24 @@ void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd)
       {
         if ((RegVal & USB_OTG_GRXSTSP_BCNT) != 0U)
         {
-          (void)USB_ReadPacket(USBx, ep->xfer_buff,
-                               (uint16_t)((RegVal & USB_OTG_GRXSTSP_BCNT) >> 4));
+          if (ep->xfer_hdr != NULL)
+          {
+            PCD_ReadSplitPacket(hpcd, ep, (RegVal & USB_OTG_GRXSTSP_BCNT) >> 4);
+          }
+          else
+          {
+            (void)USB_ReadPacket(USBx, ep->xfer_buff,
+                                 (uint16_t)((RegVal & USB_OTG_GRXSTSP_BCNT) >> 4));
 
-          ep->xfer_buff += (RegVal & USB_OTG_GRXSTSP_BCNT) >> 4;
+            ep->xfer_buff += (RegVal & USB_OTG_GRXSTSP_BCNT) >> 4;
+          }
           ep->xfer_count += (RegVal & USB_OTG_GRXSTSP_BCNT) >> 4;
+
+          /* A split receive counts only what it stored */
+          if ((ep->xfer_hdr != NULL) && (ep->xfer_count > ep->xfer_len))
+          {
+            ep->xfer_count = ep->xfer_len;
+          }
         }
       }
       else if (((RegVal & USB_OTG_GRXSTSP_PKTSTS) >> 17) == STS_SETUP_UPDT)
@@ -1163,6 +1185,7 @@ void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd)
           }
           if ((epint & USB_OTG_DIEPINT_TXFE) == USB_OTG_DIEPINT_TXFE)
           {
+            hpcd->TxFifoStats[epnum].refills++;
             (void)PCD_WriteEmptyTxFifo(hpcd, epnum);
           }
         }
@@ -1325,7 +1348,7 @@ void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd)
     {
       USBx->GINTMSK &= ~USB_OTG_GINTMSK_GONAKEFFM;
 
-      for (epnum = 1U; epnum < hpcd->Init.dev_endpoints; epnum++)
+      for (epnum = 1U; epnum < PCD_EP_NUM(hpcd); epnum++)
       {
         if (hpcd->OUT_ep[epnum].is_iso_incomplete == 1U)
         {
@@ -1338,7 +1361,7 @@ void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd)
     /* Handle Incomplete ISO IN Interrupt */
     if (__HAL_PCD_GET_FLAG(hpcd, USB_OTG_GINTSTS_IISOIXFR))
     {
-      for (epnum = 1U; epnum < hpcd->Init.dev_endpoints; epnum++)
+      for (epnum = 1U; epnum < PCD_EP_NUM(hpcd); epnum++)
       {
         RegVal = USBx_INEP(epnum)->DIEPCTL;
 
@@ -1358,7 +1381,7 @@ void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd)
     /* Handle Incomplete ISO OUT Interrupt */
     if (__HAL_PCD_GET_FLAG(hpcd, USB_OTG_GINTSTS_PXFR_INCOMPISOOUT))
     {
-      for (epnum = 1U; epnum < hpcd->Init.dev_endpoints; epnum++)
+      for (epnum = 1U; epnum < PCD_EP_NUM(hpcd); epnum++)
       {
         RegVal = USBx_OUTEP(epnum)->DOEPCTL;
 
@@ -1685,6 +1708,11 @@ HAL_StatusTypeDef HAL_PCD_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr,
   HAL_StatusTypeDef  ret = HAL_OK;
   PCD_EPTypeDef *ep;
 
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return HAL_ERROR;
+  }
+
   if ((ep_addr & 0x80U) == 0x80U)
   {
     ep = &hpcd->IN_ep[ep_addr & EP_ADDR_MSK];
@@ -1728,6 +1756,11 @@ HAL_StatusTypeDef HAL_PCD_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
 {
   PCD_EPTypeDef *ep;
 
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return HAL_ERROR;
+  }
+
   if ((ep_addr & 0x80U) == 0x80U)
   {
     ep = &hpcd->IN_ep[ep_addr & EP_ADDR_MSK];
@@ -1759,12 +1792,18 @@ HAL_StatusTypeDef HAL_PCD_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, u
 {
   PCD_EPTypeDef *ep;
 
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return HAL_ERROR;
+  }
+
   ep = &hpcd->OUT_ep[ep_addr & EP_ADDR_MSK];
 
   /*setup and start the Xfer */
   ep->xfer_buff = pBuf;
   ep->xfer_len = len;
   ep->xfer_count = 0U;
+  ep->xfer_hdr = NULL;
   ep->is_in = 0U;
   ep->num = ep_addr & EP_ADDR_MSK;
 
@@ -1785,6 +1824,55 @@ HAL_StatusTypeDef HAL_PCD_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, u
   return HAL_OK;
 }
 
+/**
+  * @brief  Receive an amount of data, splitting off a fixed-size header.
+  * @note   The first hdr_len bytes of the transfer are stored in pHdr and the
+  *         rest goes straight to pBuf, so the payload of large writes can be
+  *         processed in place. HAL_PCD_EP_GetRxCount() returns the header and
+  *         payload bytes together. Slave mode, non-control endpoints only.
+  *         The endpoint takes whole packets: bytes a host sends beyond
+  *         hdr_len + len are dropped and not counted.
+  * @param  hpcd PCD handle
+  * @param  ep_addr endpoint address
+  * @param  pHdr pointer to the header buffer
+  * @param  hdr_len header length
+  * @param  pBuf pointer to the payload buffer
+  * @param  len payload buffer length
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_PCD_EP_ReceiveSplit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr,
+                                          uint8_t *pHdr, uint32_t hdr_len,
+                                          uint8_t *pBuf, uint32_t len)
+{
+  PCD_EPTypeDef *ep;
+
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  if ((pHdr == NULL) || (hdr_len == 0U) || ((ep_addr & EP_ADDR_MSK) == 0U) ||
+      (hpcd->Init.dma_enable == 1U))
+  {
+    return HAL_ERROR;
+  }
+
+  ep = &hpcd->OUT_ep[ep_addr & EP_ADDR_MSK];
+
+  /*setup and start the Xfer */
+  ep->xfer_buff = pBuf;
+  ep->xfer_len = hdr_len + len;
+  ep->xfer_count = 0U;
+  ep->xfer_hdr = pHdr;
+  ep->xfer_hdr_len = hdr_len;
+  ep->is_in = 0U;
+  ep->num = ep_addr & EP_ADDR_MSK;
+
+  (void)USB_EPStartXfer(hpcd->Instance, ep, 0U);
+
+  return HAL_OK;
+}
+
 /**
   * @brief  Get Received Data Size
   * @param  hpcd PCD handle
@@ -1793,6 +1881,11 @@ HAL_StatusTypeDef HAL_PCD_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, u
   */
 uint32_t HAL_PCD_EP_GetRxCount(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
 {
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return 0U;
+  }
+
   return hpcd->OUT_ep[ep_addr & EP_ADDR_MSK].xfer_count;
 }
 /**
@@ -1807,12 +1900,18 @@ HAL_StatusTypeDef HAL_PCD_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr,
 {
   PCD_EPTypeDef *ep;
 
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return HAL_ERROR;
+  }
+
   ep = &hpcd->IN_ep[ep_addr & EP_ADDR_MSK];
 
   /*setup and start the Xfer */
   ep->xfer_buff = pBuf;
   ep->xfer_len = len;
   ep->xfer_count = 0U;
+  ep->xfer_seg = NULL;
   ep->is_in = 1U;
   ep->num = ep_addr & EP_ADDR_MSK;
 
@@ -1828,6 +1927,72 @@ HAL_StatusTypeDef HAL_PCD_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr,
   else
   {
     (void)USB_EPStartXfer(hpcd->Instance, ep, (uint8_t)hpcd->Init.dma_enable);
+
+    if ((hpcd->TxFifoPrefill != 0U) && (hpcd->Init.dma_enable == 0U) &&
+        (ep->type != EP_TYPE_ISOC) && (len != 0U))
+    {
+      PCD_PrefillTxFifo(hpcd, ep->num);
+    }
+  }
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Send a chain of buffers as a single IN transfer.
+  * @note   The segments are gathered packet by packet while the Tx FIFO is
+  *         filled, so headers, payload slices and trailers do not need to be
+  *         copied into one contiguous buffer. The segment list and the data it
+  *         points to must stay valid until the Data IN stage callback.
+  *         Only available in slave mode on non-control, non-isochronous
+  *         endpoints.
+  * @param  hpcd PCD handle
+  * @param  ep_addr endpoint address
+  * @param  pSeg pointer to the segment list
+  * @param  SegNum number of segments in the list
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_PCD_EP_TransmitSeg(PCD_HandleTypeDef *hpcd, uint8_t ep_addr,
+                                         const PCD_SegTypeDef *pSeg, uint32_t SegNum)
+{
+  PCD_EPTypeDef *ep;
+  uint32_t len = 0U;
+  uint32_t i;
+
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  ep = &hpcd->IN_ep[ep_addr & EP_ADDR_MSK];
+
+  if ((pSeg == NULL) || (SegNum == 0U) || ((ep_addr & EP_ADDR_MSK) == 0U) ||
+      (hpcd->Init.dma_enable == 1U) || (ep->type == EP_TYPE_ISOC))
+  {
+    return HAL_ERROR;
+  }
+
+  for (i = 0U; i < SegNum; i++)
+  {
+    len += pSeg[i].len;
+  }
+
+  /*setup and start the Xfer */
+  ep->xfer_buff = pSeg[0].pbuf;
+  ep->xfer_len = len;
+  ep->xfer_count = 0U;
+  ep->xfer_seg = pSeg;
+  ep->xfer_seg_num = SegNum;
+  ep->xfer_seg_idx = 0U;
+  ep->xfer_seg_off = 0U;
+  ep->is_in = 1U;
+  ep->num = ep_addr & EP_ADDR_MSK;
+
+  (void)USB_EPStartXfer(hpcd->Instance, ep, 0U);
+
+  if ((hpcd->TxFifoPrefill != 0U) && (len != 0U))
+  {
+    PCD_PrefillTxFifo(hpcd, ep->num);
   }
 
   return HAL_OK;
@@ -1843,7 +2008,7 @@ HAL_StatusTypeDef HAL_PCD_EP_SetStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
 {
   PCD_EPTypeDef *ep;
 
-  if (((uint32_t)ep_addr & EP_ADDR_MSK) > hpcd->Init.dev_endpoints)
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
   {
     return HAL_ERROR;
   }
@@ -1855,7 +2020,7 @@ HAL_StatusTypeDef HAL_PCD_EP_SetStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
   }
   else
   {
-    ep = &hpcd->OUT_ep[ep_addr];
+    ep = &hpcd->OUT_ep[ep_addr & EP_ADDR_MSK];
     ep->is_in = 0U;
   }
 
@@ -1886,7 +2051,7 @@ HAL_StatusTypeDef HAL_PCD_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
 {
   PCD_EPTypeDef *ep;
 
-  if (((uint32_t)ep_addr & 0x0FU) > hpcd->Init.dev_endpoints)
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
   {
     return HAL_ERROR;
   }
@@ -1920,12 +2085,22 @@ HAL_StatusTypeDef HAL_PCD_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
    */
 HAL_StatusTypeDef HAL_PCD_EP_Abort(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
 {
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t USBx_BASE = (uint32_t)USBx;
   HAL_StatusTypeDef ret;
   PCD_EPTypeDef *ep;
 
+  if (PCD_EP_IS_VALID(ep_addr) == 0U)
+  {
+    return HAL_ERROR;
+  }
+
   if ((0x80U & ep_addr) == 0x80U)
   {
     ep = &hpcd->IN_ep[ep_addr & EP_ADDR_MSK];
+
+    /* No more Tx FIFO refills for the aborted transfer */
+    USBx_DEVICE->DIEPEMPMSK &= ~(0x1UL << (ep_addr & EP_ADDR_MSK));
   }
   else
   {
@@ -2065,6 +2240,7 @@ static HAL_StatusTypeDef PCD_WriteEmptyTxFifo(PCD_HandleTypeDef *hpcd, uint32_t
   uint32_t len;
   uint32_t len32b;
   uint32_t fifoemptymsk;
+  uint32_t fifosize;
 
   ep = &hpcd->IN_ep[epnum];
 
@@ -2073,6 +2249,18 @@ static HAL_StatusTypeDef PCD_WriteEmptyTxFifo(PCD_HandleTypeDef *hpcd, uint32_t
     return HAL_ERROR;
   }
 
+  /* A FIFO found completely drained in the middle of a transfer means the
+     endpoint has been NAKing the host since the last refill */
+  if ((ep->xfer_count != 0U) && (ep->xfer_count < ep->xfer_len))
+  {
+    fifosize = (epnum == 0U) ? (USBx->DIEPTXF0_HNPTXFSIZ >> 16) : (USBx->DIEPTXF[epnum - 1U] >> 16);
+
+    if ((USBx_INEP(epnum)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV) >= fifosize)
+    {
+      hpcd->TxFifoStats[epnum].starved++;
+    }
+  }
+
   len = ep->xfer_len - ep->xfer_count;
 
   if (len > ep->maxpacket)
@@ -2094,10 +2282,17 @@ static HAL_StatusTypeDef PCD_WriteEmptyTxFifo(PCD_HandleTypeDef *hpcd, uint32_t
     }
     len32b = (len + 3U) / 4U;
 
-    (void)USB_WritePacket(USBx, ep->xfer_buff, (uint8_t)epnum, (uint16_t)len,
-                          (uint8_t)hpcd->Init.dma_enable);
+    if (ep->xfer_seg != NULL)
+    {
+      PCD_WriteSegPacket(hpcd, ep, epnum, len);
+    }
+    else
+    {
+      (void)USB_WritePacket(USBx, ep->xfer_buff, (uint8_t)epnum, (uint16_t)len,
+                            (uint8_t)hpcd->Init.dma_enable);
 
-    ep->xfer_buff  += len;
+      ep->xfer_buff  += len;
+    }
     ep->xfer_count += len;
   }
 
@@ -2111,6 +2306,180 @@ static HAL_StatusTypeDef PCD_WriteEmptyTxFifo(PCD_HandleTypeDef *hpcd, uint32_t
 }
 
 
+/**
+  * @brief  Gather one packet from the segment list into the Tx FIFO.
+  * @note   Whole words are copied straight from each segment; only the bytes
+  *         of a word that straddles two segments are assembled by hand.
+  * @param  hpcd PCD handle
+  * @param  ep endpoint structure
+  * @param  epnum endpoint number
+  * @param  len packet length
+  * @retval None
+  */
+static void PCD_WriteSegPacket(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep, uint32_t epnum, uint32_t len)
+{
+  uint32_t USBx_BASE = (uint32_t)hpcd->Instance;
+  const PCD_SegTypeDef *seg;
+  uint8_t *pSrc;
+  uint32_t chunk;
+  uint32_t word = 0U;
+  uint32_t nbytes = 0U;
+
+  while ((len != 0U) && (ep->xfer_seg_idx < ep->xfer_seg_num))
+  {
+    seg = &ep->xfer_seg[ep->xfer_seg_idx];
+    chunk = PCD_MIN(seg->len - ep->xfer_seg_off, len);
+    pSrc = seg->pbuf + ep->xfer_seg_off;
+
+    len -= chunk;
+    ep->xfer_seg_off += chunk;
+
+    /* Complete the word left over by the previous segment */
+    while ((nbytes != 0U) && (chunk != 0U))
+    {
+      word |= (uint32_t)(*pSrc) << (8U * nbytes);
+      pSrc++;
+      chunk--;
+      nbytes++;
+
+      if (nbytes == 4U)
+      {
+        USBx_DFIFO(epnum) = word;
+        word = 0U;
+        nbytes = 0U;
+      }
+    }
+
+    while (chunk >= 4U)
+    {
+      USBx_DFIFO(epnum) = __UNALIGNED_UINT32_READ(pSrc);
+      pSrc += 4U;
+      chunk -= 4U;
+    }
+
+    /* Keep the tail for the next segment */
+    while (chunk != 0U)
+    {
+      word |= (uint32_t)(*pSrc) << (8U * nbytes);
+      pSrc++;
+      chunk--;
+      nbytes++;
+    }
+
+    if (ep->xfer_seg_off >= seg->len)
+    {
+      ep->xfer_seg_idx++;
+      ep->xfer_seg_off = 0U;
+    }
+  }
+
+  if (nbytes != 0U)
+  {
+    USBx_DFIFO(epnum) = word;
+  }
+}
+
+/**
+  * @brief  Read one OUT packet of a split receive.
+  * @note   Leading bytes go to the header buffer until it is full, the word
+  *         straddling the header/payload boundary is split by hand and the
+  *         rest is read into the payload with USB_ReadPacket. The endpoint
+  *         accepts whole packets, so a host may send more than hdr_len + len
+  *         bytes: what does not fit in the payload buffer is read from the
+  *         FIFO and dropped.
+  * @param  hpcd PCD handle
+  * @param  ep endpoint structure
+  * @param  len packet length
+  * @retval None
+  */
+static void PCD_ReadSplitPacket(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep, uint32_t len)
+{
+  uint32_t USBx_BASE = (uint32_t)hpcd->Instance;
+  uint8_t *pHdr = ep->xfer_hdr + ep->xfer_count;
+  uint32_t words = (len + 3U) / 4U;
+  uint32_t hdrbytes = 0U;
+  uint32_t room = 0U;
+  uint32_t nbytes;
+  uint32_t word;
+  uint32_t i;
+
+  if (ep->xfer_count < ep->xfer_hdr_len)
+  {
+    hdrbytes = PCD_MIN(ep->xfer_hdr_len - ep->xfer_count, len);
+  }
+  if ((ep->xfer_count + hdrbytes) < ep->xfer_len)
+  {
+    room = ep->xfer_len - (ep->xfer_count + hdrbytes);
+  }
+
+  /* Payload bytes that fit, the rest of the packet is drained below */
+  len = PCD_MIN(len - hdrbytes, room);
+
+  while (hdrbytes >= 4U)
+  {
+    __UNALIGNED_UINT32_WRITE(pHdr, USBx_DFIFO(0U));
+    pHdr += 4U;
+    hdrbytes -= 4U;
+    words--;
+  }
+
+  if (hdrbytes != 0U)
+  {
+    word = USBx_DFIFO(0U);
+    words--;
+    nbytes = PCD_MIN(hdrbytes + len, 4U);
+
+    for (i = 0U; i < nbytes; i++)
+    {
+      if (i < hdrbytes)
+      {
+        *pHdr = (uint8_t)(word >> (8U * i));
+        pHdr++;
+      }
+      else
+      {
+        *ep->xfer_buff = (uint8_t)(word >> (8U * i));
+        ep->xfer_buff++;
+        len--;
+      }
+    }
+  }
+
+  if (len != 0U)
+  {
+    (void)USB_ReadPacket(hpcd->Instance, ep->xfer_buff, (uint16_t)len);
+    ep->xfer_buff += len;
+    words -= (len + 3U) / 4U;
+  }
+
+  while (words != 0U)
+  {
+    (void)USBx_DFIFO(0U);
+    words--;
+  }
+}
+
+/**
+  * @brief  Queue the first packets of a freshly started IN transfer.
+  * @note   The transfer may be started from thread mode while the TXFE
+  *         interrupt of the same endpoint is already enabled, so the FIFO is
+  *         written with interrupts masked to keep the packet order intact.
+  * @param  hpcd PCD handle
+  * @param  epnum endpoint number
+  * @retval None
+  */
+static void PCD_PrefillTxFifo(PCD_HandleTypeDef *hpcd, uint32_t epnum)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+
+  hpcd->TxFifoStats[epnum].prefills++;
+  (void)PCD_WriteEmptyTxFifo(hpcd, epnum);
+
+  __set_PRIMASK(primask);
+}
+
 /**
   * @brief  process EP OUT transfer complete interrupt.
   * @param  hpcd PCD handle
@@ -116,6 +116,56 @@ HAL_StatusTypeDef HAL_PCDEx_SetRxFiFo(PCD_HandleTypeDef *hpcd, uint16_t size)
   return HAL_OK;
 }
 
+/**
+  * @brief  Configure the Tx FIFO refill policy of the IN endpoints.
+  * @note   With PCD_TXFIFO_EMPTY_LVL_HALF, the reset value of TXFELVL, the
+  *         TXFE interrupt is raised while half of the FIFO is still queued.
+  * @param  hpcd PCD handle
+  * @param  EmptyLevel Tx FIFO empty interrupt threshold
+  *          This parameter can be one of the following values:
+  *            @arg PCD_TXFIFO_EMPTY_LVL_HALF
+  *            @arg PCD_TXFIFO_EMPTY_LVL_COMPLETE
+  * @param  Prefill ENABLE to queue the first packets of a transfer as soon as
+  *         it is started, DISABLE to wait for the first TXFE interrupt
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_PCDEx_ConfigTxFiFoRefill(PCD_HandleTypeDef *hpcd, uint32_t EmptyLevel, uint32_t Prefill)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+
+  if ((EmptyLevel != PCD_TXFIFO_EMPTY_LVL_HALF) && (EmptyLevel != PCD_TXFIFO_EMPTY_LVL_COMPLETE))
+  {
+    return HAL_ERROR;
+  }
+
+  USBx->GAHBCFG = (USBx->GAHBCFG & ~USB_OTG_GAHBCFG_TXFELVL) | EmptyLevel;
+  hpcd->TxFifoPrefill = (Prefill != 0U) ? 1U : 0U;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Service the pending core interrupts from thread mode.
+  * @note   For polled operation: the OTG IRQ is left disabled in the NVIC
+  *         and this is called from the main loop instead. Each pass handles
+  *         every source pending in GINTSTS, as HAL_PCD_IRQHandler does.
+  * @param  hpcd PCD handle
+  * @param  MaxPasses upper bound on handler passes, bounds the time spent
+  * @retval number of passes that found pending work, 0 when idle
+  */
+uint32_t HAL_PCDEx_Poll(PCD_HandleTypeDef *hpcd, uint32_t MaxPasses)
+{
+  uint32_t passes = 0U;
+
+  while ((passes < MaxPasses) && (USB_ReadInterrupts(hpcd->Instance) != 0U))
+  {
+    HAL_PCD_IRQHandler(hpcd);
+    passes++;
+  }
+
+  return passes;
+}
+
 /**
   * @brief  Activate LPM feature.
   * @param  hpcd PCD handle
@@ -49,6 +49,29 @@ extern "C" {
 #ifndef CDC_CMD_EP
 #define CDC_CMD_EP                                  0x82U  /* EP2 for CDC commands */
 #endif /* CDC_CMD_EP  */
+#ifndef CDC_IN2_EP
+#define CDC_IN2_EP                                  0x83U  /* EP3 for data IN of the second function */
+#endif /* CDC_IN2_EP */
+#ifndef CDC_OUT2_EP
+#define CDC_OUT2_EP                                 0x03U  /* EP3 for data OUT of the second function */
+#endif /* CDC_OUT2_EP */
+
+/* Independent bulk functions: 2 adds a second data interface (interface 0) */
+#ifndef USBD_CDC_FUNC_NUM
+#define USBD_CDC_FUNC_NUM                           1U
+#endif /* USBD_CDC_FUNC_NUM */
+#define CDC_FUNC_MAX                                2U
+
+#if (USBD_CDC_FUNC_NUM > CDC_FUNC_MAX) || (USBD_CDC_FUNC_NUM > USBD_MAX_SUPPORTED_CLASS)
+#error "USBD_CDC_FUNC_NUM exceeds the functions the class or USBD_MAX_SUPPORTED_CLASS can hold"
+#endif
+
+/* Time the per-function dispatch with the DWT cycle counter, a debug aid
+   that costs two counter reads per event; completions bound by
+   USBD_DIRECT_DISPATCH bypass it and are not counted */
+#ifndef CDC_DISPATCH_PROFILE
+#define CDC_DISPATCH_PROFILE                        0U
+#endif /* CDC_DISPATCH_PROFILE */
 
 #ifndef CDC_HS_BINTERVAL
 #define CDC_HS_BINTERVAL                            0x10U
@@ -58,12 +81,17 @@ extern "C" {
 #define CDC_FS_BINTERVAL                            0x10U
 #endif /* CDC_FS_BINTERVAL */
 
+/* Interrupt IN endpoint of CDC_ALT_BULK_INTR, polled every frame so a credit
+   reaches the host before its queued OUT data runs out */
+#ifndef CDC_NOTIFY_FS_BINTERVAL
+#define CDC_NOTIFY_FS_BINTERVAL                     0x01U
+#endif /* CDC_NOTIFY_FS_BINTERVAL */
+
 /* CDC Endpoints parameters: you can fine tune these values depending on the needed baudrates and performance. */
 #define CDC_DATA_HS_MAX_PACKET_SIZE                 512U  /* Endpoint IN & OUT Packet size */
 #define CDC_DATA_FS_MAX_PACKET_SIZE                 64U  /* Endpoint IN & OUT Packet size */
 #define CDC_CMD_PACKET_SIZE                         8U  /* Control Endpoint Packet size */
 
-#define USB_CDC_CONFIG_DESC_SIZ                     32U
 #define CDC_DATA_HS_IN_PACKET_SIZE                  CDC_DATA_HS_MAX_PACKET_SIZE
 #define CDC_DATA_HS_OUT_PACKET_SIZE                 CDC_DATA_HS_MAX_PACKET_SIZE
 
@@ -71,6 +99,70 @@ extern "C" {
 #define CDC_DATA_FS_OUT_PACKET_SIZE                 CDC_DATA_FS_MAX_PACKET_SIZE
 
 #define CDC_REQ_MAX_DATA_SIZE                       0x7U
+
+/* Alternate settings of the data interface */
+#define CDC_ALT_BULK                                0x00U  /* bulk IN/OUT, default */
+#define CDC_ALT_ISO_IN                              0x01U  /* isochronous IN, bulk OUT */
+#define CDC_ALT_LOW_POWER                           0x02U  /* bulk IN/OUT, small packets and FIFOs */
+#define CDC_ALT_BULK_INTR                           0x03U  /* bulk IN/OUT plus interrupt IN on CDC_CMD_EP */
+
+#define CDC_LP_FS_PACKET_SIZE                       16U
+
+#ifndef CDC_ISO_FS_IN_PACKET_SIZE
+#if (USBD_CDC_FUNC_NUM > 1U)
+#define CDC_ISO_FS_IN_PACKET_SIZE                   832U   /* leaves FIFO room for the second function */
+#else
+#define CDC_ISO_FS_IN_PACKET_SIZE                   1023U  /* one packet per 1 ms frame */
+#endif /* USBD_CDC_FUNC_NUM */
+#endif /* CDC_ISO_FS_IN_PACKET_SIZE */
+#define CDC_ISO_FS_TX_FIFO_SIZE                     ((CDC_ISO_FS_IN_PACKET_SIZE + 3U) / 4U)
+
+/*
+ * Alternate settings of the data interface of the first function. The
+ * configuration descriptor, USB_CDC_CONFIG_DESC_SIZ, the setting profiles
+ * and their FIFO checks are all generated from this table.
+ * X(alt, in_attr, in_mps, in_interval, out_mps, notify, rx_xfer,
+ *   rx_fifo, tx0_fifo, tx1_fifo, tx2_fifo)
+ *   in_attr:  bmAttributes of the IN endpoint, the OUT endpoint is bulk
+ *   notify:   literal 1 to add the interrupt IN endpoint CDC_CMD_EP, else 0
+ *   rx_xfer:  OUT transfer size, 0 for the tunable USBD_CDC_ParamsTypeDef one
+ *   *_fifo:   depths in 32-bit words, rx_fifo 0 for the tunable split
+ */
+#define CDC_ALT_TABLE(X) \
+  X(CDC_ALT_BULK,      0x02U, CDC_DATA_FS_MAX_PACKET_SIZE, 0x00U, CDC_DATA_FS_MAX_PACKET_SIZE, 0, \
+    0U, 0U, 0U, 0U, 0U) \
+  X(CDC_ALT_ISO_IN,    0x05U, CDC_ISO_FS_IN_PACKET_SIZE, 0x01U, CDC_DATA_FS_MAX_PACKET_SIZE, 0, \
+    CDC_DATA_FS_MAX_PACKET_SIZE, 0x30U, 0x10U, CDC_ISO_FS_TX_FIFO_SIZE, 0x00U) \
+  X(CDC_ALT_LOW_POWER, 0x02U, CDC_LP_FS_PACKET_SIZE, 0x00U, CDC_LP_FS_PACKET_SIZE, 0, \
+    CDC_LP_FS_PACKET_SIZE, 0x30U, 0x10U, 0x08U, 0x00U) \
+  X(CDC_ALT_BULK_INTR, 0x02U, CDC_DATA_FS_MAX_PACKET_SIZE, 0x00U, CDC_DATA_FS_MAX_PACKET_SIZE, 1, \
+    0U, (0x80U - USBD_FS_TX3_FIFO_SIZE), 0x20U, 0x80U, 0x10U)
+
+/*
+ * Bulk functions after the first one, each a single-setting data interface.
+ * F(func, itf, in_ep, out_ep)
+ */
+#if (USBD_CDC_FUNC_NUM > 1U)
+#define CDC_FUNC_TABLE(F) \
+  F(1U, 0x00U, CDC_IN2_EP, CDC_OUT2_EP)
+#else
+#define CDC_FUNC_TABLE(F)
+#endif /* USBD_CDC_FUNC_NUM */
+
+#define CDC_ALT_COUNT(alt, ...)                     + 1U
+#define CDC_ALT_DESC_SIZ(alt, in_attr, in_mps, in_interval, out_mps, notify, ...) \
+  + (9U + 14U + (7U * (notify)))
+#define CDC_FUNC_DESC_SIZ(func, ...)                + (9U + 14U)
+
+#define CDC_ALT_NUM                                 (0U CDC_ALT_TABLE(CDC_ALT_COUNT))
+#define USB_CDC_CONFIG_DESC_SIZ                     (9U CDC_ALT_TABLE(CDC_ALT_DESC_SIZ) \
+                                                     CDC_FUNC_TABLE(CDC_FUNC_DESC_SIZ))
+
+
+/* Largest OUT transfer the Rx buffer handed to USBD_CDC_SetRxBuffer can take */
+#ifndef CDC_RX_XFER_MAX_SIZE
+#define CDC_RX_XFER_MAX_SIZE                        2048U
+#endif /* CDC_RX_XFER_MAX_SIZE */
 /*---------------------------------------------------------------------*/
 /*  CDC definitions                                                    */
 /*---------------------------------------------------------------------*/
@@ -84,6 +176,27 @@ extern "C" {
 #define CDC_SET_CONTROL_LINE_STATE                  0x22U
 #define CDC_SEND_BREAK                              0x23U
 
+/*---------------------------------------------------------------------*/
+/*  Vendor requests                                                    */
+/*---------------------------------------------------------------------*/
+#define CDC_VENDOR_GET_PARAMS                       0x01U  /* wValue 0: active set, 1: pending set */
+#define CDC_VENDOR_SET_PARAMS                       0x02U  /* applied on the next SetConfiguration */
+#define CDC_VENDOR_GET_STATS                        0x03U  /* USBD_CDC_StatsTypeDef snapshot */
+#define CDC_VENDOR_GET_MEMORY                       0x04U  /* memory report, filled by CDC_CTRL_GET_MEMORY */
+#define CDC_VENDOR_GET_CREDIT                       0x05U  /* USBD_CDC_CreditTypeDef, the current grant */
+#define CDC_VENDOR_GET_LOG                          0x06U  /* binary log records, filled by CDC_CTRL_GET_LOG */
+
+/* Type of the messages on the interrupt IN endpoint */
+#define CDC_NOTIFY_CREDIT                           0xC1U  /* USBD_CDC_CreditTypeDef */
+
+/* Interface Control codes past the class requests */
+#define CDC_CTRL_GET_MEMORY                         0xF0U  /* fill pbuf with the application memory report */
+#define CDC_CTRL_GET_LOG                            0xF1U  /* fill pbuf with whole log records, zero padded */
+
+/* Set in the TransmitCplt epnum when the transfer was dropped, not sent:
+   endpoint halt cleared by the host, alternate setting change or reset */
+#define CDC_TX_ABORTED                              0x80U
+
 /**
   * @}
   */
@@ -114,20 +227,107 @@ typedef struct _USBD_CDC_Itf
 } USBD_CDC_ItfTypeDef;
 
 
+/*
+ * Credit message, sent on the interrupt IN endpoint of CDC_ALT_BULK_INTR when
+ * the grant grows and returned by CDC_VENDOR_GET_CREDIT, little endian. One
+ * credit is one OUT transfer of at most XferSize bytes that the device has a
+ * free buffer for. The host counts its OUT transfers since SetConfiguration
+ * and only submits one while the count is below Granted, so it never polls
+ * an OUT endpoint that is not armed. Change settings with the OUT pipe idle.
+ */
 typedef struct
 {
-  uint32_t data[CDC_DATA_HS_MAX_PACKET_SIZE / 4U];      /* Force 32-bit alignment */
-  uint8_t  CmdOpCode;
-  uint8_t  CmdLength;
-  uint8_t  *RxBuffer;
-  uint8_t  *TxBuffer;
-  uint32_t RxLength;
-  uint32_t TxLength;
+  uint8_t  Type;            /* CDC_NOTIFY_CREDIT */
+  uint8_t  Reserved;
+  uint16_t XferSize;        /* largest OUT transfer one credit covers */
+  uint32_t Granted;         /* OUT transfers granted since SetConfiguration, wraps */
+} USBD_CDC_CreditTypeDef;
 
+typedef struct
+{
+  /* Data path, touched on every transfer: first cache line */
   __IO uint32_t TxState;
   __IO uint32_t RxState;
+  uint8_t  *TxBuffer;
+  uint32_t TxLength;
+  uint8_t  *RxBuffer;
+  uint32_t RxLength;
+  uint32_t RxXferSize;      /* OUT bytes per receive for the current alternate setting */
+  uint32_t TxOffset;        /* isochronous mode: bytes of TxBuffer already sent */
+  uint32_t TxChunk;         /* isochronous mode: size of the packet in flight */
+  uint8_t  *RxHdrBuffer;
+  uint32_t RxHdrLength;
+  uint32_t RxPayloadSize;
+  uint8_t  AltSetting;
+  __IO uint8_t NotifyState; /* interrupt IN transfer in progress */
+
+  /* Credit flow control, see USBD_CDC_CreditTypeDef */
+  __IO uint32_t CreditGranted;
+  uint32_t CreditSent;      /* Granted of the last message sent */
+  USBD_CDC_CreditTypeDef CreditMsg;
+
+  /* Control requests */
+  uint8_t  CmdOpCode;
+  uint8_t  CmdLength;
+  uint8_t  CmdType;
+  uint32_t data[CDC_DATA_HS_MAX_PACKET_SIZE / 4U];      /* Force 32-bit alignment */
 } USBD_CDC_HandleTypeDef;
 
+/* Endpoint and FIFO profile of one alternate setting of the data interface */
+typedef struct
+{
+  uint8_t  InType;          /* USBD_EP_TYPE_BULK or USBD_EP_TYPE_ISOC */
+  uint8_t  NotifyEp;        /* 1 if the interrupt IN endpoint is part of the setting */
+  uint16_t InMps;
+  uint16_t OutMps;
+  uint16_t RxXferSize;      /* 0: use the tunable USBD_CDC_ParamsTypeDef value */
+  uint16_t RxFifoSize;      /* FIFO depths in 32-bit words, RxFifoSize 0: use the */
+  uint16_t Tx0FifoSize;     /* tunable USBD_CDC_ParamsTypeDef split */
+  uint16_t Tx1FifoSize;
+  uint16_t Tx2FifoSize;
+} USBD_CDC_AltTypeDef;
+
+/* Transport parameters exchanged by CDC_VENDOR_GET/SET_PARAMS, little endian */
+typedef struct
+{
+  uint16_t RxXferSize;      /* OUT bytes collected per receive, multiple of the packet size */
+  uint16_t RxFifoSize;      /* Rx FIFO depth in 32-bit words */
+  uint16_t Tx0FifoSize;     /* EP0 Tx FIFO depth in 32-bit words */
+  uint16_t Tx1FifoSize;     /* data IN Tx FIFO depth in 32-bit words */
+  uint8_t  TxFifoEmptyLvl;  /* 0: refill at half empty (reset value), 1: when empty */
+  uint8_t  TxFifoPrefill;   /* 1: queue packets as soon as a transfer starts */
+  uint16_t Reserved;
+} USBD_CDC_ParamsTypeDef;
+
+typedef struct
+{
+  uint32_t Bytes;
+  uint32_t Packets;
+  uint32_t ShortPackets;
+  uint32_t Zlps;
+  uint32_t NakGaps;         /* transfer completed with nothing queued behind it */
+  uint32_t Overflows;       /* OUT data refused by the application */
+  uint32_t IsoIncomplete;   /* isochronous packets missed their frame */
+} USBD_CDC_EpStatsTypeDef;
+
+typedef struct
+{
+  __IO uint32_t Seq;        /* odd while the USB interrupt updates In/Out */
+  USBD_CDC_EpStatsTypeDef In;
+  USBD_CDC_EpStatsTypeDef Out;
+  __IO uint32_t TxBusy;     /* transmit requests rejected with USBD_BUSY, any context */
+  uint32_t DispatchCycles;  /* last DataIn/DataOut function lookup, in CPU cycles */
+  uint32_t DispatchMax;     /* worst function lookup */
+  uint32_t HandlerMax;      /* worst DataIn/DataOut handler run after the lookup */
+} USBD_CDC_StatsTypeDef;
+
+typedef struct
+{
+  uint32_t InResync;      /* IN endpoint resynchronisations */
+  uint32_t OutResync;     /* OUT endpoint resynchronisations */
+  uint32_t AbortErrors;   /* endpoint disable timed out during an abort */
+} USBD_CDC_RecoveryTypeDef;
+
 
 
 /** @defgroup USBD_CORE_Exported_Macros
@@ -163,8 +363,25 @@ uint8_t USBD_CDC_SetTxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff,
                              uint32_t length);
 uint8_t USBD_CDC_TransmitPacket(USBD_HandleTypeDef *pdev);
 #endif /* USE_USBD_COMPOSITE */
+uint8_t USBD_CDC_TransmitSeg(USBD_HandleTypeDef *pdev, const USBD_SegTypeDef *pSeg,
+                             uint32_t SegNum);
 uint8_t USBD_CDC_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff);
+uint8_t USBD_CDC_SetRxSplitBuffer(USBD_HandleTypeDef *pdev, uint8_t *phdr, uint32_t hdr_length,
+                                  uint8_t *pbuff, uint32_t length);
 uint8_t USBD_CDC_ReceivePacket(USBD_HandleTypeDef *pdev);
+uint8_t USBD_CDC_ResetEndpoints(USBD_HandleTypeDef *pdev);
+uint8_t USBD_CDC_RegisterFuncInterface(USBD_HandleTypeDef *pdev, uint8_t func,
+                                       USBD_CDC_ItfTypeDef *fops);
+uint8_t USBD_CDC_TransmitFunc(USBD_HandleTypeDef *pdev, uint8_t func, uint8_t *pbuf,
+                              uint32_t length);
+uint8_t USBD_CDC_ReceiveFunc(USBD_HandleTypeDef *pdev, uint8_t func, uint8_t *pbuf);
+uint8_t USBD_CDC_SendNotify(USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint16_t length);
+uint8_t USBD_CDC_GrantCredit(USBD_HandleTypeDef *pdev, uint32_t count);
+uint8_t USBD_CDC_GrantCreditFunc(USBD_HandleTypeDef *pdev, uint8_t func, uint32_t count);
+const USBD_CDC_RecoveryTypeDef *USBD_CDC_GetRecoveryStats(void);
+const USBD_CDC_ParamsTypeDef *USBD_CDC_GetParams(void);
+void USBD_CDC_GetStats(USBD_CDC_StatsTypeDef *pStats);
+void USBD_CDC_CountTxBusy(void);
 /**
   * @}
   */
@@ -109,9 +109,30 @@ static uint8_t  USBD_CDC_DeInit (USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
 static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t  USBD_CDC_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t  USBD_CDC_InitFunc(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t  USBD_CDC_DeInitFunc(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t  USBD_CDC_SetupFunc(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t  USBD_CDC_DataInFunc(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t  USBD_CDC_DataOutFunc(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint32_t USBD_CDC_FuncFromEP(uint8_t epnum);
+static uint32_t USBD_CDC_FuncFromReq(const USBD_SetupReqTypedef *req);
+static void USBD_CDC_Profile(uint32_t dispatch, uint32_t handler);
 static uint8_t  USBD_CDC_EP0_RxReady (USBD_HandleTypeDef *pdev);
 static uint8_t  *USBD_CDC_GetFSCfgDesc (uint16_t *length);
 uint8_t  *USBD_CDC_GetDeviceQualifierDescriptor (uint16_t *length);
+static void USBD_CDC_ResyncEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+static void USBD_CDC_TxAbort(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc);
+static USBD_StatusTypeDef USBD_CDC_VendorSetup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t USBD_CDC_CheckParams(const USBD_CDC_ParamsTypeDef *params);
+static void USBD_CDC_CountXfer(USBD_CDC_EpStatsTypeDef *stats, uint32_t length,
+                               uint32_t xfer_size, uint32_t mps);
+static uint8_t USBD_CDC_IsoINIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static USBD_StatusTypeDef USBD_CDC_SetAlt(USBD_HandleTypeDef *pdev, uint8_t alt);
+static USBD_StatusTypeDef USBD_CDC_OpenAlt(USBD_HandleTypeDef *pdev, const USBD_CDC_AltTypeDef *prof);
+static void USBD_CDC_IsoInNext(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc);
+static void USBD_CDC_TxComplete(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc,
+                                uint8_t epnum, uint32_t xfer_size);
+static void USBD_CDC_SendCredit(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc, uint8_t force);
 
 /* USB Standard Device Descriptor */
 __ALIGN_BEGIN static uint8_t USBD_CDC_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END =
@@ -148,7 +169,7 @@ USBD_ClassTypeDef  USBD_CDC =
   USBD_CDC_DataIn,
   USBD_CDC_DataOut,
   NULL,
-  NULL,
+  USBD_CDC_IsoINIncomplete,
   NULL,
   NULL,
   USBD_CDC_GetFSCfgDesc,
@@ -156,56 +177,140 @@ USBD_ClassTypeDef  USBD_CDC =
   USBD_CDC_GetDeviceQualifierDescriptor,
 };
 
+/* Descriptor blocks expanded from CDC_ALT_TABLE and CDC_FUNC_TABLE */
+#define CDC_ITF_DESC(itf, alt, neps) \
+  0x09U, USB_DESC_TYPE_INTERFACE, (itf), (alt), (neps), 0x0AU, 0x00U, 0x00U, 0x00U,
+#define CDC_EP_DESC(addr, attr, mps, interval) \
+  0x07U, USB_DESC_TYPE_ENDPOINT, (addr), (attr), LOBYTE(mps), HIBYTE(mps), (interval),
+#define CDC_NOTIFY_DESC_0
+#define CDC_NOTIFY_DESC_1 \
+  CDC_EP_DESC(CDC_CMD_EP, 0x03U, CDC_CMD_PACKET_SIZE, CDC_NOTIFY_FS_BINTERVAL)
+#define CDC_ALT_DESC(alt, in_attr, in_mps, in_interval, out_mps, notify, ...) \
+  CDC_ITF_DESC(0x01U, (alt), (2U + (notify))) \
+  CDC_EP_DESC(CDC_OUT_EP, 0x02U, (out_mps), 0x00U) \
+  CDC_EP_DESC(CDC_IN_EP, (in_attr), (in_mps), (in_interval)) \
+  CDC_NOTIFY_DESC_##notify
+#define CDC_FUNC_DESC(func, itf, in_ep, out_ep) \
+  CDC_ITF_DESC((itf), 0x00U, 2U) \
+  CDC_EP_DESC((out_ep), 0x02U, CDC_DATA_FS_MAX_PACKET_SIZE, 0x00U) \
+  CDC_EP_DESC((in_ep), 0x02U, CDC_DATA_FS_MAX_PACKET_SIZE, 0x00U)
+
+#if (USBD_REMOTE_WAKEUP_ENABLED == 1U)
+#define CDC_CFG_ATTRIBUTES  0xE0U   /* self powered, remote wakeup */
+#else
+#define CDC_CFG_ATTRIBUTES  0xC0U   /* self powered */
+#endif /* USBD_REMOTE_WAKEUP_ENABLED */
+
 /* USB CDC device Configuration Descriptor */
-//__ALIGN_BEGIN uint8_t USBD_CDC_CfgFSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN_END =
 __ALIGN_BEGIN static uint8_t USBD_CDC_CfgDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN_END =
 {
   /*Configuration Descriptor*/
   0x09,   /* bLength: Configuration Descriptor size */
   USB_DESC_TYPE_CONFIGURATION,      /* bDescriptorType: Configuration */
-  USB_CDC_CONFIG_DESC_SIZ,                /* wTotalLength:no of returned bytes */
-  0x00,
-  0x01,   /* bNumInterfaces: 1 interface */
+  LOBYTE(USB_CDC_CONFIG_DESC_SIZ),  /* wTotalLength:no of returned bytes */
+  HIBYTE(USB_CDC_CONFIG_DESC_SIZ),
+  USBD_CDC_FUNC_NUM,   /* bNumInterfaces: one data interface per function */
   0x01,   /* bConfigurationValue: Configuration value */
   0x00,   /* iConfiguration: Index of string descriptor describing the configuration */
-  0xC0,   /* bmAttributes: self powered */
+  CDC_CFG_ATTRIBUTES,   /* bmAttributes */
   0x32,   /* MaxPower 0 mA */
 
-  /*---------------------------------------------------------------------------*/
-
-  /*Data class interface descriptor*/
-  0x09,   /* bLength: Endpoint Descriptor size */
-  USB_DESC_TYPE_INTERFACE,  /* bDescriptorType: */
-  0x01,   /* bInterfaceNumber: Number of Interface */
-  0x00,   /* bAlternateSetting: Alternate setting */
-  0x02,   /* bNumEndpoints: Two endpoints used */
-  0x0A,   /* bInterfaceClass: CDC */
-  0x00,   /* bInterfaceSubClass: */
-  0x00,   /* bInterfaceProtocol: */
-  0x00,   /* iInterface: */
-
-  /*Endpoint OUT Descriptor*/
-  0x07,   /* bLength: Endpoint Descriptor size */
-  USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-  CDC_OUT_EP,                        /* bEndpointAddress */
-  0x02,                              /* bmAttributes: Bulk */
-  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),  /* wMaxPacketSize: */
-  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-  0x00,                              /* bInterval: ignore for Bulk transfer */
-
-  /*Endpoint IN Descriptor*/
-  0x07,   /* bLength: Endpoint Descriptor size */
-  USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-  CDC_IN_EP,                         /* bEndpointAddress */
-  0x02,                              /* bmAttributes: Bulk */
-  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),  /* wMaxPacketSize: */
-  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-  0x00                               /* bInterval: ignore for Bulk transfer */
-} ;
-
-static uint8_t CDCInEpAdd = CDC_IN_EP;
-static uint8_t CDCOutEpAdd = CDC_OUT_EP;
-static uint8_t CDCCmdEpAdd = CDC_CMD_EP;
+  /*Data class interface of the first function, one block per alternate setting*/
+  CDC_ALT_TABLE(CDC_ALT_DESC)
+
+  /*Data class interfaces of the other functions*/
+  CDC_FUNC_TABLE(CDC_FUNC_DESC)
+};
+
+/* Every FIFO of a fixed profile must pass the USBD_LL_SetFifoLayout
+   minimums and hold a packet of its endpoint, and the profile the packet
+   RAM left by the EP3 Tx FIFO */
+#define CDC_ALT_FIFO_BAD(alt, in_attr, in_mps, in_interval, out_mps, notify, rx_xfer, \
+                         rx_fifo, tx0_fifo, tx1_fifo, tx2_fifo) \
+  || (((rx_fifo) != 0U) && \
+      (((rx_fifo) < USBD_FS_RX_FIFO_MIN_SIZE) || ((tx0_fifo) < USBD_FS_TX0_FIFO_MIN_SIZE) || \
+       ((tx1_fifo) < USBD_FS_TX_FIFO_MIN_SIZE) || (((tx1_fifo) * 4U) < (in_mps)) || \
+       (((tx2_fifo) * 4U) < ((notify) * CDC_CMD_PACKET_SIZE)) || \
+       (((rx_fifo) + (tx0_fifo) + (tx1_fifo) + (tx2_fifo) + USBD_FS_TX3_FIFO_SIZE) > \
+        USBD_FS_FIFO_TOTAL_SIZE)))
+
+#if (0 CDC_ALT_TABLE(CDC_ALT_FIFO_BAD))
+#error "CDC_ALT_TABLE: a FIFO profile does not fit its packets or the packet RAM"
+#endif
+
+/* The device and PCD handles only keep USBD_MAX_EP_NUM endpoints */
+#define CDC_FUNC_EP_BAD(func, itf, in_ep, out_ep) \
+  || (((in_ep) & 0xFU) >= USBD_MAX_EP_NUM) || (((out_ep) & 0xFU) >= USBD_MAX_EP_NUM)
+
+#if ((CDC_CMD_EP & 0xFU) >= USBD_MAX_EP_NUM) || (0 CDC_FUNC_TABLE(CDC_FUNC_EP_BAD))
+#error "CDC_FUNC_TABLE: an endpoint is past USBD_MAX_EP_NUM"
+#endif
+
+/* Interface and endpoints of each function, indexed by pdev->classId. The
+   other functions have no notification endpoint of their own and share EP2 */
+#define CDC_FUNC_ITF(func, itf, in_ep, out_ep)      [(func)] = (itf),
+#define CDC_FUNC_IN(func, itf, in_ep, out_ep)       [(func)] = (in_ep),
+#define CDC_FUNC_OUT(func, itf, in_ep, out_ep)      [(func)] = (out_ep),
+#define CDC_FUNC_CMD(func, itf, in_ep, out_ep)      [(func)] = CDC_CMD_EP,
+#define CDC_FUNC_EP(func, itf, in_ep, out_ep) \
+  [(in_ep) & 0xFU] = (func), [(out_ep) & 0xFU] = (func),
+
+static const uint8_t CDCItfNum[CDC_FUNC_MAX] = { 0x01U, CDC_FUNC_TABLE(CDC_FUNC_ITF) };
+static uint8_t CDCInEpAdd[CDC_FUNC_MAX] = { CDC_IN_EP, CDC_FUNC_TABLE(CDC_FUNC_IN) };
+static uint8_t CDCOutEpAdd[CDC_FUNC_MAX] = { CDC_OUT_EP, CDC_FUNC_TABLE(CDC_FUNC_OUT) };
+static uint8_t CDCCmdEpAdd[CDC_FUNC_MAX] = { CDC_CMD_EP, CDC_FUNC_TABLE(CDC_FUNC_CMD) };
+
+/* Function owning each endpoint number, the first one by default */
+static const uint8_t CDCEpFunc[16] = { 0U, CDC_FUNC_TABLE(CDC_FUNC_EP) };
+
+/* Profiles of the data interface alternate settings, indexed by bAlternateSetting */
+#define CDC_ALT_PROFILE(alt, in_attr, in_mps, in_interval, out_mps, notify, rx_xfer, \
+                        rx_fifo, tx0_fifo, tx1_fifo, tx2_fifo) \
+  [(alt)] = { ((in_attr) & 0x03U), (notify), (in_mps), (out_mps), (rx_xfer), \
+              (rx_fifo), (tx0_fifo), (tx1_fifo), (tx2_fifo) },
+
+static const USBD_CDC_AltTypeDef USBD_CDC_AltTable[CDC_ALT_NUM] =
+{
+  CDC_ALT_TABLE(CDC_ALT_PROFILE)
+};
+
+/* Kept outside the class handle so the counts survive a re-configuration */
+static USBD_CDC_RecoveryTypeDef USBD_CDC_Recovery;
+
+/* In/Out are written from the USB interrupt only, bracketed by Seq;
+   TxBusy is a word on its own, updated with LDREX/STREX from any context */
+static USBD_CDC_StatsTypeDef USBD_CDC_Stats;
+
+#define CDC_STATS_BEGIN()  USBD_SEQ_BEGIN(USBD_CDC_Stats.Seq)
+#define CDC_STATS_END()    USBD_SEQ_END(USBD_CDC_Stats.Seq)
+
+#if (CDC_DISPATCH_PROFILE != 0U)
+#define CDC_CYCLES()       (DWT->CYCCNT)
+#else
+#define CDC_CYCLES()       0U
+#endif /* CDC_DISPATCH_PROFILE */
+
+/* Parameters in use and the set the host asked for, swapped in on SetConfiguration */
+static USBD_CDC_ParamsTypeDef USBD_CDC_Params =
+{
+  CDC_DATA_FS_OUT_PACKET_SIZE,
+  USBD_FS_RX_FIFO_SIZE,
+  USBD_FS_TX0_FIFO_SIZE,
+  USBD_FS_TX1_FIFO_SIZE,
+  0U,
+  1U,
+  0U
+};
+static USBD_CDC_ParamsTypeDef USBD_CDC_PendingParams =
+{
+  CDC_DATA_FS_OUT_PACKET_SIZE,
+  USBD_FS_RX_FIFO_SIZE,
+  USBD_FS_TX0_FIFO_SIZE,
+  USBD_FS_TX1_FIFO_SIZE,
+  0U,
+  1U,
+  0U
+};
 
 
 /**
@@ -218,7 +323,7 @@ static uint8_t CDCCmdEpAdd = CDC_CMD_EP;
 
 /**
   * @brief  USBD_CDC_Init
-  *         Initialize the CDC interface
+  *         Initialize every function of the CDC class
   * @param  pdev: device instance
   * @param  cfgidx: Configuration index
   * @retval status
@@ -226,10 +331,138 @@ static uint8_t CDCCmdEpAdd = CDC_CMD_EP;
 static uint8_t  USBD_CDC_Init (USBD_HandleTypeDef *pdev,
                                uint8_t cfgidx)
 {
+  uint32_t classid = pdev->classId;
+  uint32_t fn;
+  uint8_t ret = (uint8_t)USBD_OK;
+
+  for (fn = 0U; (fn < USBD_CDC_FUNC_NUM) && (ret == (uint8_t)USBD_OK); fn++)
+  {
+    pdev->classId = fn;
+    ret = USBD_CDC_InitFunc(pdev, cfgidx);
+  }
+
+  pdev->classId = classid;
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_CDC_DeInit
+  *         DeInitialize every function of the CDC class
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t  USBD_CDC_DeInit (USBD_HandleTypeDef *pdev,
+                                 uint8_t cfgidx)
+{
+  uint32_t classid = pdev->classId;
+  uint32_t fn;
+
+  for (fn = USBD_CDC_FUNC_NUM; fn > 0U; fn--)
+  {
+    pdev->classId = fn - 1U;
+    (void)USBD_CDC_DeInitFunc(pdev, cfgidx);
+  }
+
+  pdev->classId = classid;
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Setup
+  *         Route a request to the function owning its interface or endpoint
+  * @param  pdev: instance
+  * @param  req: usb requests
+  * @retval status
+  */
+static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
+                                USBD_SetupReqTypedef *req)
+{
+  uint32_t classid = pdev->classId;
+  uint8_t ret;
+
+  pdev->classId = USBD_CDC_FuncFromReq(req);
+
+  /* Line coding and the vendor requests belong to the first function */
+  if ((pdev->classId != 0U) && ((req->bmRequest & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_STANDARD))
+  {
+    USBD_CtlError(pdev, req);
+    ret = (uint8_t)USBD_FAIL;
+  }
+  else
+  {
+    ret = USBD_CDC_SetupFunc(pdev, req);
+  }
+
+  pdev->classId = classid;
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_CDC_DataIn
+  *         Route an IN completion to the function owning the endpoint
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  uint32_t classid = pdev->classId;
+  uint32_t t0 = CDC_CYCLES();
+  uint32_t t1;
+  uint8_t ret;
+
+  pdev->classId = USBD_CDC_FuncFromEP(epnum);
+  t1 = CDC_CYCLES();
+  ret = USBD_CDC_DataInFunc(pdev, epnum);
+  USBD_CDC_Profile(t1 - t0, CDC_CYCLES() - t1);
+
+  pdev->classId = classid;
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_CDC_DataOut
+  *         Route an OUT completion to the function owning the endpoint
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t  USBD_CDC_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  uint32_t classid = pdev->classId;
+  uint32_t t0 = CDC_CYCLES();
+  uint32_t t1;
+  uint8_t ret;
+
+  pdev->classId = USBD_CDC_FuncFromEP(epnum);
+  t1 = CDC_CYCLES();
+  ret = USBD_CDC_DataOutFunc(pdev, epnum);
+  USBD_CDC_Profile(t1 - t0, CDC_CYCLES() - t1);
+
+  pdev->classId = classid;
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_CDC_InitFunc
+  *         Initialize the function selected by pdev->classId
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t  USBD_CDC_InitFunc(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
 
 
 	UNUSED(cfgidx);
 	  USBD_CDC_HandleTypeDef *hcdc;
+	  const USBD_CDC_AltTypeDef *prof;
 
 	  hcdc = (USBD_CDC_HandleTypeDef *)USBD_malloc(sizeof(USBD_CDC_HandleTypeDef));
 
@@ -242,47 +475,78 @@ static uint8_t  USBD_CDC_Init (USBD_HandleTypeDef *pdev,
 	  (void)USBD_memset(hcdc, 0, sizeof(USBD_CDC_HandleTypeDef));
 
 	  pdev->pClassDataCmsit[pdev->classId] = (void *)hcdc;
-	  pdev->pClassData = pdev->pClassDataCmsit[pdev->classId];
+	  if (pdev->classId == 0U)
+	  {
+	    pdev->pClassData = pdev->pClassDataCmsit[pdev->classId];
+	  }
+
+	  /* Take the transport parameters requested since the last configuration,
+	     the FIFOs are laid out once, by the first function */
+	  if (pdev->classId == 0U)
+	  {
+	    if ((USBD_LL_SetFifoLayout(pdev, USBD_CDC_PendingParams.RxFifoSize,
+	                               USBD_CDC_PendingParams.Tx0FifoSize,
+	                               USBD_CDC_PendingParams.Tx1FifoSize, 0U) == USBD_OK) &&
+	        (USBD_LL_SetTxFifoRefill(pdev, USBD_CDC_PendingParams.TxFifoEmptyLvl,
+	                                 USBD_CDC_PendingParams.TxFifoPrefill) == USBD_OK))
+	    {
+	      USBD_CDC_Params = USBD_CDC_PendingParams;
+	    }
+	    else
+	    {
+	      USBD_CDC_PendingParams = USBD_CDC_Params;
+	    }
+	  }
+	  hcdc->RxXferSize = USBD_CDC_Params.RxXferSize;
 
 
 	  if (pdev->dev_speed == USBD_SPEED_HIGH)
 	  {
 	    /* Open EP IN */
-	    (void)USBD_LL_OpenEP(pdev, CDCInEpAdd, USBD_EP_TYPE_BULK,
+	    (void)USBD_LL_OpenEP(pdev, CDCInEpAdd[pdev->classId], USBD_EP_TYPE_BULK,
 	                         CDC_DATA_HS_IN_PACKET_SIZE);
 
-	    pdev->ep_in[CDCInEpAdd & 0xFU].is_used = 1U;
+	    pdev->ep_in[CDCInEpAdd[pdev->classId] & 0xFU].is_used = 1U;
 
 	    /* Open EP OUT */
-	    (void)USBD_LL_OpenEP(pdev, CDCOutEpAdd, USBD_EP_TYPE_BULK,
+	    (void)USBD_LL_OpenEP(pdev, CDCOutEpAdd[pdev->classId], USBD_EP_TYPE_BULK,
 	                         CDC_DATA_HS_OUT_PACKET_SIZE);
 
-	    pdev->ep_out[CDCOutEpAdd & 0xFU].is_used = 1U;
+	    pdev->ep_out[CDCOutEpAdd[pdev->classId] & 0xFU].is_used = 1U;
 
 	    /* Set bInterval for CDC CMD Endpoint */
-	    pdev->ep_in[CDCCmdEpAdd & 0xFU].bInterval = CDC_HS_BINTERVAL;
+	    pdev->ep_in[CDCCmdEpAdd[pdev->classId] & 0xFU].bInterval = CDC_HS_BINTERVAL;
 	  }
 	  else
 	  {
+	    /* Every function starts in the default setting, the only one of the
+	       other functions, with the endpoints its descriptor announces */
+	    prof = &USBD_CDC_AltTable[CDC_ALT_BULK];
+
 	    /* Open EP IN */
-	    (void)USBD_LL_OpenEP(pdev, CDCInEpAdd, USBD_EP_TYPE_BULK,
-	                         CDC_DATA_FS_IN_PACKET_SIZE);
+	    (void)USBD_LL_OpenEP(pdev, CDCInEpAdd[pdev->classId], prof->InType, prof->InMps);
 
-	    pdev->ep_in[CDCInEpAdd & 0xFU].is_used = 1U;
+	    pdev->ep_in[CDCInEpAdd[pdev->classId] & 0xFU].is_used = 1U;
 
 	    /* Open EP OUT */
-	    (void)USBD_LL_OpenEP(pdev, CDCOutEpAdd, USBD_EP_TYPE_BULK,
-	                         CDC_DATA_FS_OUT_PACKET_SIZE);
+	    (void)USBD_LL_OpenEP(pdev, CDCOutEpAdd[pdev->classId], USBD_EP_TYPE_BULK, prof->OutMps);
 
-	    pdev->ep_out[CDCOutEpAdd & 0xFU].is_used = 1U;
+	    pdev->ep_out[CDCOutEpAdd[pdev->classId] & 0xFU].is_used = 1U;
 
 	    /* Set bInterval for CMD Endpoint */
-	    pdev->ep_in[CDCCmdEpAdd & 0xFU].bInterval = CDC_FS_BINTERVAL;
+	    pdev->ep_in[CDCCmdEpAdd[pdev->classId] & 0xFU].bInterval = CDC_NOTIFY_FS_BINTERVAL;
 	  }
 
 	  /* Open Command IN EP */
-	  (void)USBD_LL_OpenEP(pdev, CDCCmdEpAdd, USBD_EP_TYPE_INTR, CDC_CMD_PACKET_SIZE);
-	  pdev->ep_in[CDCCmdEpAdd & 0xFU].is_used = 1U;
+	  (void)USBD_LL_OpenEP(pdev, CDCCmdEpAdd[pdev->classId], USBD_EP_TYPE_INTR, CDC_CMD_PACKET_SIZE);
+	  pdev->ep_in[CDCCmdEpAdd[pdev->classId] & 0xFU].is_used = 1U;
+
+	  /* Completions skip the class lookup with USBD_DIRECT_DISPATCH; the shared
+	     notification endpoint goes to the function USBD_CDC_FuncFromEP names */
+	  (void)USBD_CoreBindEP(pdev, CDCInEpAdd[pdev->classId], (uint8_t)pdev->classId, USBD_CDC_DataInFunc);
+	  (void)USBD_CoreBindEP(pdev, CDCOutEpAdd[pdev->classId], (uint8_t)pdev->classId, USBD_CDC_DataOutFunc);
+	  (void)USBD_CoreBindEP(pdev, CDCCmdEpAdd[pdev->classId],
+	                        (uint8_t)USBD_CDC_FuncFromEP(CDCCmdEpAdd[pdev->classId]), USBD_CDC_DataInFunc);
 
 	  hcdc->RxBuffer = NULL;
 
@@ -301,14 +565,14 @@ static uint8_t  USBD_CDC_Init (USBD_HandleTypeDef *pdev,
 	  if (pdev->dev_speed == USBD_SPEED_HIGH)
 	  {
 	    /* Prepare Out endpoint to receive next packet */
-	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd, hcdc->RxBuffer,
+	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd[pdev->classId], hcdc->RxBuffer,
 	                                 CDC_DATA_HS_OUT_PACKET_SIZE);
 	  }
 	  else
 	  {
 	    /* Prepare Out endpoint to receive next packet */
-	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd, hcdc->RxBuffer,
-	                                 CDC_DATA_FS_OUT_PACKET_SIZE);
+	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd[pdev->classId], hcdc->RxBuffer,
+	                                 hcdc->RxXferSize);
 	  }
 
 	  return (uint8_t)USBD_OK;
@@ -387,14 +651,13 @@ static uint8_t  USBD_CDC_Init (USBD_HandleTypeDef *pdev,
 }
 
 /**
-  * @brief  USBD_CDC_Init
-  *         DeInitialize the CDC layer
+  * @brief  USBD_CDC_DeInitFunc
+  *         DeInitialize the function selected by pdev->classId
   * @param  pdev: device instance
   * @param  cfgidx: Configuration index
   * @retval status
   */
-static uint8_t  USBD_CDC_DeInit (USBD_HandleTypeDef *pdev,
-                                 uint8_t cfgidx)
+static uint8_t  USBD_CDC_DeInitFunc(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
 
 	UNUSED(cfgidx);
@@ -402,18 +665,22 @@ static uint8_t  USBD_CDC_DeInit (USBD_HandleTypeDef *pdev,
 
 
 
+	  (void)USBD_CoreBindEP(pdev, CDCInEpAdd[pdev->classId], (uint8_t)pdev->classId, NULL);
+	  (void)USBD_CoreBindEP(pdev, CDCOutEpAdd[pdev->classId], (uint8_t)pdev->classId, NULL);
+	  (void)USBD_CoreBindEP(pdev, CDCCmdEpAdd[pdev->classId], (uint8_t)pdev->classId, NULL);
+
 	  /* Close EP IN */
-	  (void)USBD_LL_CloseEP(pdev, CDCInEpAdd);
-	  pdev->ep_in[CDCInEpAdd & 0xFU].is_used = 0U;
+	  (void)USBD_LL_CloseEP(pdev, CDCInEpAdd[pdev->classId]);
+	  pdev->ep_in[CDCInEpAdd[pdev->classId] & 0xFU].is_used = 0U;
 
 	  /* Close EP OUT */
-	  (void)USBD_LL_CloseEP(pdev, CDCOutEpAdd);
-	  pdev->ep_out[CDCOutEpAdd & 0xFU].is_used = 0U;
+	  (void)USBD_LL_CloseEP(pdev, CDCOutEpAdd[pdev->classId]);
+	  pdev->ep_out[CDCOutEpAdd[pdev->classId] & 0xFU].is_used = 0U;
 
 	  /* Close Command IN EP */
-	  (void)USBD_LL_CloseEP(pdev, CDCCmdEpAdd);
-	  pdev->ep_in[CDCCmdEpAdd & 0xFU].is_used = 0U;
-	  pdev->ep_in[CDCCmdEpAdd & 0xFU].bInterval = 0U;
+	  (void)USBD_LL_CloseEP(pdev, CDCCmdEpAdd[pdev->classId]);
+	  pdev->ep_in[CDCCmdEpAdd[pdev->classId] & 0xFU].is_used = 0U;
+	  pdev->ep_in[CDCCmdEpAdd[pdev->classId] & 0xFU].bInterval = 0U;
 
 	  /* DeInit  physical Interface components */
 	  if (pdev->pClassDataCmsit[pdev->classId] != NULL)
@@ -421,7 +688,10 @@ static uint8_t  USBD_CDC_DeInit (USBD_HandleTypeDef *pdev,
 	    ((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->DeInit();
 	    (void)USBD_free(pdev->pClassDataCmsit[pdev->classId]);
 	    pdev->pClassDataCmsit[pdev->classId] = NULL;
-	    pdev->pClassData = NULL;
+	    if (pdev->classId == 0U)
+	    {
+	      pdev->pClassData = NULL;
+	    }
 	  }
 
 	  return (uint8_t)USBD_OK;
@@ -451,14 +721,13 @@ static uint8_t  USBD_CDC_DeInit (USBD_HandleTypeDef *pdev,
 }
 
 /**
-  * @brief  USBD_CDC_Setup
-  *         Handle the CDC specific requests
+  * @brief  USBD_CDC_SetupFunc
+  *         Handle the CDC specific requests of one function
   * @param  pdev: instance
   * @param  req: usb requests
   * @retval status
   */
-static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
-                                USBD_SetupReqTypedef *req)
+static uint8_t  USBD_CDC_SetupFunc(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
 
 
@@ -491,6 +760,7 @@ static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
 	        {
 	          hcdc->CmdOpCode = req->bRequest;
 	          hcdc->CmdLength = (uint8_t)MIN(req->wLength, USB_MAX_EP0_SIZE);
+	          hcdc->CmdType = USB_REQ_TYPE_CLASS;
 
 	          (void)USBD_CtlPrepareRx(pdev, (uint8_t *)hcdc->data, hcdc->CmdLength);
 	        }
@@ -520,6 +790,7 @@ static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
 	        case USB_REQ_GET_INTERFACE:
 	          if (pdev->dev_state == USBD_STATE_CONFIGURED)
 	          {
+	            ifalt = hcdc->AltSetting;
 	            (void)USBD_CtlSendData(pdev, &ifalt, 1U);
 	          }
 	          else
@@ -530,7 +801,8 @@ static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
 	          break;
 
 	        case USB_REQ_SET_INTERFACE:
-	          if (pdev->dev_state != USBD_STATE_CONFIGURED)
+	          if ((pdev->dev_state != USBD_STATE_CONFIGURED) ||
+	              (USBD_CDC_SetAlt(pdev, LOBYTE(req->wValue)) != USBD_OK))
 	          {
 	            USBD_CtlError(pdev, req);
 	            ret = USBD_FAIL;
@@ -538,6 +810,12 @@ static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
 	          break;
 
 	        case USB_REQ_CLEAR_FEATURE:
+	          /* The core already aborted and un-halted the endpoint */
+	          if (((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_ENDPOINT) &&
+	              (req->wValue == USB_FEATURE_EP_HALT))
+	          {
+	            USBD_CDC_ResyncEP(pdev, LOBYTE(req->wIndex));
+	          }
 	          break;
 
 	        default:
@@ -547,6 +825,10 @@ static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
 	      }
 	      break;
 
+	    case USB_REQ_TYPE_VENDOR:
+	      ret = USBD_CDC_VendorSetup(pdev, req);
+	      break;
+
 	    default:
 	      USBD_CtlError(pdev, req);
 	      ret = USBD_FAIL;
@@ -612,13 +894,13 @@ static uint8_t  USBD_CDC_Setup (USBD_HandleTypeDef *pdev,
 }
 
 /**
-  * @brief  USBD_CDC_DataIn
+  * @brief  USBD_CDC_DataInFunc
   *         Data sent on non-control IN endpoint
   * @param  pdev: device instance
   * @param  epnum: endpoint number
   * @retval status
   */
-static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
+static uint8_t  USBD_CDC_DataInFunc(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
 
 	 USBD_CDC_HandleTypeDef *hcdc;
@@ -631,7 +913,19 @@ static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
 
 		  hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
 
-		  if ((pdev->ep_in[epnum & 0xFU].total_length > 0U) &&
+		  if ((epnum & 0xFU) == (CDCCmdEpAdd[pdev->classId] & 0xFU))
+		  {
+		    hcdc->NotifyState = 0U;
+		    /* Credits granted while the last message was in flight */
+		    USBD_CDC_SendCredit(pdev, hcdc, 0U);
+		  }
+		  else if (hcdc->AltSetting == CDC_ALT_ISO_IN)
+		  {
+		    /* One packet per frame until the whole buffer is out */
+		    hcdc->TxOffset += hcdc->TxChunk;
+		    USBD_CDC_IsoInNext(pdev, hcdc);
+		  }
+		  else if ((pdev->ep_in[epnum & 0xFU].total_length > 0U) &&
 		      ((pdev->ep_in[epnum & 0xFU].total_length % hpcd->IN_ep[epnum & 0xFU].maxpacket) == 0U))
 		  {
 		    /* Update the packet total length */
@@ -642,12 +936,8 @@ static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
 		  }
 		  else
 		  {
-		    hcdc->TxState = 0U;
-
-		    if (((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->TransmitCplt != NULL)
-		    {
-		      ((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->TransmitCplt(hcdc->TxBuffer, &hcdc->TxLength, epnum);
-		    }
+		    /* A multiple of the packet size was terminated by a ZLP */
+		    USBD_CDC_TxComplete(pdev, hcdc, epnum, hcdc->TxLength + 1U);
 		  }
 
 		  return (uint8_t)USBD_OK;
@@ -667,13 +957,13 @@ static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
 }
 
 /**
-  * @brief  USBD_CDC_DataOut
+  * @brief  USBD_CDC_DataOutFunc
   *         Data received on non-control Out endpoint
   * @param  pdev: device instance
   * @param  epnum: endpoint number
   * @retval status
   */
-static uint8_t  USBD_CDC_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
+static uint8_t  USBD_CDC_DataOutFunc(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
 
 
@@ -687,11 +977,37 @@ static uint8_t  USBD_CDC_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
 
 	   /* Get the received data length */
 	   hcdc->RxLength = USBD_LL_GetRxDataSize(pdev, epnum);
+	   hcdc->RxState = 0U;
+
+	   CDC_STATS_BEGIN();
+	   USBD_CDC_CountXfer(&USBD_CDC_Stats.Out, hcdc->RxLength,
+	                      ((PCD_HandleTypeDef *)pdev->pData)->OUT_ep[epnum & 0xFU].xfer_len,
+	                      ((PCD_HandleTypeDef *)pdev->pData)->OUT_ep[epnum & 0xFU].maxpacket);
+	   CDC_STATS_END();
+
+	   /* In split mode the header is already in RxHdrBuffer, report the payload only */
+	   if (hcdc->RxHdrLength != 0U)
+	   {
+	     hcdc->RxLength = (hcdc->RxLength > hcdc->RxHdrLength) ? (hcdc->RxLength - hcdc->RxHdrLength) : 0U;
+	   }
 
 	   /* USB data will be immediately processed, this allow next USB traffic being
 	   NAKed till the end of the application Xfer */
 
-	   ((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->Receive(hcdc->RxBuffer, &hcdc->RxLength);
+	   if (((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->Receive(hcdc->RxBuffer, &hcdc->RxLength) != (int8_t)USBD_OK)
+	   {
+	     CDC_STATS_BEGIN();
+	     USBD_CDC_Stats.Out.Overflows++;
+	     CDC_STATS_END();
+	   }
+
+	   /* Not re-armed by the application: the host is NAKed until it is */
+	   if (hcdc->RxState == 0U)
+	   {
+	     CDC_STATS_BEGIN();
+	     USBD_CDC_Stats.Out.NakGaps++;
+	     CDC_STATS_END();
+	   }
 
 	   return (uint8_t)USBD_OK;
 
@@ -734,7 +1050,16 @@ static uint8_t  USBD_CDC_EP0_RxReady (USBD_HandleTypeDef *pdev)
 	    return (uint8_t)USBD_FAIL;
 	  }
 
-	  if ((pdev->pUserData[pdev->classId] != NULL) && (hcdc->CmdOpCode != 0xFFU))
+	  if ((hcdc->CmdType == USB_REQ_TYPE_VENDOR) && (hcdc->CmdOpCode == CDC_VENDOR_SET_PARAMS))
+	  {
+	    /* Out of range sets are dropped, the host reads back the pending set */
+	    if (USBD_CDC_CheckParams((USBD_CDC_ParamsTypeDef *)hcdc->data) != 0U)
+	    {
+	      (void)USBD_memcpy(&USBD_CDC_PendingParams, hcdc->data, sizeof(USBD_CDC_ParamsTypeDef));
+	    }
+	    hcdc->CmdOpCode = 0xFFU;
+	  }
+	  else if ((pdev->pUserData[pdev->classId] != NULL) && (hcdc->CmdOpCode != 0xFFU))
 	  {
 	    ((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->Control(hcdc->CmdOpCode,
 	                                                                     (uint8_t *)hcdc->data,
@@ -768,26 +1093,7 @@ static uint8_t  USBD_CDC_EP0_RxReady (USBD_HandleTypeDef *pdev)
   */
 static uint8_t  *USBD_CDC_GetFSCfgDesc (uint16_t *length)
 {
-
-	 USBD_EpDescTypeDef *pEpCmdDesc = USBD_GetEpDesc(USBD_CDC_CfgDesc, CDC_CMD_EP);
-	  USBD_EpDescTypeDef *pEpOutDesc = USBD_GetEpDesc(USBD_CDC_CfgDesc, CDC_OUT_EP);
-	  USBD_EpDescTypeDef *pEpInDesc = USBD_GetEpDesc(USBD_CDC_CfgDesc, CDC_IN_EP);
-
-	  if (pEpCmdDesc != NULL)
-	  {
-	    pEpCmdDesc->bInterval = CDC_FS_BINTERVAL;
-	  }
-
-	  if (pEpOutDesc != NULL)
-	  {
-	    pEpOutDesc->wMaxPacketSize = CDC_DATA_FS_MAX_PACKET_SIZE;
-	  }
-
-	  if (pEpInDesc != NULL)
-	  {
-	    pEpInDesc->wMaxPacketSize = CDC_DATA_FS_MAX_PACKET_SIZE;
-	  }
-
+	  /* Generated complete from CDC_ALT_TABLE, nothing to patch */
 	  *length = (uint16_t)sizeof(USBD_CDC_CfgDesc);
 	  return USBD_CDC_CfgDesc;
 
@@ -828,6 +1134,27 @@ uint8_t  USBD_CDC_RegisterInterface  (USBD_HandleTypeDef   *pdev,
   return ret;
 }
 
+/**
+  * @brief  USBD_CDC_RegisterFuncInterface
+  *         Register the callbacks of one function; call before USBD_Start
+  * @param  pdev: device instance
+  * @param  func: function index, 0 is the one USBD_CDC_RegisterInterface sets
+  * @param  fops: CDC Interface callback
+  * @retval status
+  */
+uint8_t USBD_CDC_RegisterFuncInterface(USBD_HandleTypeDef *pdev, uint8_t func,
+                                       USBD_CDC_ItfTypeDef *fops)
+{
+  if ((fops == NULL) || (func >= USBD_CDC_FUNC_NUM))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  pdev->pUserData[func] = fops;
+
+  return (uint8_t)USBD_OK;
+}
+
 /**
   * @brief  USBD_CDC_SetTxBuffer
   * @param  pdev: device instance
@@ -902,6 +1229,35 @@ uint8_t  USBD_CDC_SetRxBuffer  (USBD_HandleTypeDef   *pdev,
 //  return USBD_OK;
 }
 
+/**
+  * @brief  USBD_CDC_SetRxSplitBuffer
+  *         Route the first hdr_length bytes of each OUT transfer to phdr and
+  *         the rest to pbuff; takes effect on the next USBD_CDC_ReceivePacket.
+  * @param  pdev: device instance
+  * @param  phdr: header buffer, NULL to go back to a single Rx buffer
+  * @param  hdr_length: header length
+  * @param  pbuff: payload buffer
+  * @param  length: payload buffer size
+  * @retval status
+  */
+uint8_t USBD_CDC_SetRxSplitBuffer(USBD_HandleTypeDef *pdev, uint8_t *phdr, uint32_t hdr_length,
+                                  uint8_t *pbuff, uint32_t length)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+
+  if (hcdc == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc->RxBuffer = pbuff;
+  hcdc->RxHdrBuffer = phdr;
+  hcdc->RxHdrLength = (phdr != NULL) ? hdr_length : 0U;
+  hcdc->RxPayloadSize = length;
+
+  return (uint8_t)USBD_OK;
+}
+
 /**
   * @brief  USBD_CDC_DataOut
   *         Data received on non-control Out endpoint
@@ -927,14 +1283,123 @@ uint8_t USBD_CDC_TransmitPacket(USBD_HandleTypeDef *pdev)
     /* Tx Transfer in progress */
     hcdc->TxState = 1U;
 
+    if (hcdc->AltSetting == CDC_ALT_ISO_IN)
+    {
+      /* Chopped into one packet per frame, no ZLP on isochronous pipes */
+      hcdc->TxOffset = 0U;
+      USBD_CDC_IsoInNext(pdev, hcdc);
+      return (uint8_t)USBD_OK;
+    }
+
     /* Update the packet total length */
-    pdev->ep_in[CDCInEpAdd & 0xFU].total_length = hcdc->TxLength;
+    pdev->ep_in[CDCInEpAdd[pdev->classId] & 0xFU].total_length = hcdc->TxLength;
 
     /* Transmit next packet */
-    (void)USBD_LL_Transmit(pdev, CDCInEpAdd, hcdc->TxBuffer, hcdc->TxLength);
+    (void)USBD_LL_Transmit(pdev, CDCInEpAdd[pdev->classId], hcdc->TxBuffer, hcdc->TxLength);
+
+    ret = USBD_OK;
+  }
+  else
+  {
+    USBD_CDC_CountTxBusy();
+  }
+
+  return (uint8_t)ret;
+}
+
+/**
+  * @brief  USBD_CDC_TransmitFunc
+  *         Start a bulk IN transfer on one function. Unlike the
+  *         SetTxBuffer/TransmitPacket pair it does not go through
+  *         pdev->classId, so it is safe from thread context
+  * @param  pdev: device instance
+  * @param  func: function index
+  * @param  pbuf: data, must stay valid until TransmitCplt
+  * @param  length: data length
+  * @retval status
+  */
+uint8_t USBD_CDC_TransmitFunc(USBD_HandleTypeDef *pdev, uint8_t func, uint8_t *pbuf,
+                              uint32_t length)
+{
+  USBD_CDC_HandleTypeDef *hcdc;
+
+  if (func >= USBD_CDC_FUNC_NUM)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[func];
+
+  if ((hcdc == NULL) || (hcdc->AltSetting == CDC_ALT_ISO_IN))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (hcdc->TxState != 0U)
+  {
+    USBD_CDC_CountTxBusy();
+    return (uint8_t)USBD_BUSY;
+  }
+
+  hcdc->TxBuffer = pbuf;
+  hcdc->TxLength = length;
+  hcdc->TxState = 1U;
+
+  /* Update the packet total length */
+  pdev->ep_in[CDCInEpAdd[func] & 0xFU].total_length = length;
+
+  (void)USBD_LL_Transmit(pdev, CDCInEpAdd[func], pbuf, length);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_TransmitSeg
+  *         Transmit a list of buffers as a single packet chain on the IN endpoint
+  * @param  pdev: device instance
+  * @param  pSeg: segment list, must stay valid until TransmitCplt
+  * @param  SegNum: number of segments
+  * @retval status
+  */
+uint8_t USBD_CDC_TransmitSeg(USBD_HandleTypeDef *pdev, const USBD_SegTypeDef *pSeg, uint32_t SegNum)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+  USBD_StatusTypeDef ret = USBD_BUSY;
+  uint32_t length = 0U;
+  uint32_t i;
+
+  if ((hcdc == NULL) || (pSeg == NULL) || (SegNum == 0U))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (hcdc->TxState == 0U)
+  {
+    for (i = 0U; i < SegNum; i++)
+    {
+      length += pSeg[i].len;
+    }
+
+    /* Tx Transfer in progress */
+    hcdc->TxState = 1U;
+    hcdc->TxBuffer = pSeg[0].pbuf;
+    hcdc->TxLength = length;
+
+    /* Update the packet total length */
+    pdev->ep_in[CDCInEpAdd[pdev->classId] & 0xFU].total_length = length;
+
+    if (USBD_LL_TransmitSeg(pdev, CDCInEpAdd[pdev->classId], pSeg, SegNum) != USBD_OK)
+    {
+      hcdc->TxState = 0U;
+      return (uint8_t)USBD_FAIL;
+    }
 
     ret = USBD_OK;
   }
+  else
+  {
+    USBD_CDC_CountTxBusy();
+  }
 
   return (uint8_t)ret;
 }
@@ -971,33 +1436,767 @@ uint8_t USBD_CDC_TransmitPacket(USBD_HandleTypeDef *pdev)
 
 
 /**
-  * @brief  USBD_CDC_ReceivePacket
-  *         prepare OUT Endpoint for reception
+  * @brief  USBD_CDC_VendorSetup
+  *         Handle the transport parameter vendor requests
   * @param  pdev: device instance
+  * @param  req: usb requests
   * @retval status
   */
-uint8_t  USBD_CDC_ReceivePacket(USBD_HandleTypeDef *pdev)
+static USBD_StatusTypeDef USBD_CDC_VendorSetup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
- // USBD_CDC_HandleTypeDef   *hcdc = (USBD_CDC_HandleTypeDef*) pdev->pClassData;
-	USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
-  /* Suspend or Resume USB Out process */
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+  USBD_CDC_ParamsTypeDef *params;
+  uint16_t len;
 
-	 if (pdev->pClassDataCmsit[pdev->classId] == NULL)
-	  {
-	    return (uint8_t)USBD_FAIL;
-	  }
+  switch (req->bRequest)
+  {
+    case CDC_VENDOR_GET_PARAMS:
+      if ((req->bmRequest & 0x80U) != 0U)
+      {
+        params = (req->wValue == 0U) ? &USBD_CDC_Params : &USBD_CDC_PendingParams;
+        (void)USBD_memcpy(hcdc->data, params, sizeof(USBD_CDC_ParamsTypeDef));
+
+        len = MIN(sizeof(USBD_CDC_ParamsTypeDef), req->wLength);
+        (void)USBD_CtlSendData(pdev, (uint8_t *)hcdc->data, len);
+        return USBD_OK;
+      }
+      break;
+
+    case CDC_VENDOR_SET_PARAMS:
+      if (((req->bmRequest & 0x80U) == 0U) && (req->wLength == sizeof(USBD_CDC_ParamsTypeDef)))
+      {
+        hcdc->CmdOpCode = req->bRequest;
+        hcdc->CmdLength = (uint8_t)req->wLength;
+        hcdc->CmdType = USB_REQ_TYPE_VENDOR;
+
+        (void)USBD_CtlPrepareRx(pdev, (uint8_t *)hcdc->data, hcdc->CmdLength);
+        return USBD_OK;
+      }
+      break;
+
+    case CDC_VENDOR_GET_STATS:
+      if ((req->bmRequest & 0x80U) != 0U)
+      {
+        USBD_CDC_GetStats((USBD_CDC_StatsTypeDef *)hcdc->data);
+
+        len = MIN(sizeof(USBD_CDC_StatsTypeDef), req->wLength);
+        (void)USBD_CtlSendData(pdev, (uint8_t *)hcdc->data, len);
+        return USBD_OK;
+      }
+      break;
+
+    case CDC_VENDOR_GET_MEMORY:
+    case CDC_VENDOR_GET_LOG:
+      /* The layout belongs to the application, the class only carries it;
+         a refusal stalls the request */
+      if (((req->bmRequest & 0x80U) != 0U) && (pdev->pUserData[pdev->classId] != NULL))
+      {
+        len = MIN(sizeof(hcdc->data), req->wLength);
+        (void)USBD_memset(hcdc->data, 0, len);
+
+        if (((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->Control(
+              (req->bRequest == CDC_VENDOR_GET_LOG) ? CDC_CTRL_GET_LOG : CDC_CTRL_GET_MEMORY,
+              (uint8_t *)hcdc->data, len) == (int8_t)USBD_OK)
+        {
+          (void)USBD_CtlSendData(pdev, (uint8_t *)hcdc->data, len);
+          return USBD_OK;
+        }
+      }
+      break;
+
+    case CDC_VENDOR_GET_CREDIT:
+      if ((req->bmRequest & 0x80U) != 0U)
+      {
+        USBD_CDC_CreditTypeDef *credit = (USBD_CDC_CreditTypeDef *)hcdc->data;
+
+        credit->Type = CDC_NOTIFY_CREDIT;
+        credit->Reserved = 0U;
+        credit->XferSize = (uint16_t)hcdc->RxXferSize;
+        credit->Granted = hcdc->CreditGranted;
+
+        len = MIN(sizeof(USBD_CDC_CreditTypeDef), req->wLength);
+        (void)USBD_CtlSendData(pdev, (uint8_t *)hcdc->data, len);
+        return USBD_OK;
+      }
+      break;
+
+    default:
+      break;
+  }
 
-	  if (pdev->dev_speed == USBD_SPEED_HIGH)
+  USBD_CtlError(pdev, req);
+  return USBD_FAIL;
+}
+
+/**
+  * @brief  USBD_CDC_TxComplete
+  *         Account a finished IN transfer and hand the buffer back
+  * @param  pdev: device instance
+  * @param  hcdc: class handle
+  * @param  epnum: endpoint number
+  * @param  xfer_size: see USBD_CDC_CountXfer
+  * @retval None
+  */
+static void USBD_CDC_TxComplete(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc,
+                                uint8_t epnum, uint32_t xfer_size)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+
+  CDC_STATS_BEGIN();
+  USBD_CDC_CountXfer(&USBD_CDC_Stats.In, hcdc->TxLength, xfer_size,
+                     hpcd->IN_ep[epnum & 0xFU].maxpacket);
+  CDC_STATS_END();
+
+  hcdc->TxState = 0U;
+
+  if (((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->TransmitCplt != NULL)
+  {
+    ((USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId])->TransmitCplt(hcdc->TxBuffer, &hcdc->TxLength, epnum);
+  }
+
+  if (hcdc->TxState == 0U)
+  {
+    CDC_STATS_BEGIN();
+    USBD_CDC_Stats.In.NakGaps++;
+    CDC_STATS_END();
+  }
+}
+
+/**
+  * @brief  USBD_CDC_IsoInNext
+  *         Queue the next frame of the isochronous IN buffer, or complete it
+  * @param  pdev: device instance
+  * @param  hcdc: class handle
+  * @retval None
+  */
+static void USBD_CDC_IsoInNext(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc)
+{
+  if (hcdc->TxOffset < hcdc->TxLength)
+  {
+    hcdc->TxChunk = MIN(hcdc->TxLength - hcdc->TxOffset, CDC_ISO_FS_IN_PACKET_SIZE);
+    (void)USBD_LL_Transmit(pdev, CDCInEpAdd[pdev->classId], hcdc->TxBuffer + hcdc->TxOffset, hcdc->TxChunk);
+  }
+  else
+  {
+    hcdc->TxChunk = 0U;
+    USBD_CDC_TxComplete(pdev, hcdc, CDCInEpAdd[pdev->classId] & 0xFU, hcdc->TxLength);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_IsoINIncomplete
+  *         The packet in flight missed its frame; it was flushed by the
+  *         driver, so send it again in the next one
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_CDC_IsoINIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+
+  if ((hcdc == NULL) || (hcdc->AltSetting != CDC_ALT_ISO_IN) || ((epnum & 0xFU) != (CDCInEpAdd[pdev->classId] & 0xFU)))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  CDC_STATS_BEGIN();
+  USBD_CDC_Stats.In.IsoIncomplete++;
+  CDC_STATS_END();
+
+  if (hcdc->TxState != 0U)
+  {
+    USBD_CDC_IsoInNext(pdev, hcdc);
+  }
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_SetAlt
+  *         Apply the profile of an alternate setting: the data endpoints are
+  *         re-opened with its packet sizes and the FIFOs re-partitioned,
+  *         without re-enumeration. If the profile cannot be applied the
+  *         current setting is re-opened and kept
+  * @param  pdev: device instance
+  * @param  alt: alternate setting
+  * @retval status, USBD_FAIL stalls the SET_INTERFACE request
+  */
+static USBD_StatusTypeDef USBD_CDC_SetAlt(USBD_HandleTypeDef *pdev, uint8_t alt)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+  const USBD_CDC_AltTypeDef *prof;
+  USBD_StatusTypeDef status;
+  uint32_t rx_armed;
+#if (USBD_CDC_FUNC_NUM > 1U)
+  uint32_t fn;
+#endif /* USBD_CDC_FUNC_NUM */
+
+  if ((alt >= CDC_ALT_NUM) || ((pdev->classId != 0U) && (alt != CDC_ALT_BULK)))
+  {
+    return USBD_FAIL;
+  }
+
+  if (pdev->classId != 0U)
+  {
+    /* Single setting, nothing to re-partition */
+    hcdc->AltSetting = alt;
+    return USBD_OK;
+  }
+
+  prof = &USBD_CDC_AltTable[alt];
+
+  /* Stop the data endpoints, the Rx FIFO is about to be flushed */
+  rx_armed = hcdc->RxState;
+  (void)USBD_LL_AbortEP(pdev, CDCOutEpAdd[pdev->classId]);
+  (void)USBD_LL_AbortEP(pdev, CDCInEpAdd[pdev->classId]);
+  (void)USBD_LL_AbortEP(pdev, CDCCmdEpAdd[pdev->classId]);
+  (void)USBD_LL_CloseEP(pdev, CDCOutEpAdd[pdev->classId]);
+  (void)USBD_LL_CloseEP(pdev, CDCInEpAdd[pdev->classId]);
+
+  USBD_CDC_TxAbort(pdev, hcdc);
+  hcdc->NotifyState = 0U;
+
+#if (USBD_CDC_FUNC_NUM > 1U)
+  /* The flush below also drops what the other functions have queued */
+  for (fn = 1U; fn < USBD_CDC_FUNC_NUM; fn++)
+  {
+    (void)USBD_LL_AbortEP(pdev, CDCOutEpAdd[fn]);
+    (void)USBD_LL_AbortEP(pdev, CDCInEpAdd[fn]);
+  }
+#endif /* USBD_CDC_FUNC_NUM */
+
+  status = USBD_CDC_OpenAlt(pdev, prof);
+  if (status == USBD_OK)
+  {
+    hcdc->AltSetting = alt;
+  }
+  else
+  {
+    /* Fall back to the setting the host still believes is active */
+    prof = &USBD_CDC_AltTable[hcdc->AltSetting];
+    (void)USBD_CDC_OpenAlt(pdev, prof);
+  }
+
+  hcdc->RxXferSize = (prof->RxXferSize != 0U) ? prof->RxXferSize : USBD_CDC_Params.RxXferSize;
+
+#if (USBD_CDC_FUNC_NUM > 1U)
+  for (fn = 1U; fn < USBD_CDC_FUNC_NUM; fn++)
+  {
+    pdev->classId = fn;
+    USBD_CDC_ResyncEP(pdev, CDCInEpAdd[fn]);
+    USBD_CDC_ResyncEP(pdev, CDCOutEpAdd[fn]);
+  }
+  pdev->classId = 0U;
+#endif /* USBD_CDC_FUNC_NUM */
+
+  if (rx_armed != 0U)
+  {
+    (void)USBD_CDC_ReceivePacket(pdev);
+  }
+
+  if (status == USBD_OK)
+  {
+    /* The host learns the grant, and the transfer size it covers, on entry */
+    USBD_CDC_SendCredit(pdev, hcdc, 1U);
+  }
+
+  return status;
+}
+
+/**
+  * @brief  USBD_CDC_OpenAlt
+  *         Partition the FIFOs for a profile and open its data endpoints;
+  *         the data endpoints must be stopped
+  * @param  pdev: device instance
+  * @param  prof: alternate setting profile
+  * @retval status, USBD_FAIL if the layout or an endpoint was refused
+  */
+static USBD_StatusTypeDef USBD_CDC_OpenAlt(USBD_HandleTypeDef *pdev, const USBD_CDC_AltTypeDef *prof)
+{
+  USBD_StatusTypeDef status;
+
+  if (prof->RxFifoSize == 0U)
+  {
+    status = USBD_LL_SetFifoLayout(pdev, USBD_CDC_Params.RxFifoSize, USBD_CDC_Params.Tx0FifoSize,
+                                   USBD_CDC_Params.Tx1FifoSize, prof->Tx2FifoSize);
+  }
+  else
+  {
+    status = USBD_LL_SetFifoLayout(pdev, prof->RxFifoSize, prof->Tx0FifoSize,
+                                   prof->Tx1FifoSize, prof->Tx2FifoSize);
+  }
+
+  if (status == USBD_OK)
+  {
+    status = USBD_LL_OpenEP(pdev, CDCInEpAdd[pdev->classId], prof->InType, prof->InMps);
+  }
+
+  if (status == USBD_OK)
+  {
+    status = USBD_LL_OpenEP(pdev, CDCOutEpAdd[pdev->classId], USBD_EP_TYPE_BULK, prof->OutMps);
+  }
+
+  return (status == USBD_OK) ? USBD_OK : USBD_FAIL;
+}
+
+/**
+  * @brief  USBD_CDC_ReceiveFunc
+  *         Arm the OUT endpoint of a given function on pbuf, from any context
+  * @param  pdev: device instance
+  * @param  func: function index, below USBD_CDC_FUNC_NUM
+  * @param  pbuf: buffer of at least the OUT transfer size
+  * @retval status
+  */
+uint8_t USBD_CDC_ReceiveFunc(USBD_HandleTypeDef *pdev, uint8_t func, uint8_t *pbuf)
+{
+  USBD_CDC_HandleTypeDef *hcdc;
+
+  if (func >= USBD_CDC_FUNC_NUM)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[func];
+
+  /* Split receive is set up through the classic calls only */
+  if ((hcdc == NULL) || (hcdc->RxHdrLength != 0U))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc->RxBuffer = pbuf;
+  hcdc->RxState = 1U;
+
+  (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd[func], pbuf, hcdc->RxXferSize);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_SendNotify
+  *         Send a message on the interrupt IN endpoint of CDC_ALT_BULK_INTR
+  * @param  pdev: device instance
+  * @param  pbuf: message, must stay valid until it is sent
+  * @param  length: message length, at most CDC_CMD_PACKET_SIZE
+  * @retval status
+  */
+uint8_t USBD_CDC_SendNotify(USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint16_t length)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+
+  if ((hcdc == NULL) || (length > CDC_CMD_PACKET_SIZE) ||
+      (USBD_CDC_AltTable[hcdc->AltSetting].NotifyEp == 0U))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (hcdc->NotifyState != 0U)
+  {
+    return (uint8_t)USBD_BUSY;
+  }
+
+  hcdc->NotifyState = 1U;
+  (void)USBD_LL_Transmit(pdev, CDCCmdEpAdd[pdev->classId], pbuf, length);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_GrantCredit
+  *         Grant the host more OUT transfers, see USBD_CDC_CreditTypeDef. The
+  *         grant is kept in every setting and sent in CDC_ALT_BULK_INTR, where
+  *         grants made while a message is in flight go out in the next one.
+  *         Callable from the USB interrupt and from thread mode.
+  * @param  pdev: device instance
+  * @param  count: receive buffers handed back to the endpoint
+  * @retval status
+  */
+uint8_t USBD_CDC_GrantCredit(USBD_HandleTypeDef *pdev, uint32_t count)
+{
+  return USBD_CDC_GrantCreditFunc(pdev, (uint8_t)pdev->classId, count);
+}
+
+/**
+  * @brief  USBD_CDC_GrantCreditFunc
+  *         USBD_CDC_GrantCredit for a given function, from any context
+  * @param  pdev: device instance
+  * @param  func: function index, below USBD_CDC_FUNC_NUM
+  * @param  count: receive buffers handed back to the endpoint
+  * @retval status
+  */
+uint8_t USBD_CDC_GrantCreditFunc(USBD_HandleTypeDef *pdev, uint8_t func, uint32_t count)
+{
+  USBD_CDC_HandleTypeDef *hcdc;
+  uint32_t primask;
+
+  if (func >= USBD_CDC_FUNC_NUM)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[func];
+  if (hcdc == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  /* The completion of the message in flight sends the next one */
+  primask = __get_PRIMASK();
+  __disable_irq();
+  hcdc->CreditGranted += count;
+  USBD_CDC_SendCredit(pdev, hcdc, 0U);
+  __set_PRIMASK(primask);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_SendCredit
+  *         Send the current grant if it is newer than the last one sent
+  * @param  pdev: device instance
+  * @param  hcdc: class handle
+  * @param  force: 1 to send it even if the host has it already
+  * @retval None
+  */
+static void USBD_CDC_SendCredit(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc, uint8_t force)
+{
+  if ((USBD_CDC_AltTable[hcdc->AltSetting].NotifyEp == 0U) || (hcdc->NotifyState != 0U) ||
+      ((force == 0U) && (hcdc->CreditSent == hcdc->CreditGranted)))
+  {
+    return;
+  }
+
+  hcdc->CreditMsg.Type = CDC_NOTIFY_CREDIT;
+  hcdc->CreditMsg.Reserved = 0U;
+  hcdc->CreditMsg.XferSize = (uint16_t)hcdc->RxXferSize;
+  hcdc->CreditMsg.Granted = hcdc->CreditGranted;
+
+  if (USBD_CDC_SendNotify(pdev, (uint8_t *)&hcdc->CreditMsg, sizeof(USBD_CDC_CreditTypeDef)) == (uint8_t)USBD_OK)
+  {
+    hcdc->CreditSent = hcdc->CreditMsg.Granted;
+  }
+}
+
+/**
+  * @brief  USBD_CDC_CountXfer
+  *         Account a completed transfer, called between CDC_STATS_BEGIN/END
+  * @param  stats: endpoint counters
+  * @param  length: bytes transferred
+  * @param  xfer_size: bytes requested, a shorter multiple of mps ended on a ZLP
+  * @param  mps: endpoint max packet size
+  * @retval None
+  */
+static void USBD_CDC_CountXfer(USBD_CDC_EpStatsTypeDef *stats, uint32_t length,
+                               uint32_t xfer_size, uint32_t mps)
+{
+  uint32_t packets = (length + mps - 1U) / mps;
+
+  if ((length % mps) != 0U)
+  {
+    stats->ShortPackets++;
+  }
+  else if (length < xfer_size)
+  {
+    stats->Zlps++;
+    packets++;
+  }
+  else
+  {
+    /* Transfer ended on a full packet */
+  }
+
+  stats->Bytes += length;
+  stats->Packets += packets;
+}
+
+/**
+  * @brief  USBD_CDC_GetStats
+  *         Take a consistent copy of the counters without masking the USB
+  *         interrupt; retried while an update is in progress
+  * @param  pStats: destination
+  * @retval None
+  */
+void USBD_CDC_GetStats(USBD_CDC_StatsTypeDef *pStats)
+{
+  /* TxBusy is not bracketed by Seq, a single word is copied whole anyway */
+  pStats->Seq = USBD_SeqRead(&USBD_CDC_Stats.Seq, pStats, &USBD_CDC_Stats, sizeof(USBD_CDC_StatsTypeDef));
+}
+
+/**
+  * @brief  USBD_CDC_CountTxBusy
+  *         Count a transmit request rejected because the IN endpoint is busy.
+  *         Reached from thread context and from the DataIn interrupt, so the
+  *         increment is exclusive rather than bracketed by Seq
+  * @retval None
+  */
+void USBD_CDC_CountTxBusy(void)
+{
+  __IO uint32_t *pCount = &USBD_CDC_Stats.TxBusy;
+  uint32_t v;
+
+  do
+  {
+    v = __LDREXW(pCount);
+  } while (__STREXW(v + 1U, pCount) != 0U);
+}
+
+/**
+  * @brief  USBD_CDC_Profile
+  *         Record the cost of finding the function of a completed endpoint
+  *         against the handler that follows, both in CPU cycles
+  * @param  dispatch: cycles spent on the lookup
+  * @param  handler: cycles spent in DataIn/DataOut of the function
+  * @retval None
+  */
+static void USBD_CDC_Profile(uint32_t dispatch, uint32_t handler)
+{
+  CDC_STATS_BEGIN();
+  USBD_CDC_Stats.DispatchCycles = dispatch;
+  if (dispatch > USBD_CDC_Stats.DispatchMax)
+  {
+    USBD_CDC_Stats.DispatchMax = dispatch;
+  }
+  if (handler > USBD_CDC_Stats.HandlerMax)
+  {
+    USBD_CDC_Stats.HandlerMax = handler;
+  }
+  CDC_STATS_END();
+}
+
+/**
+  * @brief  USBD_CDC_CheckParams
+  *         Validate a transport parameter set sent by the host
+  * @param  params: parameter set
+  * @retval 1 if the set can be applied, 0 otherwise
+  */
+static uint8_t USBD_CDC_CheckParams(const USBD_CDC_ParamsTypeDef *params)
+{
+  if ((params->RxXferSize < CDC_DATA_FS_OUT_PACKET_SIZE) ||
+      (params->RxXferSize > CDC_RX_XFER_MAX_SIZE) ||
+      ((params->RxXferSize % CDC_DATA_FS_OUT_PACKET_SIZE) != 0U))
+  {
+    return 0U;
+  }
+
+  /* The LL minimums, and a full bulk packet in the EP1 Tx FIFO; the LL
+     layer re-checks the total */
+  if ((params->RxFifoSize < USBD_FS_RX_FIFO_MIN_SIZE) || (params->Tx0FifoSize < USBD_FS_TX0_FIFO_MIN_SIZE) ||
+      (params->Tx1FifoSize < USBD_FS_TX_FIFO_MIN_SIZE) ||
+      ((params->Tx1FifoSize * 4U) < CDC_DATA_FS_MAX_PACKET_SIZE) ||
+      (((uint32_t)params->RxFifoSize + params->Tx0FifoSize + params->Tx1FifoSize) >
+       (USBD_FS_FIFO_TOTAL_SIZE - USBD_FS_TX3_FIFO_SIZE)))
+  {
+    return 0U;
+  }
+
+  if ((params->TxFifoEmptyLvl > 1U) || (params->TxFifoPrefill > 1U))
+  {
+    return 0U;
+  }
+
+  return 1U;
+}
+
+/**
+  * @brief  USBD_CDC_GetParams
+  *         Transport parameters in use since the last SetConfiguration
+  * @retval pointer to the parameter set
+  */
+const USBD_CDC_ParamsTypeDef *USBD_CDC_GetParams(void)
+{
+  return &USBD_CDC_Params;
+}
+
+/**
+  * @brief  USBD_CDC_ResyncEP
+  *         Bring the class state of a data endpoint back in line with an
+  *         endpoint whose transfer was just aborted
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval None
+  */
+static void USBD_CDC_ResyncEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+
+  if (hcdc == NULL)
+  {
+    return;
+  }
+
+  if (ep_addr == CDCInEpAdd[pdev->classId])
+  {
+    /* The pending IN data is lost, let the application send again */
+    USBD_CDC_TxAbort(pdev, hcdc);
+    USBD_CDC_Recovery.InResync++;
+  }
+  else if (ep_addr == CDCOutEpAdd[pdev->classId])
+  {
+    /* The abort leaves RxState alone: re-arm only a buffer the class still
+       owned, one handed to the application comes back with its credit */
+    if (hcdc->RxState != 0U)
+    {
+      hcdc->RxState = 0U;
+      (void)USBD_CDC_ReceivePacket(pdev);
+    }
+    USBD_CDC_Recovery.OutResync++;
+  }
+  else
+  {
+    /* Command endpoint, nothing queued */
+  }
+}
+
+/**
+  * @brief  USBD_CDC_TxAbort
+  *         Drop the IN transfer of the selected function after its endpoint
+  *         was aborted, and hand its buffer back with CDC_TX_ABORTED so the
+  *         application does not wait for a completion that never comes
+  * @param  pdev: device instance
+  * @param  hcdc: class handle of pdev->classId
+  * @retval None
+  */
+static void USBD_CDC_TxAbort(USBD_HandleTypeDef *pdev, USBD_CDC_HandleTypeDef *hcdc)
+{
+  USBD_CDC_ItfTypeDef *fops = (USBD_CDC_ItfTypeDef *)pdev->pUserData[pdev->classId];
+  uint32_t busy = hcdc->TxState;
+
+  pdev->ep_in[CDCInEpAdd[pdev->classId] & 0xFU].total_length = 0U;
+  hcdc->TxState = 0U;
+  hcdc->TxOffset = 0U;
+  hcdc->TxChunk = 0U;
+
+  if ((busy != 0U) && (fops != NULL) && (fops->TransmitCplt != NULL))
+  {
+    (void)fops->TransmitCplt(hcdc->TxBuffer, &hcdc->TxLength,
+                             (uint8_t)((CDCInEpAdd[pdev->classId] & 0xFU) | CDC_TX_ABORTED));
+  }
+}
+
+/**
+  * @brief  USBD_CDC_ResetEndpoints
+  *         Abort both data endpoints and restart them from a clean state
+  *         without re-enumerating, e.g. after the host gave up on a transfer
+  * @param  pdev: device instance
+  * @retval status
+  */
+uint8_t USBD_CDC_ResetEndpoints(USBD_HandleTypeDef *pdev)
+{
+  if ((pdev->pClassDataCmsit[pdev->classId] == NULL) ||
+      (pdev->dev_state != USBD_STATE_CONFIGURED))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (USBD_LL_AbortEP(pdev, CDCInEpAdd[pdev->classId]) != USBD_OK)
+  {
+    USBD_CDC_Recovery.AbortErrors++;
+  }
+  (void)USBD_LL_FlushEP(pdev, CDCInEpAdd[pdev->classId]);
+
+  if (USBD_LL_AbortEP(pdev, CDCOutEpAdd[pdev->classId]) != USBD_OK)
+  {
+    USBD_CDC_Recovery.AbortErrors++;
+  }
+
+  USBD_CDC_ResyncEP(pdev, CDCInEpAdd[pdev->classId]);
+  USBD_CDC_ResyncEP(pdev, CDCOutEpAdd[pdev->classId]);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_GetRecoveryStats
+  *         Endpoint recovery counters
+  * @retval pointer to the counters
+  */
+const USBD_CDC_RecoveryTypeDef *USBD_CDC_GetRecoveryStats(void)
+{
+  return &USBD_CDC_Recovery;
+}
+
+/**
+  * @brief  USBD_CDC_FuncFromEP
+  *         Function owning an endpoint; the shared notification endpoint
+  *         and anything unknown belong to the first one
+  * @param  epnum: endpoint number or address
+  * @retval function index
+  */
+static uint32_t USBD_CDC_FuncFromEP(uint8_t epnum)
+{
+  return CDCEpFunc[epnum & 0xFU];
+}
+
+/**
+  * @brief  USBD_CDC_FuncFromReq
+  *         Function a control request is addressed to
+  * @param  req: usb request
+  * @retval function index
+  */
+static uint32_t USBD_CDC_FuncFromReq(const USBD_SetupReqTypedef *req)
+{
+  uint32_t fn = 0U;
+
+  switch (req->bmRequest & USB_REQ_RECIPIENT_MASK)
+  {
+    case USB_REQ_RECIPIENT_INTERFACE:
+      for (fn = USBD_CDC_FUNC_NUM - 1U; fn > 0U; fn--)
+      {
+        if (LOBYTE(req->wIndex) == CDCItfNum[fn])
+        {
+          break;
+        }
+      }
+      break;
+
+    case USB_REQ_RECIPIENT_ENDPOINT:
+      fn = USBD_CDC_FuncFromEP(LOBYTE(req->wIndex));
+      break;
+
+    default:
+      break;
+  }
+
+  return fn;
+}
+
+/**
+  * @brief  USBD_CDC_ReceivePacket
+  *         prepare OUT Endpoint for reception
+  * @param  pdev: device instance
+  * @retval status
+  */
+uint8_t  USBD_CDC_ReceivePacket(USBD_HandleTypeDef *pdev)
+{
+ // USBD_CDC_HandleTypeDef   *hcdc = (USBD_CDC_HandleTypeDef*) pdev->pClassData;
+	USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+  /* Suspend or Resume USB Out process */
+
+	 if (pdev->pClassDataCmsit[pdev->classId] == NULL)
+	  {
+	    return (uint8_t)USBD_FAIL;
+	  }
+
+	  hcdc->RxState = 1U;
+
+	  if (hcdc->RxHdrLength != 0U)
+	  {
+	    /* Header and payload land in separate buffers */
+	    (void)USBD_LL_PrepareReceiveSplit(pdev, CDCOutEpAdd[pdev->classId], hcdc->RxHdrBuffer, hcdc->RxHdrLength,
+	                                      hcdc->RxBuffer, hcdc->RxPayloadSize);
+	  }
+	  else if (pdev->dev_speed == USBD_SPEED_HIGH)
 	  {
 	    /* Prepare Out endpoint to receive next packet */
-	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd, hcdc->RxBuffer,
+	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd[pdev->classId], hcdc->RxBuffer,
 	                                 CDC_DATA_HS_OUT_PACKET_SIZE);
 	  }
 	  else
 	  {
 	    /* Prepare Out endpoint to receive next packet */
-	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd, hcdc->RxBuffer,
-	                                 CDC_DATA_FS_OUT_PACKET_SIZE);
+	    (void)USBD_LL_PrepareReceive(pdev, CDCOutEpAdd[pdev->classId], hcdc->RxBuffer,
+	                                 hcdc->RxXferSize);
 	  }
 
 	  return (uint8_t)USBD_OK;
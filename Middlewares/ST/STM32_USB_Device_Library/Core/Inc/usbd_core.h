@@ -97,6 +97,8 @@ uint8_t USBD_CoreGetEPAdd(USBD_HandleTypeDef *pdev, uint8_t ep_dir, uint8_t ep_t
 
 uint8_t USBD_CoreFindIF(USBD_HandleTypeDef *pdev, uint8_t index);
 uint8_t USBD_CoreFindEP(USBD_HandleTypeDef *pdev, uint8_t index);
+USBD_StatusTypeDef USBD_CoreBindEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t classId,
+                                   USBD_EpFuncTypeDef pFunc);
 
 USBD_StatusTypeDef USBD_RunTestMode(USBD_HandleTypeDef *pdev);
 USBD_StatusTypeDef USBD_SetClassConfig(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
@@ -129,6 +131,16 @@ USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
 
 USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
 USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+USBD_StatusTypeDef USBD_LL_AbortEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+USBD_StatusTypeDef USBD_LL_SetFifoLayout(USBD_HandleTypeDef *pdev, uint16_t rx_size,
+                                         uint16_t tx0_size, uint16_t tx1_size,
+                                         uint16_t tx2_size);
+uint32_t USBD_LL_Poll(USBD_HandleTypeDef *pdev, uint32_t max_passes);
+void USBD_LL_GetLpmStats(USBD_HandleTypeDef *pdev, USBD_LPM_StatsTypeDef *pStats);
+USBD_StatusTypeDef USBD_LL_RemoteWakeup(USBD_HandleTypeDef *pdev);
+uint32_t USBD_LL_RemoteWakeupPending(USBD_HandleTypeDef *pdev);
+USBD_StatusTypeDef USBD_LL_SetTxFifoRefill(USBD_HandleTypeDef *pdev, uint8_t empty_level,
+                                           uint8_t prefill);
 USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
 USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
 USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_addr);
@@ -136,9 +148,16 @@ USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_a
 USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
                                     uint8_t *pbuf, uint32_t size);
 
+USBD_StatusTypeDef USBD_LL_TransmitSeg(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                       const USBD_SegTypeDef *pSeg, uint32_t SegNum);
+
 USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
                                           uint8_t *pbuf, uint32_t size);
 
+USBD_StatusTypeDef USBD_LL_PrepareReceiveSplit(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                               uint8_t *phdr, uint32_t hdr_size,
+                                               uint8_t *pbuf, uint32_t size);
+
 #ifdef USBD_HS_TESTMODE_ENABLE
 USBD_StatusTypeDef USBD_LL_SetTestMode(USBD_HandleTypeDef *pdev, uint8_t testmode);
 #endif /* USBD_HS_TESTMODE_ENABLE */
@@ -62,6 +62,10 @@ extern "C" {
 #endif /* USBD_MAX_SUPPORTED_CLASS */
 #endif /* USE_USBD_COMPOSITE */
 
+#ifndef USBD_MAX_EP_NUM
+#define USBD_MAX_EP_NUM                                16U
+#endif /* USBD_MAX_EP_NUM */
+
 #ifndef USBD_MAX_CLASS_ENDPOINTS
 #define USBD_MAX_CLASS_ENDPOINTS                       5U
 #endif /* USBD_MAX_CLASS_ENDPOINTS */
@@ -74,6 +78,10 @@ extern "C" {
 #define USBD_LPM_ENABLED                                0U
 #endif /* USBD_LPM_ENABLED */
 
+#ifndef USBD_DIRECT_DISPATCH
+#define USBD_DIRECT_DISPATCH                            0U
+#endif /* USBD_DIRECT_DISPATCH */
+
 #ifndef USBD_SELF_POWERED
 #define USBD_SELF_POWERED                               1U
 #endif /*USBD_SELF_POWERED */
@@ -203,6 +211,29 @@ typedef  struct  usb_setup_req
   uint16_t  wLength;
 } USBD_SetupReqTypedef;
 
+/* One buffer of a scatter-gather IN transfer, layout matches PCD_SegTypeDef */
+typedef struct
+{
+  uint8_t   *pbuf;
+  uint32_t  len;
+} USBD_SegTypeDef;
+
+/* LPM L1 accounting kept by the low level driver. Only the bodies of the
+   LPM callbacks are timed, in DWT CYCCNT: the counter stops with the core
+   clock, so it sees neither the time spent in L1 nor the wakeup from STOP */
+typedef struct
+{
+  __IO uint32_t Seq;          /* odd while an update is in progress */
+  uint32_t  L1Entries;
+  uint32_t  L1Exits;
+  uint32_t  StopEntries;      /* entries that let the core go down to STOP */
+  uint32_t  Besl;             /* BESL of the last LPM token */
+  uint32_t  SuspendCbCycles;  /* L1 callback, PHY clock gated and stack suspended, last entry */
+  uint32_t  SuspendCbCyclesMax;
+  uint32_t  ResumeCbCycles;   /* L0 callback, clocks restored and stack resumed, last exit */
+  uint32_t  ResumeCbCyclesMax;
+} USBD_LPM_StatsTypeDef;
+
 typedef struct
 {
   uint8_t   bLength;
@@ -303,14 +334,20 @@ typedef struct
 } USBD_DescriptorsTypeDef;
 
 /* USB Device handle structure */
+typedef uint8_t (*USBD_EpFuncTypeDef)(struct _USBD_HandleTypeDef *pdev, uint8_t epnum);
+
 typedef struct
 {
-  uint32_t status;
-  uint32_t total_length;
-  uint32_t rem_length;
+  uint32_t rem_length;          /* per packet fields first */
   uint32_t maxpacket;
+  uint32_t total_length;
+  uint32_t status;
   uint16_t is_used;
   uint16_t bInterval;
+#if (USBD_DIRECT_DISPATCH == 1U)
+  USBD_EpFuncTypeDef pDataFunc; /* data stage handler bound by USBD_CoreBindEP, NULL: via usbd_core */
+  uint32_t classId;             /* pdev->classId for pDataFunc */
+#endif /* USBD_DIRECT_DISPATCH */
 } USBD_EndpointTypeDef;
 
 #ifdef USE_USBD_COMPOSITE
@@ -364,8 +401,8 @@ typedef struct _USBD_HandleTypeDef
   uint32_t                dev_default_config;
   uint32_t                dev_config_status;
   USBD_SpeedTypeDef       dev_speed;
-  USBD_EndpointTypeDef    ep_in[16];
-  USBD_EndpointTypeDef    ep_out[16];
+  USBD_EndpointTypeDef    ep_in[USBD_MAX_EP_NUM];
+  USBD_EndpointTypeDef    ep_out[USBD_MAX_EP_NUM];
   __IO uint32_t           ep0_state;
   uint32_t                ep0_data_len;
   __IO uint8_t            dev_state;
@@ -428,6 +465,35 @@ __STATIC_INLINE uint16_t SWAPBYTE(uint8_t *addr)
   return _SwapVal;
 }
 
+/* Counters written from one context, the USB interrupt, and copied from any
+   other without masking it: Seq is odd while an update is in progress */
+#define USBD_SEQ_BEGIN(seq)  do { (seq)++; __DMB(); } while (0)
+#define USBD_SEQ_END(seq)    do { __DMB(); (seq)++; } while (0)
+
+/**
+  * @brief  Copy data updated between USBD_SEQ_BEGIN and USBD_SEQ_END,
+  *         retried while an update is in progress or ends during the copy
+  * @param  pSeq: sequence count guarding the data
+  * @param  pDst: destination
+  * @param  pSrc: guarded data
+  * @param  len: bytes to copy
+  * @retval sequence count the copy is consistent with, even
+  */
+__STATIC_INLINE uint32_t USBD_SeqRead(const __IO uint32_t *pSeq, void *pDst, const void *pSrc, uint32_t len)
+{
+  uint32_t seq;
+
+  do
+  {
+    seq = *pSeq;
+    __DMB();
+    (void)USBD_memcpy(pDst, pSrc, len);
+    __DMB();
+  } while (((seq & 1U) != 0U) || (seq != *pSeq));
+
+  return seq;
+}
+
 #ifndef LOBYTE
 #define LOBYTE(x)  ((uint8_t)((x) & 0x00FFU))
 #endif /* LOBYTE */
@@ -824,6 +824,15 @@ USBD_StatusTypeDef USBD_LL_Reset(USBD_HandleTypeDef *pdev)
   }
 #endif /* USE_USBD_COMPOSITE */
 
+#if (USBD_DIRECT_DISPATCH == 1U)
+  /* Nothing stays bound past a reset, whatever the class left */
+  for (uint32_t i = 0U; i < USBD_MAX_EP_NUM; i++)
+  {
+    pdev->ep_in[i].pDataFunc = NULL;
+    pdev->ep_out[i].pDataFunc = NULL;
+  }
+#endif /* USBD_DIRECT_DISPATCH */
+
   /* Open EP0 OUT */
   (void)USBD_LL_OpenEP(pdev, 0x00U, USBD_EP_TYPE_CTRL, USB_MAX_EP0_SIZE);
   pdev->ep_out[0x00U & 0xFU].is_used = 1U;
@@ -1116,6 +1125,43 @@ uint8_t USBD_CoreFindEP(USBD_HandleTypeDef *pdev, uint8_t index)
 #endif /* USE_USBD_COMPOSITE */
 }
 
+/**
+  * @brief  USBD_CoreBindEP
+  *         Bind the data stage of a non-control endpoint to a class handler.
+  *         With USBD_DIRECT_DISPATCH the low level driver calls it on every
+  *         completion, without the usbd_core class lookup; otherwise the
+  *         binding is ignored and DataIn/DataOut of the class are used.
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @param  classId: value of pdev->classId for the handler
+  * @param  pFunc: handler, NULL to go back through usbd_core
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_CoreBindEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t classId,
+                                   USBD_EpFuncTypeDef pFunc)
+{
+#if (USBD_DIRECT_DISPATCH == 1U)
+  USBD_EndpointTypeDef *pep;
+
+  if (((ep_addr & 0x7FU) == 0U) || ((ep_addr & 0x7FU) >= USBD_MAX_EP_NUM))
+  {
+    return USBD_FAIL;
+  }
+
+  pep = ((ep_addr & 0x80U) == 0x80U) ? &pdev->ep_in[ep_addr & 0xFU] : &pdev->ep_out[ep_addr & 0xFU];
+
+  pep->classId = classId;
+  pep->pDataFunc = pFunc;
+#else
+  UNUSED(pdev);
+  UNUSED(ep_addr);
+  UNUSED(classId);
+  UNUSED(pFunc);
+#endif /* USBD_DIRECT_DISPATCH */
+
+  return USBD_OK;
+}
+
 #ifdef USE_USBD_COMPOSITE
 /**
   * @brief  USBD_CoreGetEPAdd
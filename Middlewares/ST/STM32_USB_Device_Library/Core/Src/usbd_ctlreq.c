@@ -261,6 +261,13 @@ USBD_StatusTypeDef USBD_StdEPReq(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
       break;
 
     case USB_REQ_TYPE_STANDARD:
+      /* wIndex comes from the host, ep_in/ep_out only hold the endpoints in use */
+      if ((ep_addr & 0x7FU) >= USBD_MAX_EP_NUM)
+      {
+        USBD_CtlError(pdev, req);
+        break;
+      }
+
       switch (req->bRequest)
       {
         case USB_REQ_SET_FEATURE:
@@ -317,6 +324,12 @@ USBD_StatusTypeDef USBD_StdEPReq(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
               {
                 if ((ep_addr & 0x7FU) != 0x00U)
                 {
+                  /* Drop the transfer left on the endpoint, the class re-arms it below */
+                  (void)USBD_LL_AbortEP(pdev, ep_addr);
+                  if ((ep_addr & 0x80U) == 0x80U)
+                  {
+                    (void)USBD_LL_FlushEP(pdev, ep_addr);
+                  }
                   (void)USBD_LL_ClearStallEP(pdev, ep_addr);
                 }
                 (void)USBD_CtlSendStatus(pdev);
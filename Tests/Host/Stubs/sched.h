@@ -0,0 +1,18 @@
+/**
+  ******************************************************************************
+  * @file           : sched.h
+  * @brief          : Host stand-in for the scheduler: signals are recorded
+  *                   and the test runs the tasks itself.
+  ******************************************************************************
+  */
+
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#include "stm32f7xx_hal.h"
+
+#define SCHED_NO_TASK             0xFFFFFFFFU
+
+void SCHED_Signal(uint32_t Id);
+
+#endif /* __SCHED_H */
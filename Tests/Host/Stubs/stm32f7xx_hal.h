@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file           : stm32f7xx_hal.h
+  * @brief          : Host stand-in for the HAL: the types, core registers and
+  *                   CMSIS intrinsics the tested modules use, nothing else.
+  ******************************************************************************
+  */
+
+#ifndef __STM32F7xx_HAL_H
+#define __STM32F7xx_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO                      volatile
+#define UNUSED(X)                 (void)(X)
+
+typedef enum
+{
+  HAL_OK      = 0x00U,
+  HAL_ERROR   = 0x01U,
+  HAL_BUSY    = 0x02U,
+  HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+  __IO uint32_t CYCCNT;
+} DWT_Type;
+
+extern DWT_Type HOST_Dwt;
+#define DWT                       (&HOST_Dwt)
+
+uint32_t HAL_GetTick(void);
+
+#define __DMB()                   __sync_synchronize()
+
+static inline int32_t __SSAT(int32_t val, uint32_t sat)
+{
+  const int32_t max = (int32_t)((1U << (sat - 1U)) - 1U);
+  const int32_t min = -max - 1;
+
+  return (val > max) ? max : ((val < min) ? min : val);
+}
+
+static inline uint64_t __SMLALD(uint32_t op1, uint32_t op2, uint64_t acc)
+{
+  return (uint64_t)((int64_t)acc + ((int32_t)(int16_t)op1 * (int16_t)op2) +
+                    ((int32_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16)));
+}
+
+static inline uint32_t __UNALIGNED_UINT32_READ(const void *addr)
+{
+  uint32_t v;
+
+  __builtin_memcpy(&v, addr, sizeof(v));
+  return v;
+}
+
+#endif /* __STM32F7xx_HAL_H */
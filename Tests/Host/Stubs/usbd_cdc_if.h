@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_if.h
+  * @brief          : Host stand-in for the CDC interface, force included so
+  *                   it takes the place of the real one: a device handle with
+  *                   the fields the streams look at and an IN endpoint the
+  *                   test completes or aborts by hand.
+  ******************************************************************************
+  */
+
+#ifndef __USBD_CDC_IF_H__
+#define __USBD_CDC_IF_H__
+
+#include "stm32f7xx_hal.h"
+
+#define USBD_STATE_CONFIGURED     0x03U
+#define USBD_STATE_SUSPENDED      0x04U
+
+#define CDC_TX_ABORTED            0x80U
+
+typedef enum
+{
+  USBD_OK = 0U,
+  USBD_BUSY,
+  USBD_EMEM,
+  USBD_FAIL,
+} USBD_StatusTypeDef;
+
+typedef struct
+{
+  __IO uint32_t TxState;
+} USBD_CDC_HandleTypeDef;
+
+typedef struct
+{
+  __IO uint8_t dev_state;
+  void         *pClassData;
+  void         *pClassDataCmsit[2];
+} USBD_HandleTypeDef;
+
+uint8_t CDC_Transmit_FS(uint8_t *Buf, uint16_t Len);
+USBD_StatusTypeDef USBD_LL_RemoteWakeup(USBD_HandleTypeDef *pdev);
+uint32_t USBD_LL_RemoteWakeupPending(USBD_HandleTypeDef *pdev);
+
+#endif /* __USBD_CDC_IF_H__ */
@@ -0,0 +1,210 @@
+/**
+  ******************************************************************************
+  * @file           : test_decim.c
+  * @brief          : Host test of the decimation stage: configurations it
+  *                   must refuse, CIC DC gain, FIR impulse response and
+  *                   phase, and state carried across calls.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "decim.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK(cond)                                                            \
+  do                                                                           \
+  {                                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+      (void)printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                  \
+      Failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Failures;
+
+/* Private functions ---------------------------------------------------------*/
+static HAL_StatusTypeDef InitCic(DECIM_InstanceTypeDef *pDec, uint32_t Order, uint32_t Rate)
+{
+  DECIM_InitTypeDef init = {0};
+
+  init.CicOrder = Order;
+  init.CicRate = Rate;
+  init.FirRate = 1U;
+  return DECIM_Init(pDec, &init);
+}
+
+/* Configurations the stage cannot run, the CIC growth ones included */
+static void TestInit(void)
+{
+  DECIM_InstanceTypeDef dec;
+  DECIM_InitTypeDef init = {0};
+
+  init.CicOrder = 1U;
+  init.CicRate = 0U;
+  init.FirRate = 1U;
+  CHECK(DECIM_Init(&dec, &init) == HAL_ERROR);
+  init.CicRate = 1U;
+  init.FirRate = 2U;
+  CHECK(DECIM_Init(&dec, &init) == HAL_ERROR);          /* FIR rate without taps */
+  init.FirRate = 1U;
+  init.FirTaps = 4U;
+  CHECK(DECIM_Init(&dec, &init) == HAL_ERROR);          /* taps without buffers */
+
+  CHECK(InitCic(&dec, 0U, 4U) == HAL_ERROR);
+  CHECK(InitCic(&dec, DECIM_CIC_MAX_ORDER + 1U, 2U) == HAL_ERROR);
+
+  /* Growth right at the limit, just past it, and so far past it that
+     Rate^Order no longer fits 64 bits */
+  CHECK(InitCic(&dec, 1U, 1UL << DECIM_CIC_MAX_GROWTH) == HAL_OK);
+  CHECK(dec.CicShift == DECIM_CIC_MAX_GROWTH);
+  CHECK(InitCic(&dec, 4U, 16U) == HAL_OK);
+  CHECK(dec.CicShift == 16U);
+  CHECK(InitCic(&dec, 1U, (1UL << DECIM_CIC_MAX_GROWTH) + 1U) == HAL_ERROR);
+  CHECK(InitCic(&dec, 5U, 8192U) == HAL_ERROR);
+  CHECK(InitCic(&dec, 5U, 0xFFFFFFFFU) == HAL_ERROR);
+}
+
+/* A CIC passes DC at Rate^Order / 2^CicShift once its combs have filled */
+static void TestCicDc(uint32_t Order, uint32_t Rate, int16_t Level, int16_t Expect)
+{
+  DECIM_InstanceTypeDef dec;
+  int16_t in[512];
+  int16_t out[64];
+  uint32_t len = sizeof(in) / sizeof(in[0]);
+  uint32_t n;
+  uint32_t i;
+
+  for (i = 0U; i < len; i++)
+  {
+    in[i] = Level;
+  }
+  CHECK(InitCic(&dec, Order, Rate) == HAL_OK);
+  n = DECIM_Process(&dec, in, &len, out, 64U);
+  CHECK(n == ((sizeof(in) / sizeof(in[0])) / Rate));
+  CHECK(len == (sizeof(in) / sizeof(in[0])));
+  for (i = Order; i < n; i++)
+  {
+    CHECK(out[i] == Expect);
+  }
+}
+
+/* An impulse of -1.0 brings the taps back out, exactly and in order */
+static void TestFirImpulse(uint32_t Taps)
+{
+  static const int16_t b[5] = {1000, -2000, 3000, -4000, 5000};
+  DECIM_InstanceTypeDef dec;
+  DECIM_InitTypeDef init = {0};
+  int16_t coeffs[5];
+  int16_t state[10];
+  int16_t in[8] = {-32768};
+  int16_t out[8];
+  uint32_t len = 8U;
+  uint32_t i;
+
+  /* Stored time reversed */
+  for (i = 0U; i < Taps; i++)
+  {
+    coeffs[i] = b[Taps - 1U - i];
+  }
+  init.CicRate = 1U;
+  init.FirRate = 1U;
+  init.FirTaps = Taps;
+  init.pFirCoeffs = coeffs;
+  init.pFirState = state;
+  CHECK(DECIM_Init(&dec, &init) == HAL_OK);
+
+  CHECK(DECIM_Process(&dec, in, &len, out, 8U) == 8U);
+  for (i = 0U; i < 8U; i++)
+  {
+    CHECK(out[i] == ((i < Taps) ? -b[i] : 0));
+  }
+
+  /* Decimating by 2 keeps every second output of the same filter */
+  init.FirRate = 2U;
+  CHECK(DECIM_Init(&dec, &init) == HAL_OK);
+  len = 8U;
+  CHECK(DECIM_Process(&dec, in, &len, out, 8U) == 4U);
+  for (i = 0U; i < 4U; i++)
+  {
+    CHECK(out[i] == (((2U * i) + 1U < Taps) ? -b[(2U * i) + 1U] : 0));
+  }
+}
+
+/* Small destinations and dropped output leave the same filter state as
+   one call over the whole block */
+static void TestChunks(void)
+{
+  static const int16_t coeffs[3] = {8192, 16384, 8192};
+  DECIM_InstanceTypeDef one;
+  DECIM_InstanceTypeDef many;
+  DECIM_InitTypeDef init = {0};
+  int16_t stateOne[6];
+  int16_t stateMany[6];
+  int16_t in[240];
+  int16_t ref[40];
+  int16_t out[40];
+  uint32_t done = 0U;
+  uint32_t got = 0U;
+  uint32_t len;
+  uint32_t i;
+
+  for (i = 0U; i < 240U; i++)
+  {
+    in[i] = (int16_t)((i * 2731U) & 0x3FFFU) - 0x2000;
+  }
+  init.CicOrder = 2U;
+  init.CicRate = 3U;
+  init.FirRate = 2U;
+  init.FirTaps = 3U;
+  init.pFirCoeffs = coeffs;
+  init.pFirState = stateOne;
+  CHECK(DECIM_Init(&one, &init) == HAL_OK);
+  init.pFirState = stateMany;
+  CHECK(DECIM_Init(&many, &init) == HAL_OK);
+
+  len = 240U;
+  CHECK(DECIM_Process(&one, in, &len, ref, 40U) == 40U);
+  CHECK(len == 240U);
+
+  /* Three outputs at a time, dropping outputs 10 to 12 on the way */
+  while (done < 240U)
+  {
+    len = 240U - done;
+    if (got == 9U)
+    {
+      len = 18U;
+      CHECK(DECIM_Process(&many, &in[done], &len, NULL, 0U) == 3U);
+      got += 3U;
+    }
+    else
+    {
+      got += DECIM_Process(&many, &in[done], &len, &out[got], 3U);
+    }
+    done += len;
+  }
+  CHECK(got == 40U);
+  CHECK(memcmp(out, ref, 9U * sizeof(int16_t)) == 0);
+  CHECK(memcmp(&out[12], &ref[12], 28U * sizeof(int16_t)) == 0);
+}
+
+int main(void)
+{
+  TestInit();
+  TestCicDc(3U, 8U, 10000, 10000);           /* 512, shift 9 */
+  TestCicDc(2U, 10U, 10000, 7812);           /* 100 / 128 */
+  TestCicDc(5U, 9U, -20000, -18021);         /* 59049 / 65536 */
+  TestFirImpulse(4U);
+  TestFirImpulse(5U);
+  TestChunks();
+
+  if (Failures != 0U)
+  {
+    (void)printf("%lu failed\n", (unsigned long)Failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,359 @@
+/**
+  ******************************************************************************
+  * @file           : test_stream.c
+  * @brief          : Host test of the CDC streams: ring indexes, the service
+  *                   task and how it retires, retries and rotates transfers.
+  *
+  *                   The IN endpoint is a stand-in that takes one transfer
+  *                   at a time; the test completes or aborts it the way the
+  *                   USB interrupt would and then runs the service task.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define TASK_SERVICE              0U
+#define TASK_PRODUCER             1U
+
+#define CHECK(cond)                                                            \
+  do                                                                           \
+  {                                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+      (void)printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                  \
+      Failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+/* Stand-ins -----------------------------------------------------------------*/
+USBD_HandleTypeDef hUsbDeviceFS;
+DWT_Type HOST_Dwt;
+
+static USBD_CDC_HandleTypeDef Cdc;
+static uint8_t *EpBuf;
+static uint32_t EpLen;
+static uint32_t EpStarts;
+static uint32_t Signals;
+static uint32_t Failures;
+static USBD_StatusTypeDef WakeResult = USBD_OK;
+static uint32_t WakeCalls;
+
+uint32_t HAL_GetTick(void)
+{
+  return 0U;
+}
+
+void SCHED_Signal(uint32_t Id)
+{
+  if (Id != SCHED_NO_TASK)
+  {
+    Signals |= 1UL << Id;
+  }
+}
+
+uint8_t CDC_Transmit_FS(uint8_t *Buf, uint16_t Len)
+{
+  if (Cdc.TxState != 0U)
+  {
+    return USBD_BUSY;
+  }
+  Cdc.TxState = 1U;
+  EpBuf = Buf;
+  EpLen = Len;
+  EpStarts++;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_RemoteWakeup(USBD_HandleTypeDef *pdev)
+{
+  UNUSED(pdev);
+  WakeCalls++;
+  return WakeResult;
+}
+
+uint32_t USBD_LL_RemoteWakeupPending(USBD_HandleTypeDef *pdev)
+{
+  UNUSED(pdev);
+  return 0U;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/* The USB interrupt finishing the transfer on the endpoint */
+static void EpComplete(void)
+{
+  Cdc.TxState = 0U;
+  CDC_Stream_TxCplt();
+}
+
+/* The class dropping it, CDC_TX_ABORTED set in the TransmitCplt epnum */
+static void EpAbort(void)
+{
+  Cdc.TxState = 0U;
+  CDC_Stream_TxAbort();
+}
+
+static void Service(void)
+{
+  Signals &= ~(1UL << TASK_SERVICE);
+  CDC_Stream_Task(NULL);
+}
+
+static void Fill(uint8_t *pData, uint32_t Len, uint8_t First)
+{
+  uint32_t i;
+
+  for (i = 0U; i < Len; i++)
+  {
+    pData[i] = (uint8_t)(First + i);
+  }
+}
+
+/* A transfer out of a ring, wrapped and then carried on from the start */
+static void TestWrap(CDC_StreamTypeDef *pStream)
+{
+  uint8_t data[16];
+  uint8_t *dst;
+  uint32_t len;
+
+  Fill(data, sizeof(data), 0x00U);
+  CHECK(CDC_Stream_Write(pStream, data, 12U) == 12U);
+  CHECK((Signals & (1UL << TASK_SERVICE)) != 0U);
+  Service();
+  CHECK((EpStarts == 1U) && (EpLen == 12U) && (memcmp(EpBuf, data, 12U) == 0));
+  CHECK(CDC_Stream_Pending() == 12U);
+
+  /* Nothing starts while the endpoint is busy */
+  Service();
+  CHECK(EpStarts == 1U);
+
+  Signals = 0U;
+  EpComplete();
+  Service();
+  CHECK(pStream->Tail == 12U);
+  CHECK((Signals & (1UL << TASK_PRODUCER)) != 0U);
+  CHECK(CDC_Stream_Free(pStream) == 16U);
+
+  /* 4 bytes to the end of the buffer, 6 from its start */
+  Fill(data, 10U, 0x40U);
+  CHECK(CDC_Stream_Write(pStream, data, 10U) == 10U);
+  dst = CDC_Stream_Reserve(pStream, &len);
+  CHECK((dst == &pStream->pBuf[6]) && (len == 6U));
+  Service();
+  CHECK((EpLen == 4U) && (memcmp(EpBuf, data, 4U) == 0));
+  EpComplete();
+  Service();
+  CHECK((EpLen == 6U) && (EpBuf == pStream->pBuf) && (memcmp(EpBuf, &data[4], 6U) == 0));
+  EpComplete();
+  Service();
+  CHECK((pStream->Tail == 22U) && (CDC_Stream_Pending() == 0U));
+}
+
+/* A full ring takes what fits and counts the rest */
+static void TestFull(CDC_StreamTypeDef *pStream)
+{
+  uint8_t data[24];
+  uint32_t starts = EpStarts;
+
+  Fill(data, sizeof(data), 0x80U);
+  pStream->Dropped = 0U;
+  Cdc.TxState = 1U;                    /* endpoint held by someone else */
+  CHECK(CDC_Stream_Write(pStream, data, 24U) == 16U);
+  CHECK(pStream->Dropped == 8U);
+  CHECK(CDC_Stream_Free(pStream) == 0U);
+  Service();
+  CHECK(EpStarts == starts);
+
+  /* Its completion retries the stream */
+  EpComplete();
+  Service();
+  CHECK(EpStarts == (starts + 1U));
+  EpComplete();
+  Service();
+  EpComplete();
+  Service();
+  CHECK(CDC_Stream_Pending() == 0U);
+}
+
+/* A dropped transfer leaves its bytes in the ring and goes out again first */
+static void TestAbort(CDC_StreamTypeDef *pA, CDC_StreamTypeDef *pB)
+{
+  uint8_t a[4] = {0xA0U, 0xA1U, 0xA2U, 0xA3U};
+  uint8_t b[4] = {0xB0U, 0xB1U, 0xB2U, 0xB3U};
+  CDC_StreamTypeDef *sent;
+  uint32_t tail;
+  uint8_t first;
+
+  CHECK(CDC_Stream_Write(pA, a, 4U) == 4U);
+  CHECK(CDC_Stream_Write(pB, b, 4U) == 4U);
+  Service();
+  CHECK(EpLen == 4U);
+  first = EpBuf[0];
+  sent = (first == a[0]) ? pA : pB;
+  tail = sent->Tail;
+
+  EpAbort();
+  Service();
+  CHECK(sent->Tail == tail);
+  CHECK((EpLen == 4U) && (EpBuf[0] == first));
+
+  /* Dropped without a word: the endpoint is seen idle and the data retried */
+  Cdc.TxState = 0U;
+  Service();
+  CHECK(sent->Tail == tail);
+  CHECK((EpLen == 4U) && (EpBuf[0] == first));
+
+  EpComplete();
+  Service();
+  CHECK(sent->Tail == (tail + 4U));
+  CHECK((EpLen == 4U) && (EpBuf[0] != first));
+  EpComplete();
+  Service();
+  CHECK(CDC_Stream_Pending() == 0U);
+}
+
+/* Streams take turns, one transfer each */
+static void TestRoundRobin(CDC_StreamTypeDef *pA, CDC_StreamTypeDef *pB)
+{
+  uint8_t a[8];
+  uint8_t b[8];
+  uint8_t first;
+
+  Fill(a, sizeof(a), 0x10U);
+  Fill(b, sizeof(b), 0x20U);
+  (void)CDC_Stream_Write(pA, a, 4U);
+  (void)CDC_Stream_Write(pB, b, 4U);
+  Service();
+  first = EpBuf[0];
+  EpComplete();
+  (void)CDC_Stream_Write((first == a[0]) ? pA : pB, (first == a[0]) ? &a[4] : &b[4], 4U);
+  Service();
+  CHECK(EpBuf[0] != first);
+  EpComplete();
+  Service();
+  CHECK(EpBuf[0] == (uint8_t)(first + 4U));
+  EpComplete();
+  Service();
+  CHECK(CDC_Stream_Pending() == 0U);
+}
+
+/* Decimated samples go in as they fit, the rest runs through and is counted */
+static void TestWriteDecim(void)
+{
+  static int16_t samples[8];
+  static CDC_StreamTypeDef stream;
+  CDC_StreamTypeDef *pStream = &stream;
+  DECIM_InstanceTypeDef dec;
+  DECIM_InitTypeDef init = {0};
+  int16_t in[40];
+  int16_t out[8];
+  uint32_t i;
+
+  for (i = 0U; i < 40U; i++)
+  {
+    in[i] = 1000;
+  }
+  init.CicOrder = 1U;
+  init.CicRate = 2U;
+  init.FirRate = 1U;
+  CHECK(DECIM_Init(&dec, &init) == HAL_OK);
+  CHECK(CDC_Stream_Init(pStream, (uint8_t *)samples, sizeof(samples), SCHED_NO_TASK) == HAL_OK);
+  CHECK(CDC_Stream_Attach(pStream) == HAL_OK);
+
+  /* 20 samples out, room for 8 */
+  Cdc.TxState = 1U;
+  CHECK(CDC_Stream_WriteDecim(pStream, &dec, in, 40U) == 8U);
+  CHECK(pStream->Dropped == (12U * sizeof(int16_t)));
+  CHECK(CDC_Stream_Pending() == 16U);
+
+  EpComplete();
+  Service();
+  CHECK(EpLen == 16U);
+  (void)memcpy(out, EpBuf, sizeof(out));
+  for (i = 0U; i < 8U; i++)
+  {
+    CHECK(out[i] == 1000);
+  }
+  EpComplete();
+  Service();
+  CHECK(CDC_Stream_Pending() == 0U);
+}
+
+/* An urgent stream wakes a suspended host, also for data queued before
+   the suspend; a refusal holds until the host resumes the link */
+static void TestWake(CDC_StreamTypeDef *pA)
+{
+  uint8_t data[4] = {0x5AU, 0x5BU, 0x5CU, 0x5DU};
+  CDC_StreamWakeStatsTypeDef stats;
+
+  CDC_Stream_SetWake(pA, CDC_STREAM_WAKE_ANY);
+  Cdc.TxState = 1U;                    /* the host stopped reading */
+  CHECK(CDC_Stream_Write(pA, data, 4U) == 4U);
+  hUsbDeviceFS.dev_state = USBD_STATE_SUSPENDED;
+
+  WakeResult = USBD_FAIL;
+  CDC_Stream_WakeTask(NULL);
+  CDC_Stream_WakeTask(NULL);
+  CDC_Stream_GetWakeStats(&stats);
+  CHECK((WakeCalls == 1U) && (stats.Requests == 1U) && (stats.Refused == 1U));
+
+  /* Resumed by the host and suspended again, now with remote wakeup */
+  hUsbDeviceFS.dev_state = USBD_STATE_CONFIGURED;
+  CDC_Stream_WakeTask(NULL);
+  hUsbDeviceFS.dev_state = USBD_STATE_SUSPENDED;
+  WakeResult = USBD_OK;
+  CDC_Stream_WakeTask(NULL);
+  CDC_Stream_GetWakeStats(&stats);
+  CHECK((WakeCalls == 2U) && (stats.Requests == 2U) && (stats.Signals == 1U));
+
+  /* The queued bytes leave first thing after the resume, maybe wrapped */
+  hUsbDeviceFS.dev_state = USBD_STATE_CONFIGURED;
+  EpComplete();
+  Service();
+  CHECK(EpBuf[0] == data[0]);
+  while (CDC_Stream_Pending() != 0U)
+  {
+    EpComplete();
+    Service();
+  }
+  CDC_Stream_GetWakeStats(&stats);
+  CHECK(stats.Delivered == 1U);
+  CDC_Stream_SetWake(pA, CDC_STREAM_WAKE_NEVER);
+}
+
+int main(void)
+{
+  static uint8_t bufA[16];
+  static uint8_t bufB[16];
+  CDC_StreamTypeDef a;
+  CDC_StreamTypeDef b;
+
+  hUsbDeviceFS.dev_state = USBD_STATE_CONFIGURED;
+  hUsbDeviceFS.pClassData = &Cdc;
+  hUsbDeviceFS.pClassDataCmsit[0] = &Cdc;
+  CDC_Stream_SetTask(TASK_SERVICE);
+
+  CHECK(CDC_Stream_Init(&a, bufA, 12U, TASK_PRODUCER) == HAL_ERROR);
+  CHECK(CDC_Stream_Init(&a, bufA, sizeof(bufA), TASK_PRODUCER) == HAL_OK);
+  CHECK(CDC_Stream_Init(&b, bufB, sizeof(bufB), SCHED_NO_TASK) == HAL_OK);
+  CHECK(CDC_Stream_Attach(&a) == HAL_OK);
+  CHECK(CDC_Stream_Attach(&a) == HAL_OK);
+
+  TestWrap(&a);
+  TestFull(&a);
+  CHECK(CDC_Stream_Attach(&b) == HAL_OK);
+  TestAbort(&a, &b);
+  TestRoundRobin(&a, &b);
+  TestWake(&a);
+  TestWriteDecim();
+
+  if (Failures != 0U)
+  {
+    (void)printf("%lu failed\n", (unsigned long)Failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Turn a binary log capture back into text.
+
+The target sends BLOG records, see Core/Inc/blog.h, on the second CDC
+function: little-endian 32-bit words, a header word with bit 31 set, the
+argument count in bits 27:24 and the id in bits 23:0, the DWT cycle count,
+then the arguments. The id is the address of the format string in the
+.blog_fmt section of the ELF file; that section is not loaded to the
+target, so the strings are read from the ELF file here.
+
+With a single CDC function the records are read with the vendor request
+CDC_VENDOR_GET_LOG (0x06, device to host) instead; concatenate the
+replies into a capture file. Each reply is zero padded, and zero words
+are skipped here.
+
+    blog_decode.py Debug/stm32_cdc_libusb.elf capture.bin
+    cat /dev/ttyACM1 | blog_decode.py --hz 216000000 Debug/stm32_cdc_libusb.elf
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+ID_TEXT = 0xFFFFFF
+ID_DROP = 0xFFFFFE
+
+CONV = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t)?([diouxXcpsn%])")
+
+
+def load_formats(path):
+    """Map each format string address in .blog_fmt to its text."""
+    with open(path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        raise SystemExit("%s: not a little-endian 32-bit ELF file" % path)
+
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(i):
+        # name, type, flags, addr, offset, size
+        return struct.unpack_from("<IIIIII", elf, shoff + i * shentsize)
+
+    strtab = section(shstrndx)
+    for i in range(shnum):
+        name, _, _, addr, offset, size = section(i)
+        start = strtab[4] + name
+        if elf[start:elf.index(b"\0", start)] == b".blog_fmt":
+            break
+    else:
+        raise SystemExit("%s: no .blog_fmt section" % path)
+
+    formats = {}
+    data = elf[offset:offset + size]
+    pos = 0
+    while pos < len(data):
+        end = data.index(b"\0", pos)
+        formats[(addr + pos) & 0xFFFFFF] = data[pos:end].decode("utf-8", "replace")
+        # Each string is its own object, aligned by the compiler
+        pos = end + 1
+        while pos < len(data) and data[pos] == 0:
+            pos += 1
+    return formats
+
+
+def format_record(fmt, args):
+    """Apply a C format to 32-bit arguments, as far as they go."""
+    it = iter(args)
+
+    def arg():
+        return next(it, 0)
+
+    def repl(m):
+        flags, width, prec, _, conv = m.groups()
+        if conv == "%":
+            return "%"
+        if width == "*":
+            width = str(arg())
+        if prec == "*":
+            prec = str(arg())
+        spec = "%" + flags + (width or "") + ("." + prec if prec else "")
+        v = arg()
+        if conv in "di":
+            return (spec + "d") % (v - (1 << 32) if v & 0x80000000 else v)
+        if conv == "c":
+            return (spec + "c") % chr(v & 0xFF)
+        if conv in "ps":
+            # Strings stay on the target, show where they were
+            return (spec + "s") % ("0x%08x" % v)
+        if conv == "n":
+            return ""
+        return (spec + conv) % v
+
+    return CONV.sub(repl, fmt)
+
+
+def decode(stream, formats, hz, out):
+    text = b""
+    data = stream.read()
+    pos = 0
+    while pos + 8 <= len(data):
+        hdr, cycles = struct.unpack_from("<II", data, pos)
+        if not hdr & 0x80000000:
+            # Not on a record boundary: resync on the next header word
+            pos += 4
+            continue
+        n = (hdr >> 24) & 0xF
+        ident = hdr & 0xFFFFFF
+        args = struct.unpack_from("<%dI" % n, data, pos + 8) if pos + 8 + 4 * n <= len(data) else ()
+        pos += 8 + 4 * n
+        stamp = ("%12.6f " % (cycles / hz)) if hz else ("%10u " % cycles)
+
+        if ident == ID_TEXT:
+            text += b"".join(struct.pack("<I", a) for a in args).rstrip(b"\0")
+            while b"\n" in text:
+                line, text = text.split(b"\n", 1)
+                out.write(stamp + line.decode("utf-8", "replace") + "\n")
+        elif ident == ID_DROP:
+            out.write(stamp + "<%u records dropped>\n" % (args[0] if args else 0))
+        elif ident in formats:
+            out.write(stamp + format_record(formats[ident], args).rstrip("\n") + "\n")
+        else:
+            line = "<unknown id 0x%06x> %s" % (ident, " ".join("0x%08x" % a for a in args))
+            out.write(stamp + line.rstrip() + "\n")
+
+    if text:
+        out.write(text.decode("utf-8", "replace") + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("elf", help="ELF file the target runs, for the format strings")
+    parser.add_argument("capture", nargs="?", help="binary capture, standard input by default")
+    parser.add_argument("--hz", type=float, default=0.0,
+                        help="SYSCLK, to print seconds instead of DWT cycles")
+    opts = parser.parse_args()
+
+    formats = load_formats(opts.elf)
+    if opts.capture:
+        with open(opts.capture, "rb") as f:
+            decode(f, formats, opts.hz, sys.stdout)
+    else:
+        decode(sys.stdin.buffer, formats, opts.hz, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -80,6 +80,12 @@ void MX_USB_DEVICE_Init(void)
   {
     Error_Handler();
   }
+#if (USBD_CDC_FUNC_NUM > 1U)
+  if (USBD_CDC_RegisterFuncInterface(&hUsbDeviceFS, 1U, &USBD_Interface2_fops_FS) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#endif /* USBD_CDC_FUNC_NUM */
   if (USBD_Start(&hUsbDeviceFS) != USBD_OK)
   {
     Error_Handler();
@@ -22,6 +22,11 @@
 #include "usbd_cdc_if.h"
 
 /* USER CODE BEGIN INCLUDE */
+#include "usbd_cdc_stream.h"
+#include "blog.h"
+#include "memmon.h"
+#include "usbd_cdc_uart.h"
+#include "usbd_cdc_spi.h"
 
 /* USER CODE END INCLUDE */
 
@@ -62,6 +67,19 @@
   */
 
 /* USER CODE BEGIN PRIVATE_DEFINES */
+/* OUT transfers the echo task can hold at once, each free one a host credit */
+#define CDC_RX_BUF_NUM    2U
+
+/* Acquisition decimation, 16 in all: a 4th order CIC by 8, 12 bits of
+   growth, then a 16 tap low-pass FIR by 2 cutting at 0.22 of its input rate */
+#define CDC_ACQ_CIC_ORDER     4U
+#define CDC_ACQ_CIC_RATE      8U
+#define CDC_ACQ_FIR_RATE      2U
+#define CDC_ACQ_BLOCK_NUM     2U        /* capture halves waiting for the task */
+
+/* The host may pick any transfer size up to CDC_RX_XFER_MAX_SIZE, one
+   must always fit the receive buffers */
+_Static_assert(CDC_RX_XFER_MAX_SIZE <= APP_RX_DATA_SIZE, "CDC_RX_XFER_MAX_SIZE exceeds APP_RX_DATA_SIZE");
 /* USER CODE END PRIVATE_DEFINES */
 
 /**
@@ -94,6 +112,48 @@ uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
 uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
+/* Echo handed over to a scheduler task, see CDC_SetTask_FS */
+static uint32_t CdcTaskId = SCHED_NO_TASK;
+static uint32_t CdcEchoDone;
+/* UserRxBufferFS split into CdcRxBufNum buffers, filled in turn by the OUT
+   endpoint and echoed in turn by the task */
+static uint32_t CdcRxBufNum = 1U;
+static uint32_t CdcRxBufSize = APP_RX_DATA_SIZE;
+static uint8_t *CdcRxBuf[CDC_RX_BUF_NUM];
+static uint32_t CdcRxLen[CDC_RX_BUF_NUM];
+static __IO uint32_t CdcRxIn;      /* transfers received, CDC_Receive_FS only */
+static __IO uint32_t CdcRxOut;     /* transfers echoed, CDC_Task_FS only */
+static __IO uint8_t CdcRxWait;     /* all buffers full, the endpoint is not armed */
+/* The echo task's stream to the USB service task, stored in UserTxBufferFS */
+static CDC_StreamTypeDef CdcEchoStream;
+/* Acquisition decimated into its own stream, see CDC_SetAcqTask_FS */
+static const int16_t CdcAcqFirCoeffs[CDC_ACQ_FIR_TAPS] =
+{
+  -90, 82, 427, -58, -1742, -995, 5569, 13190, 13190, 5569, -995, -1742, -58, 427, 82, -90
+};
+static const DECIM_InitTypeDef CdcAcqDecimInit =
+{
+  CDC_ACQ_CIC_ORDER, CDC_ACQ_CIC_RATE, CDC_ACQ_FIR_RATE, CDC_ACQ_FIR_TAPS,
+  CdcAcqFirCoeffs, NULL
+};
+static uint32_t CdcAcqTaskId = SCHED_NO_TASK;
+static DECIM_InstanceTypeDef CdcAcqDecim;
+static int16_t CdcAcqFirState[2U * CDC_ACQ_FIR_TAPS];
+static int16_t CdcAcqStreamBuf[CDC_ACQ_STREAM_SIZE / sizeof(int16_t)];
+static CDC_StreamTypeDef CdcAcqStream;
+static const int16_t *CdcAcqBlock[CDC_ACQ_BLOCK_NUM];
+static uint32_t CdcAcqBlockLen[CDC_ACQ_BLOCK_NUM];
+static __IO uint32_t CdcAcqIn;     /* blocks captured, CDC_AcqBlock_FS only */
+static __IO uint32_t CdcAcqOut;    /* blocks decimated, CDC_AcqTask_FS only */
+#if (USBD_CDC_FUNC_NUM > 1U)
+/** Received data of the second function */
+uint8_t UserRx2BufferFS[APP_RX_DATA_SIZE];
+/* The binary log owns the IN endpoint of the second function, see CDC_SetLogTask_FS */
+static uint32_t CdcLogTaskId = SCHED_NO_TASK;
+static uint32_t CdcLogBuf[(CDC_DATA_FS_MAX_PACKET_SIZE * 2U) / 4U];
+static uint32_t CdcLogLen;
+static __IO uint8_t CdcLogBusy;
+#endif /* USBD_CDC_FUNC_NUM */
 
 /* USER CODE END PRIVATE_VARIABLES */
 
@@ -128,6 +188,14 @@ static int8_t CDC_Receive_FS(uint8_t* pbuf, uint32_t *Len);
 static int8_t CDC_TransmitCplt_FS(uint8_t *pbuf, uint32_t *Len, uint8_t epnum);
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
+#if (USBD_CDC_FUNC_NUM > 1U)
+static int8_t CDC_Init2_FS(void);
+static int8_t CDC_DeInit2_FS(void);
+static int8_t CDC_Control2_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length);
+static int8_t CDC_Receive2_FS(uint8_t* pbuf, uint32_t *Len);
+static int8_t CDC_TransmitCplt2_FS(uint8_t *pbuf, uint32_t *Len, uint8_t epnum);
+#endif /* USBD_CDC_FUNC_NUM */
+static void CDC_RxArm(uint32_t Slot);
 
 /* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
 
@@ -154,7 +222,37 @@ static int8_t CDC_Init_FS(void)
   /* USER CODE BEGIN 3 */
   /* Set Application Buffers */
   USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
+  /* A bridge brings its own buffers and grants their credits */
+  if (CDC_Spi_IsBridged() != 0U)
+  {
+    CDC_Spi_Start();
+    return (USBD_OK);
+  }
+  if (CDC_Uart_IsBridged(0U) != 0U)
+  {
+    CDC_Uart_Start(0U);
+    return (USBD_OK);
+  }
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+  /* An echo pending from before a reset is stale */
+  CdcRxIn = 0U;
+  CdcRxOut = 0U;
+  CdcRxWait = 0U;
+  CdcEchoDone = 0U;
+  CdcRxBufNum = 1U;
+  if (CdcTaskId != SCHED_NO_TASK)
+  {
+    CDC_Stream_Reset();
+    /* Receive into the next buffer while the task echoes one, if the
+       transfer size of this configuration leaves room for it */
+    if ((USBD_CDC_GetParams()->RxXferSize * CDC_RX_BUF_NUM) <= APP_RX_DATA_SIZE)
+    {
+      CdcRxBufNum = CDC_RX_BUF_NUM;
+    }
+  }
+  CdcRxBufSize = APP_RX_DATA_SIZE / CdcRxBufNum;
+  /* The class arms the first buffer on return, all of them are free */
+  (void)USBD_CDC_GrantCredit(&hUsbDeviceFS, CdcRxBufNum);
   return (USBD_OK);
   /* USER CODE END 3 */
 }
@@ -180,6 +278,8 @@ static int8_t CDC_DeInit_FS(void)
 static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 {
   /* USER CODE BEGIN 5 */
+  int8_t ret = USBD_OK;
+
   switch(cmd)
   {
     case CDC_SEND_ENCAPSULATED_COMMAND:
@@ -220,26 +320,39 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
   /* 6      | bDataBits  |   1   | Number Data bits (5, 6, 7, 8 or 16).          */
   /*******************************************************************************/
     case CDC_SET_LINE_CODING:
-
-    break;
-
     case CDC_GET_LINE_CODING:
-
+    case CDC_SEND_BREAK:
+      (void)CDC_Uart_Control(0U, cmd, pbuf, length);
     break;
 
     case CDC_SET_CONTROL_LINE_STATE:
 
     break;
 
-    case CDC_SEND_BREAK:
+    case CDC_CTRL_GET_MEMORY:
+      (void)MEMMON_GetReport(pbuf, length);
+    break;
 
+    /* The only way out for the log when no second function drains it.
+       Records are taken when the request is answered: a data stage the
+       host abandons loses them without a drop record */
+    case CDC_CTRL_GET_LOG:
+#if (USBD_CDC_FUNC_NUM > 1U)
+      if (CdcLogTaskId != SCHED_NO_TASK)
+      {
+        /* BLOG_Read has a single reader, CDC_LogTask_FS */
+        ret = USBD_FAIL;
+        break;
+      }
+#endif /* USBD_CDC_FUNC_NUM */
+      (void)BLOG_Read(pbuf, length);
     break;
 
   default:
     break;
   }
 
-  return (USBD_OK);
+  return (ret);
   /* USER CODE END 5 */
 }
 
@@ -261,10 +374,49 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 6 */
+  if (CDC_Spi_IsBridged() != 0U)
+  {
+    CDC_Spi_Receive(Buf, *Len);
+    return (USBD_OK);
+  }
+
+  if (CDC_Uart_IsBridged(0U) != 0U)
+  {
+    CDC_Uart_Receive(0U, Buf, *Len);
+    return (USBD_OK);
+  }
+
+  if (CdcTaskId != SCHED_NO_TASK)
+  {
+    uint32_t in = CdcRxIn;
+
+    CdcRxBuf[in % CdcRxBufNum] = Buf;
+    CdcRxLen[in % CdcRxBufNum] = *Len;
+    CdcRxIn = in + 1U;
+    /* Go on into the next buffer while this one is echoed. With all of them
+       full the host is out of credits and leaves the endpoint alone until
+       CDC_Task_FS frees one and arms it */
+    if ((CdcRxIn - CdcRxOut) < CdcRxBufNum)
+    {
+      CDC_RxArm(CdcRxIn % CdcRxBufNum);
+    }
+    else
+    {
+      CdcRxWait = 1U;
+    }
+    SCHED_Signal(CdcTaskId);
+    return (USBD_OK);
+  }
+
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
   USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+  (void)USBD_CDC_GrantCredit(&hUsbDeviceFS, 1U);
 
-  CDC_Transmit_FS(Buf, *Len);
+  /* The acquisition stream owns the IN endpoint, nothing is echoed */
+  if (CdcAcqTaskId == SCHED_NO_TASK)
+  {
+    CDC_Transmit_FS(Buf, *Len);
+  }
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -286,6 +438,7 @@ uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
   /* USER CODE BEGIN 7 */
   USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
   if (hcdc->TxState != 0){
+    USBD_CDC_CountTxBusy();
     return USBD_BUSY;
   }
   USBD_CDC_SetTxBuffer(&hUsbDeviceFS, Buf, Len);
@@ -312,13 +465,449 @@ static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
   /* USER CODE BEGIN 13 */
   UNUSED(Buf);
   UNUSED(Len);
-  UNUSED(epnum);
+  if (CDC_Spi_IsBridged() != 0U)
+  {
+    if ((epnum & CDC_TX_ABORTED) != 0U)
+    {
+      CDC_Spi_TxAbort();
+    }
+    else
+    {
+      CDC_Spi_TxCplt();
+    }
+  }
+  else if (CDC_Uart_IsBridged(0U) != 0U)
+  {
+    if ((epnum & CDC_TX_ABORTED) != 0U)
+    {
+      CDC_Uart_TxAbort(0U);
+    }
+    else
+    {
+      CDC_Uart_TxCplt(0U);
+    }
+  }
+  else if (CdcTaskId != SCHED_NO_TASK)
+  {
+    /* The IN endpoint belongs to the stream service task */
+    if ((epnum & CDC_TX_ABORTED) != 0U)
+    {
+      CDC_Stream_TxAbort();
+    }
+    else
+    {
+      CDC_Stream_TxCplt();
+    }
+  }
   /* USER CODE END 13 */
   return result;
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/**
+  * @brief  CDC_TransmitSeg_FS
+  *         Send a header/payload/trailer style chain of buffers without
+  *         copying them into UserTxBufferFS first.
+  * @param  pSeg: Segment list, must stay valid until CDC_TransmitCplt_FS
+  * @param  SegNum: Number of segments
+  * @retval USBD_OK if all operations are OK else USBD_FAIL or USBD_BUSY
+  */
+uint8_t CDC_TransmitSeg_FS(const USBD_SegTypeDef *pSeg, uint32_t SegNum)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+  if (hcdc->TxState != 0){
+    USBD_CDC_CountTxBusy();
+    return USBD_BUSY;
+  }
+  return USBD_CDC_TransmitSeg(&hUsbDeviceFS, pSeg, SegNum);
+}
+
+
+/**
+  * @brief  CDC_SetRxSplit_FS
+  *         Receive the next OUT transfers as a fixed-size header plus a payload
+  *         written in place into the caller's buffer. CDC_Receive_FS is then
+  *         called with the payload only; pass pHdr = NULL to switch back.
+  * @param  pHdr: Header buffer
+  * @param  HdrLen: Header length in bytes
+  * @param  pPayload: Payload buffer
+  * @param  PayloadLen: Payload buffer size in bytes
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+uint8_t CDC_SetRxSplit_FS(uint8_t *pHdr, uint32_t HdrLen, uint8_t *pPayload, uint32_t PayloadLen)
+{
+  return USBD_CDC_SetRxSplitBuffer(&hUsbDeviceFS, pHdr, HdrLen, pPayload, PayloadLen);
+}
+
+/**
+  * @brief  CDC_SetTask_FS
+  *         Move the echo of received data out of the USB interrupt into the
+  *         scheduler task TaskId, which must run CDC_Task_FS. The echo then
+  *         goes through a stream, so the task running CDC_Stream_Task must be
+  *         set up too; other producers attach streams of their own.
+  *         Replies are urgent: one still queued when the host suspends the
+  *         link wakes it, if the host allowed remote wakeup.
+  * @param  TaskId: Task id from SCHED_AddTask, SCHED_NO_TASK to echo in place
+  * @retval None
+  */
+void CDC_SetTask_FS(uint32_t TaskId)
+{
+  if (TaskId != SCHED_NO_TASK)
+  {
+    (void)CDC_Stream_Init(&CdcEchoStream, UserTxBufferFS, APP_TX_DATA_SIZE, TaskId);
+#if (USBD_REMOTE_WAKEUP_ENABLED == 1U)
+    CDC_Stream_SetWake(&CdcEchoStream, CDC_STREAM_WAKE_ANY);
+#endif /* USBD_REMOTE_WAKEUP_ENABLED */
+    (void)CDC_Stream_Attach(&CdcEchoStream);
+  }
+  CdcTaskId = TaskId;
+}
+
+/**
+  * @brief  CDC_Task_FS
+  *         Scheduler task copying the received OUT transfers into the echo
+  *         stream, oldest first. Each buffer fully copied goes back to the
+  *         host as a credit; it is signalled again by the service task
+  *         whenever stream space is freed.
+  * @param  pArg: Unused
+  * @retval None
+  */
+void CDC_Task_FS(void *pArg)
+{
+  uint32_t pending;
+
+  UNUSED(pArg);
+
+  /* Out of range only if a reset raced the last echo, drop it then */
+  pending = CdcRxIn - CdcRxOut;
+  while ((pending != 0U) && (pending <= CdcRxBufNum))
+  {
+    uint32_t slot = CdcRxOut % CdcRxBufNum;
+
+    while (CdcEchoDone < CdcRxLen[slot])
+    {
+      uint32_t space;
+      uint8_t *dst = CDC_Stream_Reserve(&CdcEchoStream, &space);
+
+      if (space == 0U)
+      {
+        /* Stream full, the host is not reading: hold the buffer and its credit */
+        return;
+      }
+      if (space > (CdcRxLen[slot] - CdcEchoDone))
+      {
+        space = CdcRxLen[slot] - CdcEchoDone;
+      }
+      memcpy(dst, &CdcRxBuf[slot][CdcEchoDone], space);
+      CDC_Stream_Commit(&CdcEchoStream, space);
+      CdcEchoDone += space;
+    }
+
+    CdcEchoDone = 0U;
+    CdcRxOut++;
+    if (hUsbDeviceFS.pClassData != NULL)
+    {
+      /* CDC_Receive_FS found no free buffer: this one is next */
+      if (CdcRxWait != 0U)
+      {
+        CdcRxWait = 0U;
+        CDC_RxArm(CdcRxIn % CdcRxBufNum);
+      }
+      (void)USBD_CDC_GrantCredit(&hUsbDeviceFS, 1U);
+    }
+    pending = CdcRxIn - CdcRxOut;
+  }
+}
+
+/**
+  * @brief  CDC_RxArm
+  *         Arm the OUT endpoint on one of the receive buffers
+  * @param  Slot: Buffer index, below CdcRxBufNum
+  * @retval None
+  */
+static void CDC_RxArm(uint32_t Slot)
+{
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &UserRxBufferFS[Slot * CdcRxBufSize]);
+  USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+}
+
+/**
+  * @brief  CDC_SetAcqTask_FS
+  *         Send acquisition data to the host decimated, instead of echoing:
+  *         capture blocks given to CDC_AcqBlock_FS are filtered and brought
+  *         down 16 times by the scheduler task TaskId running
+  *         CDC_AcqTask_FS, into a stream of their own. Once the stream is
+  *         half full while the host has suspended the link, the host is
+  *         woken. Call from thread context, before the capture starts.
+  * @param  TaskId: Task id from SCHED_AddTask
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CDC_SetAcqTask_FS(uint32_t TaskId)
+{
+  DECIM_InitTypeDef init = CdcAcqDecimInit;
+
+  init.pFirState = CdcAcqFirState;
+  if ((TaskId == SCHED_NO_TASK) || (DECIM_Init(&CdcAcqDecim, &init) != HAL_OK) ||
+      (CDC_Stream_Init(&CdcAcqStream, (uint8_t *)CdcAcqStreamBuf, sizeof(CdcAcqStreamBuf),
+                       SCHED_NO_TASK) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+#if (USBD_REMOTE_WAKEUP_ENABLED == 1U)
+  CDC_Stream_SetWake(&CdcAcqStream, sizeof(CdcAcqStreamBuf) / 2U);
+#endif /* USBD_REMOTE_WAKEUP_ENABLED */
+  CdcAcqIn = 0U;
+  CdcAcqOut = 0U;
+  CdcAcqTaskId = TaskId;
+
+  return CDC_Stream_Attach(&CdcAcqStream);
+}
+
+/**
+  * @brief  CDC_AcqBlock_FS
+  *         Hand a block of q15 samples over for decimation, from the half
+  *         and full transfer callbacks of the acquisition DMA. The block
+  *         must stay untouched until the other half has been captured.
+  * @param  pSamples: Captured samples
+  * @param  Len: Number of samples
+  * @retval None
+  */
+void CDC_AcqBlock_FS(const int16_t *pSamples, uint32_t Len)
+{
+  uint32_t in = CdcAcqIn;
+
+  if (CdcAcqTaskId == SCHED_NO_TASK)
+  {
+    return;
+  }
+  if ((in - CdcAcqOut) >= CDC_ACQ_BLOCK_NUM)
+  {
+    /* The task is a whole block behind: the capture already overwrote it */
+    BLOG("acq: %u samples lost, decimation behind the capture", Len);
+    return;
+  }
+
+  CdcAcqBlock[in % CDC_ACQ_BLOCK_NUM] = pSamples;
+  CdcAcqBlockLen[in % CDC_ACQ_BLOCK_NUM] = Len;
+  CdcAcqIn = in + 1U;
+  SCHED_Signal(CdcAcqTaskId);
+}
+
+/**
+  * @brief  CDC_AcqTask_FS
+  *         Scheduler task decimating the captured blocks into the
+  *         acquisition stream, oldest first. Output the stream cannot take
+  *         still runs through the filters, so the state stays continuous,
+  *         and is counted in its Dropped bytes.
+  * @param  pArg: Unused
+  * @retval None
+  */
+void CDC_AcqTask_FS(void *pArg)
+{
+  uint32_t slot;
 
+  UNUSED(pArg);
+
+  while (CdcAcqOut != CdcAcqIn)
+  {
+    slot = CdcAcqOut % CDC_ACQ_BLOCK_NUM;
+    (void)CDC_Stream_WriteDecim(&CdcAcqStream, &CdcAcqDecim, CdcAcqBlock[slot], CdcAcqBlockLen[slot]);
+    CdcAcqOut++;
+  }
+}
+
+#if (USBD_CDC_FUNC_NUM > 1U)
+/*
+ * Second bulk function. Its callbacks run from the USB interrupt with
+ * pdev->classId selecting it, so the classic SetRxBuffer/ReceivePacket calls
+ * apply to it there; from thread context use CDC_Transmit2_FS.
+ */
+
+/**
+  * @brief  Initializes the second function
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_Init2_FS(void)
+{
+  if (CDC_Uart_IsBridged(1U) != 0U)
+  {
+    CDC_Uart_Start(1U);
+    return (USBD_OK);
+  }
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRx2BufferFS);
+  /* A chunk in flight before a reset is lost and counted, one still
+     waiting for the endpoint goes out first */
+  if (CdcLogBusy != 0U)
+  {
+    BLOG_Discard((uint8_t *)CdcLogBuf, CdcLogLen);
+    CdcLogLen = 0U;
+  }
+  CdcLogBusy = 0U;
+  return (USBD_OK);
+}
+
+/**
+  * @brief  DeInitializes the second function
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_DeInit2_FS(void)
+{
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Class requests of the second function, answered only when it is
+  *         bridged; the memory report always
+  * @param  cmd: Command code
+  * @param  pbuf: Buffer containing command data (request parameters)
+  * @param  length: Number of data to be sent (in bytes)
+  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_Control2_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
+{
+  if (cmd == CDC_CTRL_GET_MEMORY)
+  {
+    (void)MEMMON_GetReport(pbuf, length);
+  }
+  else if ((cmd == CDC_SET_LINE_CODING) || (cmd == CDC_GET_LINE_CODING) || (cmd == CDC_SEND_BREAK))
+  {
+    (void)CDC_Uart_Control(1U, cmd, pbuf, length);
+  }
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Data received on the second function, echoed back. The echo is
+  *         sent from the receive buffer, so the OUT endpoint is re-armed
+  *         only once it is out, from CDC_TransmitCplt2_FS
+  * @param  Buf: Buffer of data to be received
+  * @param  Len: Number of data received (in bytes)
+  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_Receive2_FS(uint8_t* Buf, uint32_t *Len)
+{
+  if (CDC_Uart_IsBridged(1U) != 0U)
+  {
+    CDC_Uart_Receive(1U, Buf, *Len);
+    return (USBD_OK);
+  }
+
+  /* Dropped while the log owns the IN endpoint, or when it is busy */
+  if ((CdcLogTaskId != SCHED_NO_TASK) || (CDC_Transmit2_FS(Buf, (uint16_t)*Len) != USBD_OK))
+  {
+    (void)USBD_CDC_ReceiveFunc(&hUsbDeviceFS, 1U, UserRx2BufferFS);
+  }
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Data transmitted on the second function
+  * @param  Buf: Buffer of data sent
+  * @param  Len: Number of data sent (in bytes)
+  * @param  epnum: endpoint number
+  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_TransmitCplt2_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
+{
+  UNUSED(Buf);
+  UNUSED(Len);
+  if (CDC_Uart_IsBridged(1U) != 0U)
+  {
+    if ((epnum & CDC_TX_ABORTED) != 0U)
+    {
+      CDC_Uart_TxAbort(1U);
+    }
+    else
+    {
+      CDC_Uart_TxCplt(1U);
+    }
+  }
+  else if (CdcLogTaskId != SCHED_NO_TASK)
+  {
+    /* Drain the next chunk back to back while the log has some; a
+       chunk the class dropped goes out again */
+    if ((epnum & CDC_TX_ABORTED) == 0U)
+    {
+      CdcLogLen = 0U;
+    }
+    CdcLogBusy = 0U;
+    SCHED_Signal(CdcLogTaskId);
+  }
+  else
+  {
+    /* The echo has left the receive buffer, sent or dropped */
+    (void)USBD_CDC_ReceiveFunc(&hUsbDeviceFS, 1U, UserRx2BufferFS);
+  }
+  return (USBD_OK);
+}
+
+USBD_CDC_ItfTypeDef USBD_Interface2_fops_FS =
+{
+  CDC_Init2_FS,
+  CDC_DeInit2_FS,
+  CDC_Control2_FS,
+  CDC_Receive2_FS,
+  CDC_TransmitCplt2_FS
+};
+
+/**
+  * @brief  CDC_Transmit2_FS
+  *         Send data on the IN endpoint of the second function
+  * @param  Buf: Buffer of data to be sent
+  * @param  Len: Number of data to be sent (in bytes)
+  * @retval USBD_OK if all operations are OK else USBD_FAIL or USBD_BUSY
+  */
+uint8_t CDC_Transmit2_FS(uint8_t* Buf, uint16_t Len)
+{
+  return USBD_CDC_TransmitFunc(&hUsbDeviceFS, 1U, Buf, Len);
+}
+
+/**
+  * @brief  CDC_SetLogTask_FS
+  *         Give the IN endpoint of the second function to the binary log,
+  *         drained by the scheduler task TaskId running CDC_LogTask_FS;
+  *         data received on the second function is then no longer echoed.
+  * @param  TaskId: Task id from SCHED_AddTask
+  * @retval None
+  */
+void CDC_SetLogTask_FS(uint32_t TaskId)
+{
+  CdcLogTaskId = TaskId;
+}
+
+/**
+  * @brief  CDC_LogTask_FS
+  *         Low priority task sending the binary log in chunks of whole
+  *         records; a chunk the host could not take yet is kept and retried.
+  * @param  pArg: Unused
+  * @retval None
+  */
+void CDC_LogTask_FS(void *pArg)
+{
+  UNUSED(pArg);
+
+  if (CdcLogBusy != 0U)
+  {
+    return;
+  }
+
+  if (CdcLogLen == 0U)
+  {
+    CdcLogLen = BLOG_Read((uint8_t *)CdcLogBuf, sizeof(CdcLogBuf));
+    if (CdcLogLen == 0U)
+    {
+      return;
+    }
+  }
+
+  CdcLogBusy = 1U;
+  if (CDC_Transmit2_FS((uint8_t *)CdcLogBuf, (uint16_t)CdcLogLen) != USBD_OK)
+  {
+    /* Not configured or endpoint busy: the next period tries again */
+    CdcLogBusy = 0U;
+  }
+}
+#endif /* USBD_CDC_FUNC_NUM */
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
@@ -51,6 +51,9 @@
 #define APP_RX_DATA_SIZE  2048
 #define APP_TX_DATA_SIZE  2048
 /* USER CODE BEGIN EXPORTED_DEFINES */
+/* Decimated acquisition stream and FIR length, see CDC_SetAcqTask_FS */
+#define CDC_ACQ_STREAM_SIZE   4096U
+#define CDC_ACQ_FIR_TAPS      16U
 
 /* USER CODE END EXPORTED_DEFINES */
 
@@ -93,6 +96,10 @@
 extern USBD_CDC_ItfTypeDef USBD_Interface_fops_FS;
 
 /* USER CODE BEGIN EXPORTED_VARIABLES */
+#if (USBD_CDC_FUNC_NUM > 1U)
+/** Callbacks of the second bulk function. */
+extern USBD_CDC_ItfTypeDef USBD_Interface2_fops_FS;
+#endif /* USBD_CDC_FUNC_NUM */
 
 /* USER CODE END EXPORTED_VARIABLES */
 
@@ -108,6 +115,18 @@ extern USBD_CDC_ItfTypeDef USBD_Interface_fops_FS;
 uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+uint8_t CDC_TransmitSeg_FS(const USBD_SegTypeDef *pSeg, uint32_t SegNum);
+uint8_t CDC_SetRxSplit_FS(uint8_t *pHdr, uint32_t HdrLen, uint8_t *pPayload, uint32_t PayloadLen);
+void CDC_SetTask_FS(uint32_t TaskId);
+void CDC_Task_FS(void *pArg);
+HAL_StatusTypeDef CDC_SetAcqTask_FS(uint32_t TaskId);
+void CDC_AcqBlock_FS(const int16_t *pSamples, uint32_t Len);
+void CDC_AcqTask_FS(void *pArg);
+#if (USBD_CDC_FUNC_NUM > 1U)
+uint8_t CDC_Transmit2_FS(uint8_t* Buf, uint16_t Len);
+void CDC_SetLogTask_FS(uint32_t TaskId);
+void CDC_LogTask_FS(void *pArg);
+#endif /* USBD_CDC_FUNC_NUM */
 
 /* USER CODE END EXPORTED_FUNCTIONS */
 
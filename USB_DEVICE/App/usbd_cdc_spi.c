@@ -0,0 +1,679 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_spi.c
+  * @brief          : SPI master bridge running transaction lists by DMA.
+  *
+  *                   The first CDC function carries transaction lists, see
+  *                   usbd_cdc_spi.h. CDC_Spi_Task checks a list whole and
+  *                   starts it; from then on the list runs from the receive
+  *                   DMA interrupt, which toggles chip select and starts the
+  *                   next transfer as soon as one ends, so the operations go
+  *                   out back to back with no scheduler or host round trip
+  *                   in between. Only delays go back to the task. Bytes
+  *                   clocked in are gathered behind the result header and
+  *                   go to the host in one IN transfer.
+  *
+  *                   SPI1 on PA5/PA6/PA7 with chip select on PD14, D13 to
+  *                   D10 of the Arduino connector. The SPI HAL module is not
+  *                   part of this tree: SPI1 is driven through its
+  *                   registers, its two DMA streams through the HAL DMA
+  *                   driver. SPI1 is clocked from PCLK2, which follows the
+  *                   clock governor, so the prescaler is worked out again at
+  *                   the start of every list.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_spi.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CDC_SPI_INSTANCE          SPI1
+#define CDC_SPI_GPIO_PORT         GPIOA
+#define CDC_SPI_GPIO_PINS         (GPIO_PIN_5 | GPIO_PIN_6 | GPIO_PIN_7)
+#define CDC_SPI_CS_PORT           GPIOD
+#define CDC_SPI_CS_PIN            GPIO_PIN_14
+
+/* Private types -------------------------------------------------------------*/
+typedef enum
+{
+  CDC_SPI_IDLE = 0U,
+  CDC_SPI_BUSY,            /* transfer on the DMA */
+  CDC_SPI_DELAY,           /* waiting in CDC_Spi_Task */
+  CDC_SPI_DONE,            /* result ready */
+  CDC_SPI_SENDING          /* result on the IN endpoint */
+} CDC_Spi_StateTypeDef;
+
+typedef struct
+{
+  CDC_Spi_ResultTypeDef Hdr;
+  uint8_t               Data[CDC_SPI_RESULT_SIZE];
+} CDC_Spi_ResultBufTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static DMA_HandleTypeDef CDC_SpiDmaRx;
+static DMA_HandleTypeDef CDC_SpiDmaTx;
+
+/* Lists as received, the endpoint fills one while the other runs */
+static uint8_t CDC_SpiList[CDC_SPI_LIST_BUF_NUM][CDC_SPI_LIST_SIZE];
+static uint32_t CDC_SpiListLen[CDC_SPI_LIST_BUF_NUM];
+static __IO uint32_t CDC_SpiIn;      /* lists received, CDC_Spi_Receive only */
+static __IO uint32_t CDC_SpiOut;     /* lists run, CDC_Spi_Task only */
+static __IO uint8_t CDC_SpiWait;     /* all buffers full, the endpoint is not armed */
+static uint8_t CDC_SpiListOpen;      /* the list at CDC_SpiOut is not retired yet */
+
+static CDC_Spi_ResultBufTypeDef CDC_SpiResult;
+
+/* Running list, owned by whoever holds CDC_SpiState */
+static __IO CDC_Spi_StateTypeDef CDC_SpiState;
+static uint8_t *CDC_SpiPList;
+static uint32_t CDC_SpiListEnd;
+static uint32_t CDC_SpiPos;
+static uint32_t CDC_SpiXferLen;
+static uint32_t CDC_SpiXferIn;       /* bytes of the transfer kept for the host */
+static uint32_t CDC_SpiDelayStart;
+static uint32_t CDC_SpiDelayCycles;
+static __IO uint8_t CDC_SpiInDone;
+static __IO uint8_t CDC_SpiInAborted;  /* with InDone: dropped by the class, not sent */
+static __IO uint8_t CDC_SpiResetReq;   /* set by CDC_Spi_Start, CDC_Spi_Task only clears it */
+
+static uint32_t CDC_SpiHz = CDC_SPI_DEFAULT_HZ;
+static uint8_t CDC_SpiMode = CDC_SPI_DEFAULT_MODE;
+
+static CDC_Spi_StatsTypeDef CDC_SpiStats;
+
+static uint32_t CDC_SpiTaskId = SCHED_NO_TASK;
+
+/* Private function prototypes -----------------------------------------------*/
+static void CDC_Spi_Apply(void);
+static void CDC_Spi_Reset(void);
+static uint8_t CDC_Spi_Check(const uint8_t *pList, uint32_t Len);
+static void CDC_Spi_Run(void);
+static void CDC_Spi_Retire(void);
+static void CDC_Spi_DmaRxCplt(DMA_HandleTypeDef *hdma);
+static void CDC_Spi_DmaRxError(DMA_HandleTypeDef *hdma);
+
+/**
+  * @brief  Bring up SPI1, its DMA streams and chip select, and give the first
+  *         CDC function to the bridge. Call from thread context, before the
+  *         host configures the device.
+  * @param  TaskId task running CDC_Spi_Task
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CDC_Spi_Init(uint32_t TaskId)
+{
+  GPIO_InitTypeDef gpio = {0};
+
+  if (TaskId == SCHED_NO_TASK)
+  {
+    return HAL_ERROR;
+  }
+
+  __HAL_RCC_SPI1_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  /* Deselected before the pin drives */
+  HAL_GPIO_WritePin(CDC_SPI_CS_PORT, CDC_SPI_CS_PIN, GPIO_PIN_SET);
+  gpio.Pin = CDC_SPI_CS_PIN;
+  gpio.Mode = GPIO_MODE_OUTPUT_PP;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_Init(CDC_SPI_CS_PORT, &gpio);
+
+  gpio.Pin = CDC_SPI_GPIO_PINS;
+  gpio.Mode = GPIO_MODE_AF_PP;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.Alternate = GPIO_AF5_SPI1;
+  HAL_GPIO_Init(CDC_SPI_GPIO_PORT, &gpio);
+
+  /* Receive ends each transfer, so only its stream interrupts */
+  CDC_SpiDmaRx.Instance = DMA2_Stream0;
+  CDC_SpiDmaRx.Init.Channel = DMA_CHANNEL_3;
+  CDC_SpiDmaRx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  CDC_SpiDmaRx.Init.PeriphInc = DMA_PINC_DISABLE;
+  CDC_SpiDmaRx.Init.MemInc = DMA_MINC_ENABLE;
+  CDC_SpiDmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  CDC_SpiDmaRx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  CDC_SpiDmaRx.Init.Mode = DMA_NORMAL;
+  CDC_SpiDmaRx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+  CDC_SpiDmaRx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+  CDC_SpiDmaTx.Instance = DMA2_Stream3;
+  CDC_SpiDmaTx.Init.Channel = DMA_CHANNEL_3;
+  CDC_SpiDmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  CDC_SpiDmaTx.Init.PeriphInc = DMA_PINC_DISABLE;
+  CDC_SpiDmaTx.Init.MemInc = DMA_MINC_ENABLE;
+  CDC_SpiDmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  CDC_SpiDmaTx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  CDC_SpiDmaTx.Init.Mode = DMA_NORMAL;
+  CDC_SpiDmaTx.Init.Priority = DMA_PRIORITY_HIGH;
+  CDC_SpiDmaTx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+  if ((HAL_DMA_Init(&CDC_SpiDmaRx) != HAL_OK) || (HAL_DMA_Init(&CDC_SpiDmaTx) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  CDC_SpiDmaRx.XferCpltCallback = CDC_Spi_DmaRxCplt;
+  CDC_SpiDmaRx.XferErrorCallback = CDC_Spi_DmaRxError;
+
+  CDC_Spi_Apply();
+
+  /* Priority comes from IRQPRIO_TABLE */
+  HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+  CDC_SpiTaskId = TaskId;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Whether the first CDC function carries the SPI bridge
+  * @retval 1 if bridged
+  */
+uint8_t CDC_Spi_IsBridged(void)
+{
+  return (CDC_SpiTaskId != SCHED_NO_TASK) ? 1U : 0U;
+}
+
+/**
+  * @brief  The function was (re)configured. Called from its interface Init
+  *         callback, in the USB interrupt, which may have cut into a list
+  *         running from the task or the DMA interrupt: the list is left to
+  *         CDC_Spi_Task to stop. The class arms the first buffer on return,
+  *         the host sends nothing into it before the task grants credits.
+  * @retval None
+  */
+void CDC_Spi_Start(void)
+{
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, CDC_SpiList[0]);
+  CDC_SpiResetReq = 1U;
+  SCHED_Signal(CDC_SpiTaskId);
+}
+
+/**
+  * @brief  A list landed in the buffer the endpoint was armed on. Called
+  *         from the interface Receive callback: the endpoint goes on into
+  *         the next buffer at once.
+  * @param  pBuf received list
+  * @param  Len received length
+  * @retval None
+  */
+void CDC_Spi_Receive(uint8_t *pBuf, uint32_t Len)
+{
+  uint32_t in = CDC_SpiIn;
+
+  UNUSED(pBuf);
+
+  CDC_SpiListLen[in % CDC_SPI_LIST_BUF_NUM] = Len;
+  CDC_SpiIn = in + 1U;
+
+  /* With all buffers full the host is out of credits and leaves the
+     endpoint alone until the task retires a list and arms it */
+  if ((CDC_SpiIn - CDC_SpiOut) < CDC_SPI_LIST_BUF_NUM)
+  {
+    USBD_CDC_SetRxBuffer(&hUsbDeviceFS, CDC_SpiList[CDC_SpiIn % CDC_SPI_LIST_BUF_NUM]);
+    USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+  }
+  else
+  {
+    CDC_SpiWait = 1U;
+  }
+
+  SCHED_Signal(CDC_SpiTaskId);
+}
+
+/**
+  * @brief  The result went out. Called from the interface TransmitCplt
+  *         callback.
+  * @retval None
+  */
+void CDC_Spi_TxCplt(void)
+{
+  CDC_SpiInDone = 1U;
+  SCHED_Signal(CDC_SpiTaskId);
+}
+
+/**
+  * @brief  The class dropped the result, CDC_TX_ABORTED in the interface
+  *         TransmitCplt callback: it is sent again.
+  * @retval None
+  */
+void CDC_Spi_TxAbort(void)
+{
+  CDC_SpiInAborted = 1U;
+  CDC_Spi_TxCplt();
+}
+
+/**
+  * @brief  Bridge task: sends results, ends delays and starts the next list.
+  *         Signalled by the USB and DMA interrupts; a short period retries
+  *         a result the endpoint was not ready for.
+  * @param  pArg unused
+  * @retval None
+  */
+void CDC_Spi_Task(void *pArg)
+{
+  uint32_t pending;
+  uint32_t slot;
+  uint8_t status;
+
+  UNUSED(pArg);
+
+  if (CDC_SpiResetReq != 0U)
+  {
+    CDC_Spi_Reset();
+  }
+
+  if (CDC_SpiInDone != 0U)
+  {
+    CDC_SpiInDone = 0U;
+    if (CDC_SpiState == CDC_SPI_SENDING)
+    {
+      if (CDC_SpiInAborted != 0U)
+      {
+        CDC_SpiState = CDC_SPI_DONE;
+      }
+      else
+      {
+        CDC_SpiStats.RxBytes += CDC_SpiResult.Hdr.RxLen;
+        CDC_SpiState = CDC_SPI_IDLE;
+      }
+    }
+    CDC_SpiInAborted = 0U;
+  }
+
+  if (CDC_SpiState == CDC_SPI_DELAY)
+  {
+    /* Yield to the other tasks until it is over */
+    if ((DWT->CYCCNT - CDC_SpiDelayStart) < CDC_SpiDelayCycles)
+    {
+      SCHED_Signal(CDC_SpiTaskId);
+      return;
+    }
+    CDC_Spi_Run();
+  }
+
+  if (CDC_SpiState == CDC_SPI_DONE)
+  {
+    /* Reconfigured while the list ran: no credit or result for the new
+       configuration, the next run drops the list */
+    if (CDC_SpiResetReq != 0U)
+    {
+      return;
+    }
+    if (CDC_SpiListOpen != 0U)
+    {
+      CDC_Spi_Retire();
+    }
+    /* Not configured or endpoint busy: the next run tries again */
+    if (USBD_CDC_TransmitFunc(&hUsbDeviceFS, 0U, (uint8_t *)&CDC_SpiResult,
+                              sizeof(CDC_SpiResult.Hdr) + CDC_SpiResult.Hdr.RxLen) == USBD_OK)
+    {
+      CDC_SpiState = CDC_SPI_SENDING;
+    }
+    return;
+  }
+
+  if (CDC_SpiState != CDC_SPI_IDLE)
+  {
+    return;
+  }
+
+  pending = CDC_SpiIn - CDC_SpiOut;
+  if (pending == 0U)
+  {
+    return;
+  }
+
+  slot = CDC_SpiOut % CDC_SPI_LIST_BUF_NUM;
+  CDC_SpiPList = CDC_SpiList[slot];
+  CDC_SpiListEnd = CDC_SpiListLen[slot];
+  CDC_SpiPos = 0U;
+  CDC_SpiListOpen = 1U;
+  (void)memset(&CDC_SpiResult.Hdr, 0, sizeof(CDC_SpiResult.Hdr));
+
+  status = CDC_Spi_Check(CDC_SpiPList, CDC_SpiListEnd);
+  if (status != CDC_SPI_STATUS_OK)
+  {
+    CDC_SpiResult.Hdr.Status = status;
+    CDC_SpiStats.BadLists++;
+    CDC_SpiState = CDC_SPI_DONE;
+    SCHED_Signal(CDC_SpiTaskId);
+    return;
+  }
+
+  /* PCLK2 may have moved since the last list */
+  CDC_Spi_Apply();
+  CDC_Spi_Run();
+}
+
+/**
+  * @brief  Snapshot of the bridge counters
+  * @param  pStats destination
+  * @retval None
+  */
+void CDC_Spi_GetStats(CDC_Spi_StatsTypeDef *pStats)
+{
+  if (pStats != NULL)
+  {
+    *pStats = CDC_SpiStats;
+  }
+}
+
+/**
+  * @brief  Receive DMA stream interrupt
+  * @retval None
+  */
+void CDC_Spi_DmaRxIRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&CDC_SpiDmaRx);
+}
+
+/**
+  * @brief  Program SPI1 for CDC_SpiHz and CDC_SpiMode: 8 bit master, the
+  *         fastest clock not above CDC_SpiHz. Only between transfers.
+  * @retval None
+  */
+static void CDC_Spi_Apply(void)
+{
+  uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+  uint32_t br = 0U;
+  uint32_t cr1;
+
+  /* SCK = PCLK2 / 2^(br + 1) */
+  while ((br < 7U) && ((pclk >> (br + 1U)) > CDC_SpiHz))
+  {
+    br++;
+  }
+
+  cr1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | (br << SPI_CR1_BR_Pos);
+  if ((CDC_SpiMode & CDC_SPI_MODE_CPHA) != 0U)
+  {
+    cr1 |= SPI_CR1_CPHA;
+  }
+  if ((CDC_SpiMode & CDC_SPI_MODE_CPOL) != 0U)
+  {
+    cr1 |= SPI_CR1_CPOL;
+  }
+  if ((CDC_SpiMode & CDC_SPI_MODE_LSB_FIRST) != 0U)
+  {
+    cr1 |= SPI_CR1_LSBFIRST;
+  }
+
+  CLEAR_BIT(CDC_SPI_INSTANCE->CR1, SPI_CR1_SPE);
+  CDC_SPI_INSTANCE->CR1 = cr1;
+  /* 8 bit frames, RXNE at each byte */
+  CDC_SPI_INSTANCE->CR2 = (7U << SPI_CR2_DS_Pos) | SPI_CR2_FRXTH;
+  SET_BIT(CDC_SPI_INSTANCE->CR1, SPI_CR1_SPE);
+}
+
+/**
+  * @brief  Stop whatever list a reconfiguration cut short, it is stale and
+  *         so is its result, then grant the host the list buffers. Task
+  *         only, with the receive DMA interrupt held off while it runs.
+  * @retval None
+  */
+static void CDC_Spi_Reset(void)
+{
+  HAL_NVIC_DisableIRQ(DMA2_Stream0_IRQn);
+
+  CDC_SpiResetReq = 0U;
+  (void)HAL_DMA_Abort(&CDC_SpiDmaRx);
+  (void)HAL_DMA_Abort(&CDC_SpiDmaTx);
+  CLEAR_BIT(CDC_SPI_INSTANCE->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+  HAL_GPIO_WritePin(CDC_SPI_CS_PORT, CDC_SPI_CS_PIN, GPIO_PIN_SET);
+  __HAL_RCC_SPI1_FORCE_RESET();
+  __HAL_RCC_SPI1_RELEASE_RESET();
+  CDC_Spi_Apply();
+
+  CDC_SpiState = CDC_SPI_IDLE;
+  CDC_SpiIn = 0U;
+  CDC_SpiOut = 0U;
+  CDC_SpiWait = 0U;
+  CDC_SpiInDone = 0U;
+  CDC_SpiInAborted = 0U;
+  CDC_SpiListOpen = 0U;
+
+  HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+  (void)USBD_CDC_GrantCreditFunc(&hUsbDeviceFS, 0U, CDC_SPI_LIST_BUF_NUM);
+}
+
+/**
+  * @brief  Check a list before any of it runs
+  * @param  pList list
+  * @param  Len list length
+  * @retval CDC_SPI_STATUS_xxx
+  */
+static uint8_t CDC_Spi_Check(const uint8_t *pList, uint32_t Len)
+{
+  uint32_t pos = 0U;
+  uint32_t rx = 0U;
+  uint32_t n;
+
+  while (pos < Len)
+  {
+    switch (pList[pos])
+    {
+      case CDC_SPI_OP_SELECT:
+      case CDC_SPI_OP_DESELECT:
+        pos += 1U;
+        break;
+
+      case CDC_SPI_OP_XFER:
+      case CDC_SPI_OP_READ:
+      case CDC_SPI_OP_WRITE:
+        if ((pos + 3U) > Len)
+        {
+          return CDC_SPI_STATUS_BAD_LIST;
+        }
+        n = (uint32_t)pList[pos + 1U] | ((uint32_t)pList[pos + 2U] << 8);
+        if (pList[pos] != CDC_SPI_OP_WRITE)
+        {
+          rx += n;
+        }
+        /* READ carries no bytes out */
+        if (pList[pos] == CDC_SPI_OP_READ)
+        {
+          n = 0U;
+        }
+        if ((pos + 3U + n) > Len)
+        {
+          return CDC_SPI_STATUS_BAD_LIST;
+        }
+        pos += 3U + n;
+        break;
+
+      case CDC_SPI_OP_DELAY:
+        pos += 3U;
+        break;
+
+      case CDC_SPI_OP_CONFIG:
+        pos += 6U;
+        break;
+
+      default:
+        return CDC_SPI_STATUS_BAD_LIST;
+    }
+  }
+
+  if (pos != Len)
+  {
+    return CDC_SPI_STATUS_BAD_LIST;
+  }
+
+  return (rx > CDC_SPI_RESULT_SIZE) ? CDC_SPI_STATUS_TOO_LONG : CDC_SPI_STATUS_OK;
+}
+
+/**
+  * @brief  Run the list from CDC_SpiPos up to the next transfer or delay, or
+  *         to its end. Called by the task to start a list or end a delay,
+  *         and by the receive DMA interrupt at the end of each transfer.
+  * @retval None
+  */
+static void CDC_Spi_Run(void)
+{
+  const uint8_t *op;
+  uint8_t *src;
+  uint8_t *dst;
+  uint32_t n;
+
+  while (CDC_SpiPos < CDC_SpiListEnd)
+  {
+    op = &CDC_SpiPList[CDC_SpiPos];
+
+    switch (op[0])
+    {
+      case CDC_SPI_OP_SELECT:
+        HAL_GPIO_WritePin(CDC_SPI_CS_PORT, CDC_SPI_CS_PIN, GPIO_PIN_RESET);
+        CDC_SpiPos += 1U;
+        break;
+
+      case CDC_SPI_OP_DESELECT:
+        HAL_GPIO_WritePin(CDC_SPI_CS_PORT, CDC_SPI_CS_PIN, GPIO_PIN_SET);
+        CDC_SpiPos += 1U;
+        break;
+
+      case CDC_SPI_OP_DELAY:
+        /* Counted at SYSCLK: a lower HCLK only makes it longer */
+        CDC_SpiDelayCycles = ((uint32_t)op[1] | ((uint32_t)op[2] << 8)) *
+                             (HAL_RCC_GetSysClockFreq() / 1000000U);
+        CDC_SpiDelayStart = DWT->CYCCNT;
+        CDC_SpiPos += 3U;
+        CDC_SpiResult.Hdr.OpsDone++;
+        CDC_SpiState = CDC_SPI_DELAY;
+        SCHED_Signal(CDC_SpiTaskId);
+        return;
+
+      case CDC_SPI_OP_CONFIG:
+        CDC_SpiHz = (uint32_t)op[1] | ((uint32_t)op[2] << 8) |
+                    ((uint32_t)op[3] << 16) | ((uint32_t)op[4] << 24);
+        CDC_SpiMode = op[5];
+        CDC_Spi_Apply();
+        CDC_SpiPos += 6U;
+        break;
+
+      default:
+        /* XFER, READ or WRITE, CDC_Spi_Check let nothing else through.
+           Transmit always runs ahead of receive, so the bytes in may land
+           where the bytes out were read from */
+        n = (uint32_t)op[1] | ((uint32_t)op[2] << 8);
+        CDC_SpiPos += 3U;
+        if (op[0] == CDC_SPI_OP_READ)
+        {
+          dst = &CDC_SpiResult.Data[CDC_SpiResult.Hdr.RxLen];
+          (void)memset(dst, 0xFF, n);
+          src = dst;
+          CDC_SpiXferIn = n;
+        }
+        else
+        {
+          src = &CDC_SpiPList[CDC_SpiPos];
+          CDC_SpiPos += n;
+          if (op[0] == CDC_SPI_OP_XFER)
+          {
+            dst = &CDC_SpiResult.Data[CDC_SpiResult.Hdr.RxLen];
+            CDC_SpiXferIn = n;
+          }
+          else
+          {
+            dst = src;
+            CDC_SpiXferIn = 0U;
+          }
+        }
+        if (n == 0U)
+        {
+          break;
+        }
+
+        /* Receive first, so no byte in is missed once transmit starts */
+        CDC_SpiXferLen = n;
+        CDC_SpiState = CDC_SPI_BUSY;
+        SET_BIT(CDC_SPI_INSTANCE->CR2, SPI_CR2_RXDMAEN);
+        if ((HAL_DMA_Start_IT(&CDC_SpiDmaRx, (uint32_t)&CDC_SPI_INSTANCE->DR, (uint32_t)dst, n) != HAL_OK) ||
+            (HAL_DMA_Start(&CDC_SpiDmaTx, (uint32_t)src, (uint32_t)&CDC_SPI_INSTANCE->DR, n) != HAL_OK))
+        {
+          CDC_Spi_DmaRxError(&CDC_SpiDmaRx);
+          return;
+        }
+        SET_BIT(CDC_SPI_INSTANCE->CR2, SPI_CR2_TXDMAEN);
+        return;
+    }
+
+    CDC_SpiResult.Hdr.OpsDone++;
+  }
+
+  CDC_SpiState = CDC_SPI_DONE;
+  SCHED_Signal(CDC_SpiTaskId);
+}
+
+/**
+  * @brief  The list at CDC_SpiOut has run: hand its buffer back to the host
+  * @retval None
+  */
+static void CDC_Spi_Retire(void)
+{
+  CDC_SpiListOpen = 0U;
+  CDC_SpiStats.Lists++;
+  CDC_SpiStats.Ops += CDC_SpiResult.Hdr.OpsDone;
+  CDC_SpiOut++;
+
+  if (hUsbDeviceFS.pClassDataCmsit[0] != NULL)
+  {
+    /* CDC_Spi_Receive found no free buffer: this one is next */
+    if (CDC_SpiWait != 0U)
+    {
+      CDC_SpiWait = 0U;
+      (void)USBD_CDC_ReceiveFunc(&hUsbDeviceFS, 0U, CDC_SpiList[CDC_SpiIn % CDC_SPI_LIST_BUF_NUM]);
+    }
+    (void)USBD_CDC_GrantCreditFunc(&hUsbDeviceFS, 0U, 1U);
+  }
+}
+
+/**
+  * @brief  A transfer ended: the last byte in is stored, so the transmit
+  *         stream finished before it. Go on with the list.
+  * @param  hdma receive DMA handle
+  * @retval None
+  */
+static void CDC_Spi_DmaRxCplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+
+  /* The transmit stream runs without interrupts, retire it here */
+  (void)HAL_DMA_PollForTransfer(&CDC_SpiDmaTx, HAL_DMA_FULL_TRANSFER, 0U);
+  CLEAR_BIT(CDC_SPI_INSTANCE->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+
+  CDC_SpiStats.TxBytes += CDC_SpiXferLen;
+  CDC_SpiResult.Hdr.RxLen += CDC_SpiXferIn;
+  CDC_SpiResult.Hdr.OpsDone++;
+
+  CDC_Spi_Run();
+}
+
+/**
+  * @brief  Transfer failed: stop the list, deselect and reset SPI1 so its
+  *         FIFOs hold nothing stale for the next one
+  * @param  hdma receive DMA handle
+  * @retval None
+  */
+static void CDC_Spi_DmaRxError(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+
+  (void)HAL_DMA_Abort(&CDC_SpiDmaRx);
+  (void)HAL_DMA_Abort(&CDC_SpiDmaTx);
+  HAL_GPIO_WritePin(CDC_SPI_CS_PORT, CDC_SPI_CS_PIN, GPIO_PIN_SET);
+  __HAL_RCC_SPI1_FORCE_RESET();
+  __HAL_RCC_SPI1_RELEASE_RESET();
+  CDC_Spi_Apply();
+
+  CDC_SpiStats.DmaErrors++;
+  CDC_SpiResult.Hdr.Status = CDC_SPI_STATUS_DMA_ERROR;
+  CDC_SpiState = CDC_SPI_DONE;
+  SCHED_Signal(CDC_SpiTaskId);
+}
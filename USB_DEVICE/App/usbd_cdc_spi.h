@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_spi.h
+  * @brief          : Header for usbd_cdc_spi.c file.
+  *                   SPI master bridge running transaction lists by DMA.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_SPI_H
+#define __USBD_CDC_SPI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_if.h"
+#include "sched.h"
+
+/* Exported constants --------------------------------------------------------*/
+/*
+ * Transaction list: one OUT transfer, a sequence of operations, each an
+ * opcode byte and its little endian arguments. The list runs to its end
+ * without the host, then one IN transfer returns CDC_Spi_ResultTypeDef
+ * followed by the bytes clocked in by the XFER and READ operations, in
+ * list order. A list is checked whole before anything runs.
+ */
+#define CDC_SPI_OP_SELECT         0x01U       /* chip select low */
+#define CDC_SPI_OP_DESELECT       0x02U       /* chip select high */
+#define CDC_SPI_OP_XFER           0x03U       /* u16 n, n bytes out; n bytes in */
+#define CDC_SPI_OP_READ           0x04U       /* u16 n; n bytes of 0xFF out, n bytes in */
+#define CDC_SPI_OP_WRITE          0x05U       /* u16 n, n bytes out; nothing in */
+#define CDC_SPI_OP_DELAY          0x06U       /* u16 microseconds, at least */
+#define CDC_SPI_OP_CONFIG         0x07U       /* u32 highest clock in Hz, u8 CDC_SPI_MODE_xxx */
+
+#define CDC_SPI_MODE_CPHA         0x01U
+#define CDC_SPI_MODE_CPOL         0x02U
+#define CDC_SPI_MODE_LSB_FIRST    0x80U
+
+/* CDC_Spi_ResultTypeDef Status */
+#define CDC_SPI_STATUS_OK         0x00U
+#define CDC_SPI_STATUS_BAD_LIST   0x01U       /* malformed, nothing ran */
+#define CDC_SPI_STATUS_TOO_LONG   0x02U       /* more bytes in than CDC_SPI_RESULT_SIZE, nothing ran */
+#define CDC_SPI_STATUS_DMA_ERROR  0x03U       /* stopped after OpsDone, chip deselected */
+
+#define CDC_SPI_LIST_BUF_NUM      2U          /* lists held, each free one a credit */
+#define CDC_SPI_LIST_SIZE         CDC_RX_XFER_MAX_SIZE
+#define CDC_SPI_RESULT_SIZE       2048U       /* bytes in per list */
+
+#define CDC_SPI_DEFAULT_HZ        1000000U
+#define CDC_SPI_DEFAULT_MODE      0x00U
+
+/* Exported types ------------------------------------------------------------*/
+/* Head of the IN transfer answering a list, little endian */
+typedef struct
+{
+  uint8_t  Status;         /* CDC_SPI_STATUS_xxx */
+  uint8_t  Reserved;
+  uint16_t OpsDone;        /* operations completed */
+  uint32_t RxLen;          /* bytes in that follow */
+} CDC_Spi_ResultTypeDef;
+
+typedef struct
+{
+  uint32_t Lists;
+  uint32_t Ops;
+  uint32_t TxBytes;        /* bytes clocked out */
+  uint32_t RxBytes;        /* bytes returned to the host */
+  uint32_t BadLists;       /* BAD_LIST and TOO_LONG */
+  uint32_t DmaErrors;
+} CDC_Spi_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CDC_Spi_Init(uint32_t TaskId);
+void CDC_Spi_Task(void *pArg);
+uint8_t CDC_Spi_IsBridged(void);
+void CDC_Spi_Start(void);
+void CDC_Spi_Receive(uint8_t *pBuf, uint32_t Len);
+void CDC_Spi_TxCplt(void);
+void CDC_Spi_TxAbort(void);
+void CDC_Spi_GetStats(CDC_Spi_StatsTypeDef *pStats);
+
+void CDC_Spi_DmaRxIRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_SPI_H */
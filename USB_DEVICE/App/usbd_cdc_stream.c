@@ -0,0 +1,603 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_stream.c
+  * @brief          : Zero-copy byte streams drained to the CDC IN endpoint.
+  *
+  *                   The service task run by CDC_Stream_Task is the only
+  *                   code that starts IN transfers once streams are attached:
+  *                   producers reserve space in their own stream, fill it in
+  *                   place and commit it, and the service task hands the
+  *                   committed bytes to the endpoint straight out of the
+  *                   ring. Streams are served round robin, one transfer at a
+  *                   time, so a busy producer cannot starve the others.
+  *
+  *                   A stream with a wake level makes CDC_Stream_WakeTask
+  *                   wake a suspended host once that much data is pending;
+  *                   the data is already queued on the endpoint and leaves
+  *                   with the first packets after the resume.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_stream.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CDC_STREAM_NONE           0xFFFFFFFFU
+
+/* Private variables ---------------------------------------------------------*/
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static CDC_StreamTypeDef *CDC_Streams[CDC_STREAM_MAX];
+static uint32_t CDC_StreamNum;
+static uint32_t CDC_StreamNext;
+
+static uint32_t CDC_StreamTaskId = SCHED_NO_TASK;
+
+/* Stream and length of the transfer on the IN endpoint */
+static uint32_t CDC_StreamBusy = CDC_STREAM_NONE;
+static uint32_t CDC_StreamInFlight;
+
+/* Set from the USB interrupt when the IN endpoint went idle, with
+   TxAborted when the transfer was dropped instead of sent */
+static __IO uint8_t CDC_StreamTxDone;
+static __IO uint8_t CDC_StreamTxAborted;
+
+/* Remote wakeup policy, run by CDC_Stream_WakeTask */
+static CDC_StreamWakeStatsTypeDef CDC_StreamWakeStats;
+static uint8_t CDC_StreamWaking;
+static uint8_t CDC_StreamWakeRefused;  /* until the host resumes the link itself */
+static uint32_t CDC_StreamWakeTick;
+
+/* Private function prototypes -----------------------------------------------*/
+static void CDC_Stream_Complete(void);
+static uint32_t CDC_Stream_Start(void);
+static uint8_t CDC_Stream_EpIdle(void);
+static void CDC_Stream_WakeCheck(CDC_StreamTypeDef *pStream);
+
+/**
+  * @brief  Initialize an empty stream.
+  * @param  pStream stream
+  * @param  pBuf storage, must stay valid while the stream is attached
+  * @param  Size storage size in bytes, a power of two
+  * @param  ProducerTask task signalled when space is freed, SCHED_NO_TASK for none
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CDC_Stream_Init(CDC_StreamTypeDef *pStream, uint8_t *pBuf, uint32_t Size,
+                                  uint32_t ProducerTask)
+{
+  if ((pStream == NULL) || (pBuf == NULL) || (Size == 0U) || ((Size & (Size - 1U)) != 0U))
+  {
+    return HAL_ERROR;
+  }
+
+  pStream->pBuf = pBuf;
+  pStream->Size = Size;
+  pStream->Head = 0U;
+  pStream->Tail = 0U;
+  pStream->ProducerTask = ProducerTask;
+  pStream->Dropped = 0U;
+  pStream->WakeLevel = CDC_STREAM_WAKE_NEVER;
+  pStream->WakeStart = 0U;
+  pStream->WakeReq = 0U;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Hand a stream to the service task. Call from thread context.
+  * @param  pStream initialized stream
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CDC_Stream_Attach(CDC_StreamTypeDef *pStream)
+{
+  uint32_t i;
+
+  if ((pStream == NULL) || (pStream->pBuf == NULL))
+  {
+    return HAL_ERROR;
+  }
+
+  for (i = 0U; i < CDC_StreamNum; i++)
+  {
+    if (CDC_Streams[i] == pStream)
+    {
+      return HAL_OK;
+    }
+  }
+
+  if (CDC_StreamNum >= CDC_STREAM_MAX)
+  {
+    return HAL_ERROR;
+  }
+
+  CDC_Streams[CDC_StreamNum] = pStream;
+  CDC_StreamNum++;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Get the contiguous free space at the head of a stream. Producer only.
+  * @param  pStream stream
+  * @param  pLen receives the number of bytes that may be written, 0 when full
+  * @retval where to write them
+  */
+uint8_t *CDC_Stream_Reserve(CDC_StreamTypeDef *pStream, uint32_t *pLen)
+{
+  uint32_t head = pStream->Head;
+  uint32_t offset = head & (pStream->Size - 1U);
+  uint32_t space = pStream->Size - (head - pStream->Tail);
+
+  if (space > (pStream->Size - offset))
+  {
+    /* The rest is at the start of the buffer, reserved by the next call */
+    space = pStream->Size - offset;
+  }
+
+  *pLen = space;
+  return &pStream->pBuf[offset];
+}
+
+/**
+  * @brief  Publish bytes written to the reserved space and wake the service
+  *         task. Producer only.
+  * @param  pStream stream
+  * @param  Len number of bytes written, at most the reserved length
+  * @retval None
+  */
+void CDC_Stream_Commit(CDC_StreamTypeDef *pStream, uint32_t Len)
+{
+  if (Len == 0U)
+  {
+    return;
+  }
+
+  /* Data first, then the index the service task reads it by */
+  __DMB();
+  pStream->Head += Len;
+
+  CDC_Stream_WakeCheck(pStream);
+
+  SCHED_Signal(CDC_StreamTaskId);
+}
+
+/**
+  * @brief  Copy data into a stream, for producers that do not build their
+  *         data in place. Producer only.
+  * @param  pStream stream
+  * @param  pData data
+  * @param  Len number of bytes
+  * @retval number of bytes taken, the rest is counted in Dropped
+  */
+uint32_t CDC_Stream_Write(CDC_StreamTypeDef *pStream, const uint8_t *pData, uint32_t Len)
+{
+  uint32_t done = 0U;
+  uint32_t space;
+  uint8_t *dst;
+
+  while (done < Len)
+  {
+    dst = CDC_Stream_Reserve(pStream, &space);
+    if (space == 0U)
+    {
+      break;
+    }
+    if (space > (Len - done))
+    {
+      space = Len - done;
+    }
+    (void)memcpy(dst, &pData[done], space);
+    done += space;
+
+    /* Publish each part so the service can start on it while we wrap */
+    CDC_Stream_Commit(pStream, space);
+  }
+
+  pStream->Dropped += Len - done;
+
+  return done;
+}
+
+/**
+  * @brief  Decimate q15 samples straight into a stream, for acquisition
+  *         buffers sampled faster than the IN endpoint can carry. The
+  *         stream must carry these samples only, from a halfword aligned
+  *         buffer. Producer only.
+  * @param  pStream stream
+  * @param  pDec decimation stage, see DECIM_Init
+  * @param  pSrc input samples
+  * @param  Len number of input samples
+  * @retval number of samples queued; output that did not fit still runs
+  *         through the filters and is counted in Dropped
+  */
+uint32_t CDC_Stream_WriteDecim(CDC_StreamTypeDef *pStream, DECIM_InstanceTypeDef *pDec,
+                               const int16_t *pSrc, uint32_t Len)
+{
+  uint32_t done = 0U;
+  uint32_t queued = 0U;
+  uint32_t space;
+  uint32_t len;
+  uint32_t out;
+  uint8_t *dst;
+
+  while (done < Len)
+  {
+    dst = CDC_Stream_Reserve(pStream, &space);
+    if ((space / sizeof(int16_t)) == 0U)
+    {
+      break;
+    }
+    len = Len - done;
+    out = DECIM_Process(pDec, &pSrc[done], &len, (int16_t *)(void *)dst, space / sizeof(int16_t));
+    done += len;
+    queued += out;
+
+    if (out != 0U)
+    {
+      CDC_Stream_Commit(pStream, out * sizeof(int16_t));
+    }
+  }
+
+  if (done < Len)
+  {
+    len = Len - done;
+    pStream->Dropped += DECIM_Process(pDec, &pSrc[done], &len, NULL, 0U) * sizeof(int16_t);
+  }
+
+  return queued;
+}
+
+/**
+  * @brief  Free space of a stream, contiguous or not.
+  * @param  pStream stream
+  * @retval bytes
+  */
+uint32_t CDC_Stream_Free(const CDC_StreamTypeDef *pStream)
+{
+  return pStream->Size - (pStream->Head - pStream->Tail);
+}
+
+/**
+  * @brief  Bytes committed to the attached streams and not sent yet.
+  * @retval bytes
+  */
+uint32_t CDC_Stream_Pending(void)
+{
+  uint32_t pending = 0U;
+  uint32_t i;
+
+  for (i = 0U; i < CDC_StreamNum; i++)
+  {
+    pending += CDC_Streams[i]->Head - CDC_Streams[i]->Tail;
+  }
+
+  return pending;
+}
+
+/**
+  * @brief  Set the scheduler task that runs CDC_Stream_Task.
+  * @param  TaskId task id from SCHED_AddTask
+  * @retval None
+  */
+void CDC_Stream_SetTask(uint32_t TaskId)
+{
+  CDC_StreamTaskId = TaskId;
+}
+
+/**
+  * @brief  USB service task: retire the finished transfer, start the next.
+  * @param  pArg unused
+  * @retval None
+  */
+void CDC_Stream_Task(void *pArg)
+{
+  UNUSED(pArg);
+
+  if ((CDC_StreamBusy != CDC_STREAM_NONE) && (CDC_StreamTxDone == 0U) && (CDC_Stream_EpIdle() != 0U))
+  {
+    /* The endpoint let go of our transfer without a completion: whatever
+       dropped it did not report it, retry rather than wait forever */
+    CDC_StreamTxAborted = 1U;
+    CDC_StreamTxDone = 1U;
+  }
+
+  if (CDC_StreamTxDone != 0U)
+  {
+    CDC_StreamTxDone = 0U;
+    CDC_Stream_Complete();
+  }
+
+  /* If nothing can start, the next commit or TxDone wakes us again */
+  if (CDC_StreamBusy == CDC_STREAM_NONE)
+  {
+    (void)CDC_Stream_Start();
+  }
+}
+
+/**
+  * @brief  IN transfer complete, call from CDC_TransmitCplt_FS.
+  * @retval None
+  */
+void CDC_Stream_TxCplt(void)
+{
+  CDC_StreamTxDone = 1U;
+  SCHED_Signal(CDC_StreamTaskId);
+}
+
+/**
+  * @brief  IN transfer dropped by the class, call from CDC_TransmitCplt_FS
+  *         when CDC_TX_ABORTED is set: the data stays in its stream and
+  *         goes out again first.
+  * @retval None
+  */
+void CDC_Stream_TxAbort(void)
+{
+  CDC_StreamTxAborted = 1U;
+  CDC_Stream_TxCplt();
+}
+
+/**
+  * @brief  The class was (re)initialized, call from CDC_Init_FS: a transfer
+  *         in flight is lost and counts as sent, and streams filled while
+  *         the device was not configured can go out now.
+  * @retval None
+  */
+void CDC_Stream_Reset(void)
+{
+  CDC_StreamTxAborted = 0U;
+  CDC_Stream_TxCplt();
+}
+
+/**
+  * @brief  Set when a stream wakes a suspended host.
+  * @param  pStream stream
+  * @param  WakeLevel pending bytes that justify a remote wakeup, CDC_STREAM_WAKE_ANY
+  *         for an urgent stream, CDC_STREAM_WAKE_NEVER to wait for the host
+  * @retval None
+  */
+void CDC_Stream_SetWake(CDC_StreamTypeDef *pStream, uint32_t WakeLevel)
+{
+  pStream->WakeLevel = WakeLevel;
+}
+
+/**
+  * @brief  Remote wakeup task, run periodically every millisecond: signals
+  *         remote wakeup for the streams that asked for it and times the
+  *         resume signalling.
+  * @param  pArg unused
+  * @retval None
+  */
+void CDC_Stream_WakeTask(void *pArg)
+{
+  uint32_t wanted = 0U;
+  uint32_t i;
+
+  UNUSED(pArg);
+
+  if (USBD_LL_RemoteWakeupPending(&hUsbDeviceFS) != 0U)
+  {
+    return;
+  }
+
+  if (hUsbDeviceFS.dev_state != USBD_STATE_SUSPENDED)
+  {
+    CDC_StreamWakeRefused = 0U;
+  }
+
+  for (i = 0U; i < CDC_StreamNum; i++)
+  {
+    /* Also data queued before the suspend that the host left unread */
+    CDC_Stream_WakeCheck(CDC_Streams[i]);
+    if (CDC_Streams[i]->WakeReq == 1U)
+    {
+      CDC_Streams[i]->WakeReq = 2U;
+      CDC_StreamWakeStats.Requests++;
+    }
+    if (CDC_Streams[i]->WakeReq != 0U)
+    {
+      wanted = 1U;
+    }
+  }
+
+  if ((wanted == 0U) || (hUsbDeviceFS.dev_state != USBD_STATE_SUSPENDED))
+  {
+    CDC_StreamWaking = 0U;
+    return;
+  }
+
+  if ((CDC_StreamWaking != 0U) && ((HAL_GetTick() - CDC_StreamWakeTick) < CDC_STREAM_WAKE_RETRY_MS))
+  {
+    /* Give the host time to answer the last wakeup */
+    return;
+  }
+
+  switch (USBD_LL_RemoteWakeup(&hUsbDeviceFS))
+  {
+    case USBD_OK:
+      CDC_StreamWakeStats.Signals++;
+      CDC_StreamWaking = 1U;
+      CDC_StreamWakeTick = HAL_GetTick();
+      break;
+
+    case USBD_BUSY:
+      break;
+
+    default:
+      /* Not allowed, by the build, the host's DEVICE_REMOTE_WAKEUP feature
+         or the LPM token: the data waits for the host like any other */
+      CDC_StreamWakeStats.Refused++;
+      CDC_StreamWakeRefused = 1U;
+      for (i = 0U; i < CDC_StreamNum; i++)
+      {
+        CDC_Streams[i]->WakeReq = 0U;
+      }
+      break;
+  }
+}
+
+/**
+  * @brief  Copy the remote wakeup accounting. Call from thread context.
+  * @param  pStats destination
+  * @retval None
+  */
+void CDC_Stream_GetWakeStats(CDC_StreamWakeStatsTypeDef *pStats)
+{
+  *pStats = CDC_StreamWakeStats;
+}
+
+/**
+  * @brief  Raise the wake request of a stream that reached its wake level
+  *         while the link is suspended. Task context.
+  * @param  pStream stream
+  * @retval None
+  */
+static void CDC_Stream_WakeCheck(CDC_StreamTypeDef *pStream)
+{
+  if ((pStream->WakeLevel != CDC_STREAM_WAKE_NEVER) && (pStream->WakeReq == 0U) &&
+      (CDC_StreamWakeRefused == 0U) && (hUsbDeviceFS.dev_state == USBD_STATE_SUSPENDED) &&
+      ((pStream->Head - pStream->Tail) >= pStream->WakeLevel))
+  {
+    pStream->WakeStart = DWT->CYCCNT;
+    pStream->WakeReq = 1U;
+  }
+}
+
+/**
+  * @brief  Give the space of the finished transfer back to its producer.
+  * @retval None
+  */
+static void CDC_Stream_Complete(void)
+{
+  CDC_StreamTypeDef *stream;
+  uint32_t cycles;
+
+  if (CDC_StreamBusy == CDC_STREAM_NONE)
+  {
+    /* A transfer started outside the service task, or a reset while idle */
+    return;
+  }
+
+  stream = CDC_Streams[CDC_StreamBusy];
+
+  if (CDC_StreamTxAborted != 0U)
+  {
+    /* Nothing was consumed: same stream, same bytes, next */
+    CDC_StreamTxAborted = 0U;
+    CDC_StreamNext = CDC_StreamBusy;
+    CDC_StreamBusy = CDC_STREAM_NONE;
+    CDC_StreamInFlight = 0U;
+    return;
+  }
+
+  CDC_StreamBusy = CDC_STREAM_NONE;
+
+  /* The endpoint is done reading, then the producer may overwrite */
+  __DMB();
+  stream->Tail += CDC_StreamInFlight;
+  CDC_StreamInFlight = 0U;
+
+  if ((stream->WakeReq != 0U) && (hUsbDeviceFS.dev_state != USBD_STATE_SUSPENDED))
+  {
+    cycles = DWT->CYCCNT - stream->WakeStart;
+    stream->WakeReq = 0U;
+    CDC_StreamWakeStats.Delivered++;
+    CDC_StreamWakeStats.CyclesLast = cycles;
+    if (cycles > CDC_StreamWakeStats.CyclesMax)
+    {
+      CDC_StreamWakeStats.CyclesMax = cycles;
+    }
+  }
+
+  SCHED_Signal(stream->ProducerTask);
+}
+
+/**
+  * @brief  Start an IN transfer from the next stream holding data.
+  * @retval 1 if a transfer was started
+  */
+static uint32_t CDC_Stream_Start(void)
+{
+  CDC_StreamTypeDef *stream;
+  uint32_t first = CDC_StreamNext;
+  uint32_t n;
+  uint32_t i;
+  uint32_t tail;
+  uint32_t offset;
+  uint32_t len;
+
+  /* Configured, possibly in L1 or suspend: the transfer then waits in the
+     FIFO for the host to resume the link */
+  if (hUsbDeviceFS.pClassData == NULL)
+  {
+    return 0U;
+  }
+
+  /* A stream that woke the host goes first */
+  for (i = 0U; i < CDC_StreamNum; i++)
+  {
+    if ((CDC_Streams[i]->WakeReq != 0U) && (CDC_Streams[i]->Head != CDC_Streams[i]->Tail))
+    {
+      first = i;
+      break;
+    }
+  }
+
+  for (n = 0U; n < CDC_StreamNum; n++)
+  {
+    i = (first + n) % CDC_StreamNum;
+    stream = CDC_Streams[i];
+
+    tail = stream->Tail;
+    len = stream->Head - tail;
+    if (len == 0U)
+    {
+      continue;
+    }
+    /* Head read before the data it covers */
+    __DMB();
+
+    offset = tail & (stream->Size - 1U);
+    if (len > (stream->Size - offset))
+    {
+      len = stream->Size - offset;
+    }
+    if (len > CDC_STREAM_MAX_XFER)
+    {
+      len = CDC_STREAM_MAX_XFER;
+    }
+
+    /* Owned before the transfer starts, its completion may come right away */
+    CDC_StreamTxDone = 0U;
+    CDC_StreamTxAborted = 0U;
+    CDC_StreamBusy = i;
+    CDC_StreamInFlight = len;
+
+    if (CDC_Transmit_FS(&stream->pBuf[offset], (uint16_t)len) != USBD_OK)
+    {
+      /* Endpoint taken by a transfer from outside: retried on its TxDone */
+      CDC_StreamBusy = CDC_STREAM_NONE;
+      CDC_StreamInFlight = 0U;
+      return 0U;
+    }
+
+    CDC_StreamNext = i + 1U;
+    return 1U;
+  }
+
+  return 0U;
+}
+
+/**
+  * @brief  Tell whether the IN endpoint of the first function is free.
+  *         Completions and aborts come from the USB interrupt, which sets
+  *         TxState and reports the transfer in one go, so the task sees
+  *         either both or neither.
+  * @retval 1 if no transfer is on the endpoint
+  */
+static uint8_t CDC_Stream_EpIdle(void)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef *)hUsbDeviceFS.pClassDataCmsit[0];
+
+  return ((hcdc == NULL) || (hcdc->TxState == 0U)) ? 1U : 0U;
+}
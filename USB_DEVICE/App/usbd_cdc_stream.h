@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_stream.h
+  * @brief          : Header for usbd_cdc_stream.c file.
+  *                   Zero-copy byte streams drained to the CDC IN endpoint by
+  *                   one USB service task.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_STREAM_H
+#define __USBD_CDC_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_if.h"
+#include "sched.h"
+#include "decim.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define CDC_STREAM_MAX            4U          /* streams attached to the service task */
+#define CDC_STREAM_MAX_XFER       0x1000U     /* largest IN transfer taken out of a stream */
+
+#define CDC_STREAM_WAKE_NEVER     0U          /* data waits for the host to resume the link */
+#define CDC_STREAM_WAKE_ANY       1U          /* urgent stream: any data wakes the host */
+#define CDC_STREAM_WAKE_RETRY_MS  50U         /* between wakeups the host did not answer */
+
+/* Exported types ------------------------------------------------------------*/
+/*
+ * Single producer, single consumer ring. Head only moves in the producer,
+ * Tail only in the service task, both run freely and wrap at 2^32 so no lock
+ * is needed; several producers each own a stream of their own.
+ */
+typedef struct
+{
+  uint8_t       *pBuf;
+  uint32_t      Size;          /* power of two */
+  __IO uint32_t Head;          /* bytes committed by the producer */
+  __IO uint32_t Tail;          /* bytes sent by the service task */
+  uint32_t      ProducerTask;  /* signalled when space is freed, SCHED_NO_TASK for none */
+  uint32_t      Dropped;       /* bytes CDC_Stream_Write could not take */
+  uint32_t      WakeLevel;     /* pending bytes that wake a suspended host, CDC_STREAM_WAKE_NEVER */
+  uint32_t      WakeStart;     /* DWT cycle count of the wake request */
+  __IO uint8_t  WakeReq;       /* set by the producer, cleared once the data went out */
+} CDC_StreamTypeDef;
+
+typedef struct
+{
+  uint32_t Requests;       /* streams that passed their wake level while suspended */
+  uint32_t Signals;        /* remote wakeups signalled */
+  uint32_t Refused;        /* remote wakeup not enabled by the host */
+  uint32_t Delivered;      /* urgent transfers completed after a wake request */
+  uint32_t CyclesLast;     /* wake request to urgent transfer complete */
+  uint32_t CyclesMax;
+} CDC_StreamWakeStatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CDC_Stream_Init(CDC_StreamTypeDef *pStream, uint8_t *pBuf, uint32_t Size,
+                                  uint32_t ProducerTask);
+HAL_StatusTypeDef CDC_Stream_Attach(CDC_StreamTypeDef *pStream);
+uint8_t *CDC_Stream_Reserve(CDC_StreamTypeDef *pStream, uint32_t *pLen);
+void CDC_Stream_Commit(CDC_StreamTypeDef *pStream, uint32_t Len);
+uint32_t CDC_Stream_Write(CDC_StreamTypeDef *pStream, const uint8_t *pData, uint32_t Len);
+uint32_t CDC_Stream_WriteDecim(CDC_StreamTypeDef *pStream, DECIM_InstanceTypeDef *pDec,
+                               const int16_t *pSrc, uint32_t Len);
+uint32_t CDC_Stream_Free(const CDC_StreamTypeDef *pStream);
+uint32_t CDC_Stream_Pending(void);
+
+void CDC_Stream_SetTask(uint32_t TaskId);
+void CDC_Stream_Task(void *pArg);
+void CDC_Stream_TxCplt(void);
+void CDC_Stream_TxAbort(void);
+void CDC_Stream_Reset(void);
+
+void CDC_Stream_SetWake(CDC_StreamTypeDef *pStream, uint32_t WakeLevel);
+void CDC_Stream_WakeTask(void *pArg);
+void CDC_Stream_GetWakeStats(CDC_StreamWakeStatsTypeDef *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_STREAM_H */
@@ -0,0 +1,844 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_uart.c
+  * @brief          : CDC to USART bridge, DMA in both directions.
+  *
+  *                   Each CDC function bridges one USART. Received OUT
+  *                   transfers are sent by DMA straight out of the buffer
+  *                   the endpoint filled; there are two such buffers, so
+  *                   the endpoint is re-armed on one while the other
+  *                   drains, and each drained buffer goes back to the host
+  *                   as a credit. The receiver runs a circular DMA into a
+  *                   ring that CDC_Uart_Task hands to the IN endpoint in
+  *                   place when the line goes idle or half the ring has
+  *                   filled. The CPU only sees the idle line, the DMA
+  *                   half/full events and the end of each OUT buffer, never
+  *                   single bytes.
+  *
+  *                   The USARTs are clocked from SYSCLK, which the clock
+  *                   governor leaves at 216 MHz, so SET_LINE_CODING can ask
+  *                   for up to 27 Mbaud and the rate holds when HCLK steps
+  *                   down. The UART HAL module is not part of this tree:
+  *                   the USART registers are driven directly, the DMA
+  *                   streams through the HAL DMA driver.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_uart.h"
+#include <string.h>
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  USART_TypeDef      *Instance;
+  GPIO_TypeDef       *GpioPort;
+  uint32_t           Pins;          /* TX and RX */
+  uint32_t           Af;
+  IRQn_Type          Irqn;
+  DMA_Stream_TypeDef *RxStream;
+  uint32_t           RxChannel;
+  IRQn_Type          RxIrqn;
+  DMA_Stream_TypeDef *TxStream;
+  uint32_t           TxChannel;
+  IRQn_Type          TxIrqn;
+} CDC_Uart_CfgTypeDef;
+
+typedef struct
+{
+  const CDC_Uart_CfgTypeDef *pCfg;
+  DMA_HandleTypeDef hdmaRx;
+  DMA_HandleTypeDef hdmaTx;
+
+  /* USB to UART: OUT buffers, filled by the endpoint and drained by DMA in turn */
+  uint32_t      OutNum;
+  uint32_t      OutSize;
+  uint32_t      OutLen[CDC_UART_OUT_BUF_NUM];
+  __IO uint32_t OutIn;          /* transfers received, CDC_Uart_Receive only */
+  __IO uint32_t OutOut;         /* transfers sent on the line, CDC_Uart_Task only */
+  __IO uint8_t  OutWait;        /* all buffers full, the endpoint is not armed */
+  __IO uint8_t  TxBusy;         /* TX DMA running */
+  __IO uint8_t  TxDone;         /* set by the TX DMA interrupt */
+
+  /* UART to USB: circular DMA ring */
+  __IO uint32_t RxLaps;         /* ring wraps, counted by the RX DMA interrupt */
+  uint32_t      RxHead;         /* bytes written by the DMA, as last seen */
+  uint32_t      RxTail;         /* bytes handed to the host */
+  uint32_t      InFlight;       /* length of the IN transfer out of the ring */
+  __IO uint8_t  InDone;         /* set from the USB interrupt when it completed */
+  __IO uint8_t  InAborted;      /* with InDone: dropped by the class, not sent */
+  __IO uint8_t  RxResync;       /* the ring restarted after a DMA error */
+  uint8_t       RxMask;         /* data bits of the applied coding, 7 bits drop the parity bit */
+
+  /* Line coding asked for by the host, applied once the transmitter is idle */
+  USBD_CDC_LineCodingTypeDef Coding;
+  __IO uint8_t  CodingPending;
+
+  CDC_Uart_StatsTypeDef Stats;
+} CDC_Uart_PortTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static const CDC_Uart_CfgTypeDef CDC_UartCfg[CDC_UART_PORT_NUM] =
+{
+  /* USART3 on PD8/PD9, the ST-LINK virtual COM port */
+  {
+    USART3, GPIOD, GPIO_PIN_8 | GPIO_PIN_9, GPIO_AF7_USART3, USART3_IRQn,
+    DMA1_Stream1, DMA_CHANNEL_4, DMA1_Stream1_IRQn,
+    DMA1_Stream3, DMA_CHANNEL_4, DMA1_Stream3_IRQn
+  },
+#if (USBD_CDC_FUNC_NUM > 1U)
+  /* USART6 on PG14/PG9, D1/D0 of the Arduino connector */
+  {
+    USART6, GPIOG, GPIO_PIN_14 | GPIO_PIN_9, GPIO_AF8_USART6, USART6_IRQn,
+    DMA2_Stream1, DMA_CHANNEL_5, DMA2_Stream1_IRQn,
+    DMA2_Stream6, DMA_CHANNEL_5, DMA2_Stream6_IRQn
+  },
+#endif /* USBD_CDC_FUNC_NUM */
+};
+
+static CDC_Uart_PortTypeDef CDC_UartPorts[CDC_UART_PORT_NUM];
+
+static uint8_t CDC_UartOut[CDC_UART_PORT_NUM][CDC_UART_OUT_BUF_NUM * CDC_UART_OUT_BUF_SIZE];
+static uint8_t CDC_UartRing[CDC_UART_PORT_NUM][CDC_UART_RX_RING_SIZE];
+
+static uint32_t CDC_UartTaskId = SCHED_NO_TASK;
+
+/* Private function prototypes -----------------------------------------------*/
+static void CDC_Uart_ClockEnable(const CDC_Uart_CfgTypeDef *pCfg);
+static uint32_t CDC_Uart_Brr(uint32_t Fck, uint32_t Bitrate, uint32_t *pOver8);
+static HAL_StatusTypeDef CDC_Uart_Apply(CDC_Uart_PortTypeDef *pPort);
+static void CDC_Uart_ServiceOut(uint32_t Port);
+static void CDC_Uart_ServiceIn(uint32_t Port);
+static void CDC_Uart_DmaRxCplt(DMA_HandleTypeDef *hdma);
+static void CDC_Uart_DmaTxCplt(DMA_HandleTypeDef *hdma);
+static void CDC_Uart_DmaRxError(DMA_HandleTypeDef *hdma);
+static void CDC_Uart_DmaTxError(DMA_HandleTypeDef *hdma);
+static void CDC_Uart_Signal(DMA_HandleTypeDef *hdma);
+
+/**
+  * @brief  Bring up every port at CDC_UART_DEFAULT_BAUD 8N1 and give the CDC
+  *         functions to the bridge. Call from thread context, before the
+  *         host configures the device.
+  * @param  TaskId task running CDC_Uart_Task
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CDC_Uart_Init(uint32_t TaskId)
+{
+  GPIO_InitTypeDef gpio = {0};
+  uint32_t i;
+
+  if (TaskId == SCHED_NO_TASK)
+  {
+    return HAL_ERROR;
+  }
+
+  for (i = 0U; i < CDC_UART_PORT_NUM; i++)
+  {
+    CDC_Uart_PortTypeDef *port = &CDC_UartPorts[i];
+    const CDC_Uart_CfgTypeDef *cfg = &CDC_UartCfg[i];
+
+    (void)memset(port, 0, sizeof(*port));
+    port->pCfg = cfg;
+    port->OutNum = 1U;
+    port->OutSize = sizeof(CDC_UartOut[i]);
+    port->Coding.bitrate = CDC_UART_DEFAULT_BAUD;
+    port->Coding.format = 0U;
+    port->Coding.paritytype = 0U;
+    port->Coding.datatype = 8U;
+
+    CDC_Uart_ClockEnable(cfg);
+
+    gpio.Pin = cfg->Pins;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Pull = GPIO_PULLUP;
+    gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    gpio.Alternate = cfg->Af;
+    HAL_GPIO_Init(cfg->GpioPort, &gpio);
+
+    /* Receiver: circular, the ring is drained behind the write position */
+    port->hdmaRx.Instance = cfg->RxStream;
+    port->hdmaRx.Init.Channel = cfg->RxChannel;
+    port->hdmaRx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    port->hdmaRx.Init.PeriphInc = DMA_PINC_DISABLE;
+    port->hdmaRx.Init.MemInc = DMA_MINC_ENABLE;
+    port->hdmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    port->hdmaRx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    port->hdmaRx.Init.Mode = DMA_CIRCULAR;
+    port->hdmaRx.Init.Priority = DMA_PRIORITY_HIGH;
+    port->hdmaRx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    port->hdmaRx.Parent = port;
+
+    /* Transmitter: one OUT buffer per transfer */
+    port->hdmaTx.Instance = cfg->TxStream;
+    port->hdmaTx.Init.Channel = cfg->TxChannel;
+    port->hdmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    port->hdmaTx.Init.PeriphInc = DMA_PINC_DISABLE;
+    port->hdmaTx.Init.MemInc = DMA_MINC_ENABLE;
+    port->hdmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    port->hdmaTx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    port->hdmaTx.Init.Mode = DMA_NORMAL;
+    port->hdmaTx.Init.Priority = DMA_PRIORITY_MEDIUM;
+    port->hdmaTx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    port->hdmaTx.Parent = port;
+
+    if ((HAL_DMA_Init(&port->hdmaRx) != HAL_OK) || (HAL_DMA_Init(&port->hdmaTx) != HAL_OK))
+    {
+      return HAL_ERROR;
+    }
+
+    /* Half and full ring both flush, the idle line flushes the rest */
+    port->hdmaRx.XferHalfCpltCallback = CDC_Uart_Signal;
+    port->hdmaRx.XferCpltCallback = CDC_Uart_DmaRxCplt;
+    port->hdmaRx.XferErrorCallback = CDC_Uart_DmaRxError;
+    port->hdmaTx.XferCpltCallback = CDC_Uart_DmaTxCplt;
+    port->hdmaTx.XferErrorCallback = CDC_Uart_DmaTxError;
+
+    if (CDC_Uart_Apply(port) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+
+    if (HAL_DMA_Start_IT(&port->hdmaRx, (uint32_t)&cfg->Instance->RDR, (uint32_t)CDC_UartRing[i],
+                         CDC_UART_RX_RING_SIZE) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+
+    /* Priorities come from IRQPRIO_TABLE */
+    HAL_NVIC_EnableIRQ(cfg->RxIrqn);
+    HAL_NVIC_EnableIRQ(cfg->TxIrqn);
+    HAL_NVIC_EnableIRQ(cfg->Irqn);
+  }
+
+  CDC_UartTaskId = TaskId;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Whether a CDC function is bridged to its USART
+  * @param  Port CDC function index
+  * @retval 1 if bridged
+  */
+uint8_t CDC_Uart_IsBridged(uint32_t Port)
+{
+  return ((CDC_UartTaskId != SCHED_NO_TASK) && (Port < CDC_UART_PORT_NUM)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Hand the OUT buffers to the endpoint of a freshly configured
+  *         function. Called from its interface Init callback, the class
+  *         arms the first buffer on return.
+  * @param  Port CDC function index
+  * @retval None
+  */
+void CDC_Uart_Start(uint32_t Port)
+{
+  CDC_Uart_PortTypeDef *port = &CDC_UartPorts[Port];
+
+  /* Whatever a reset cut short is stale, the DMA interrupt is less urgent */
+  (void)HAL_DMA_Abort(&port->hdmaTx);
+  port->TxBusy = 0U;
+  port->TxDone = 0U;
+  port->OutIn = 0U;
+  port->OutOut = 0U;
+  port->OutWait = 0U;
+  port->InFlight = 0U;
+  port->InDone = 0U;
+  port->InAborted = 0U;
+
+  /* Two transfers fit when the OUT transfer size leaves room for them */
+  port->OutNum = ((USBD_CDC_GetParams()->RxXferSize * CDC_UART_OUT_BUF_NUM) <= sizeof(CDC_UartOut[Port]))
+                 ? CDC_UART_OUT_BUF_NUM : 1U;
+  port->OutSize = sizeof(CDC_UartOut[Port]) / port->OutNum;
+
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, CDC_UartOut[Port]);
+  (void)USBD_CDC_GrantCredit(&hUsbDeviceFS, port->OutNum);
+}
+
+/**
+  * @brief  Line coding and break requests of a bridged function
+  * @param  Port CDC function index
+  * @param  cmd: Command code
+  * @param  pbuf: Buffer containing command data (request parameters)
+  * @param  length: Number of data to be sent (in bytes)
+  * @retval USBD_OK, USBD_FAIL for a port that is not bridged
+  */
+int8_t CDC_Uart_Control(uint32_t Port, uint8_t cmd, uint8_t *pbuf, uint16_t length)
+{
+  CDC_Uart_PortTypeDef *port;
+  USBD_CDC_LineCodingTypeDef coding;
+  uint32_t over8;
+
+  if (CDC_Uart_IsBridged(Port) == 0U)
+  {
+    return (int8_t)USBD_FAIL;
+  }
+
+  port = &CDC_UartPorts[Port];
+
+  switch (cmd)
+  {
+    case CDC_SET_LINE_CODING:
+      if (length < 7U)
+      {
+        break;
+      }
+      coding.bitrate = (uint32_t)pbuf[0] | ((uint32_t)pbuf[1] << 8) |
+                       ((uint32_t)pbuf[2] << 16) | ((uint32_t)pbuf[3] << 24);
+      coding.format = pbuf[4];
+      coding.paritytype = pbuf[5];
+      coding.datatype = pbuf[6];
+
+      /* 1, 1.5 or 2 stop bits, no/odd/even parity, 7 or 8 data bits */
+      if ((CDC_Uart_Brr(HAL_RCC_GetSysClockFreq(), coding.bitrate, &over8) == 0U) ||
+          (coding.format > 2U) || (coding.paritytype > 2U) ||
+          ((coding.datatype != 7U) && (coding.datatype != 8U)))
+      {
+        port->Stats.CodingRejected++;
+        break;
+      }
+      port->Coding = coding;
+      port->CodingPending = 1U;
+      SCHED_Signal(CDC_UartTaskId);
+      break;
+
+    case CDC_GET_LINE_CODING:
+      if (length < 7U)
+      {
+        break;
+      }
+      pbuf[0] = (uint8_t)(port->Coding.bitrate);
+      pbuf[1] = (uint8_t)(port->Coding.bitrate >> 8);
+      pbuf[2] = (uint8_t)(port->Coding.bitrate >> 16);
+      pbuf[3] = (uint8_t)(port->Coding.bitrate >> 24);
+      pbuf[4] = port->Coding.format;
+      pbuf[5] = port->Coding.paritytype;
+      pbuf[6] = port->Coding.datatype;
+      break;
+
+    case CDC_SEND_BREAK:
+      /* pbuf is the request; the USART sends one break character */
+      if (((USBD_SetupReqTypedef *)pbuf)->wValue != 0U)
+      {
+        port->pCfg->Instance->RQR = USART_RQR_SBKRQ;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return (int8_t)USBD_OK;
+}
+
+/**
+  * @brief  An OUT transfer landed in the buffer the endpoint was armed on.
+  *         Called from the interface Receive callback, with the function
+  *         selected: the endpoint goes on into the next buffer at once.
+  * @param  Port CDC function index
+  * @param  pBuf received data
+  * @param  Len received length
+  * @retval None
+  */
+void CDC_Uart_Receive(uint32_t Port, uint8_t *pBuf, uint32_t Len)
+{
+  CDC_Uart_PortTypeDef *port = &CDC_UartPorts[Port];
+  uint32_t in = port->OutIn;
+
+  UNUSED(pBuf);
+
+  port->OutLen[in % port->OutNum] = Len;
+  port->OutIn = in + 1U;
+
+  /* With all buffers full the host is out of credits and leaves the
+     endpoint alone until the task frees one and arms it */
+  if ((port->OutIn - port->OutOut) < port->OutNum)
+  {
+    USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &CDC_UartOut[Port][(port->OutIn % port->OutNum) * port->OutSize]);
+    USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+  }
+  else
+  {
+    port->OutWait = 1U;
+  }
+
+  SCHED_Signal(CDC_UartTaskId);
+}
+
+/**
+  * @brief  The IN transfer out of the ring completed. Called from the
+  *         interface TransmitCplt callback.
+  * @param  Port CDC function index
+  * @retval None
+  */
+void CDC_Uart_TxCplt(uint32_t Port)
+{
+  CDC_UartPorts[Port].InDone = 1U;
+  SCHED_Signal(CDC_UartTaskId);
+}
+
+/**
+  * @brief  The class dropped the IN transfer, CDC_TX_ABORTED in the
+  *         interface TransmitCplt callback: its bytes stay in the ring and
+  *         are sent again.
+  * @param  Port CDC function index
+  * @retval None
+  */
+void CDC_Uart_TxAbort(uint32_t Port)
+{
+  CDC_UartPorts[Port].InAborted = 1U;
+  CDC_Uart_TxCplt(Port);
+}
+
+/**
+  * @brief  Bridge task: applies line coding, starts the next TX DMA and the
+  *         next IN transfer of every port. Signalled by the USB and DMA
+  *         interrupts and the idle line; a short period also catches the
+  *         end of the last character before a coding change.
+  * @param  pArg unused
+  * @retval None
+  */
+void CDC_Uart_Task(void *pArg)
+{
+  uint32_t i;
+
+  UNUSED(pArg);
+
+  for (i = 0U; i < CDC_UART_PORT_NUM; i++)
+  {
+    CDC_Uart_ServiceOut(i);
+    CDC_Uart_ServiceIn(i);
+  }
+}
+
+/**
+  * @brief  Snapshot of the counters of a port
+  * @param  Port CDC function index
+  * @param  pStats destination
+  * @retval None
+  */
+void CDC_Uart_GetStats(uint32_t Port, CDC_Uart_StatsTypeDef *pStats)
+{
+  if ((Port < CDC_UART_PORT_NUM) && (pStats != NULL))
+  {
+    *pStats = CDC_UartPorts[Port].Stats;
+  }
+}
+
+/**
+  * @brief  USART interrupt: idle line and receive errors
+  * @param  Port CDC function index
+  * @retval None
+  */
+void CDC_Uart_IRQHandler(uint32_t Port)
+{
+  CDC_Uart_PortTypeDef *port = &CDC_UartPorts[Port];
+  USART_TypeDef *uart = port->pCfg->Instance;
+  uint32_t isr = uart->ISR;
+
+  if ((isr & (USART_ISR_PE | USART_ISR_FE | USART_ISR_NE)) != 0U)
+  {
+    port->Stats.LineErrors++;
+  }
+  if ((isr & USART_ISR_ORE) != 0U)
+  {
+    port->Stats.HwOverruns++;
+  }
+
+  uart->ICR = USART_ICR_IDLECF | USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF | USART_ICR_ORECF;
+
+  SCHED_Signal(CDC_UartTaskId);
+}
+
+/**
+  * @brief  Receive DMA stream interrupt
+  * @param  Port CDC function index
+  * @retval None
+  */
+void CDC_Uart_DmaRxIRQHandler(uint32_t Port)
+{
+  HAL_DMA_IRQHandler(&CDC_UartPorts[Port].hdmaRx);
+}
+
+/**
+  * @brief  Transmit DMA stream interrupt
+  * @param  Port CDC function index
+  * @retval None
+  */
+void CDC_Uart_DmaTxIRQHandler(uint32_t Port)
+{
+  HAL_DMA_IRQHandler(&CDC_UartPorts[Port].hdmaTx);
+}
+
+/**
+  * @brief  Enable the bus clocks of a port and clock the USART from SYSCLK
+  * @param  pCfg port
+  * @retval None
+  */
+static void CDC_Uart_ClockEnable(const CDC_Uart_CfgTypeDef *pCfg)
+{
+  if (pCfg->Instance == USART3)
+  {
+    __HAL_RCC_USART3_CONFIG(RCC_USART3CLKSOURCE_SYSCLK);
+    __HAL_RCC_USART3_CLK_ENABLE();
+    __HAL_RCC_GPIOD_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+  }
+  else
+  {
+    __HAL_RCC_USART6_CONFIG(RCC_USART6CLKSOURCE_SYSCLK);
+    __HAL_RCC_USART6_CLK_ENABLE();
+    __HAL_RCC_GPIOG_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+  }
+}
+
+/**
+  * @brief  Baud rate register for a bit rate: oversampling by 16 while
+  *         USARTDIV fits, by 8 up to fck / CDC_UART_OVERSAMPLING_MIN. Both
+  *         the SET_LINE_CODING check and CDC_Uart_Apply go by this.
+  * @param  Fck USART kernel clock
+  * @param  Bitrate bits per second
+  * @param  pOver8 set to 1 for oversampling by 8
+  * @retval BRR value, 0 for a rate out of reach
+  */
+static uint32_t CDC_Uart_Brr(uint32_t Fck, uint32_t Bitrate, uint32_t *pOver8)
+{
+  uint32_t div;
+
+  *pOver8 = 0U;
+  if (Bitrate == 0U)
+  {
+    return 0U;
+  }
+
+  div = (Fck + (Bitrate / 2U)) / Bitrate;
+  if (div > 0xFFFFU)
+  {
+    return 0U;
+  }
+  if (div < 16U)
+  {
+    /* USARTDIV in half bit times, 16 of them at least */
+    div = ((2U * Fck) + (Bitrate / 2U)) / Bitrate;
+    if (div < (2U * CDC_UART_OVERSAMPLING_MIN))
+    {
+      return 0U;
+    }
+    *pOver8 = 1U;
+    div = (div & 0xFFF0U) | ((div & 0x000FU) >> 1U);
+  }
+
+  return div;
+}
+
+/**
+  * @brief  Program the USART for pPort->Coding, checked by CDC_Uart_Control.
+  *         The transmitter must be idle; reception pauses meanwhile and
+  *         the ring DMA carries on where it was.
+  * @param  pPort port
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef CDC_Uart_Apply(CDC_Uart_PortTypeDef *pPort)
+{
+  USART_TypeDef *uart = pPort->pCfg->Instance;
+  uint32_t fck = HAL_RCC_GetSysClockFreq();
+  uint32_t cr1 = USART_CR1_TE | USART_CR1_RE | USART_CR1_IDLEIE | USART_CR1_PEIE;
+  uint32_t cr2 = 0U;
+  uint32_t over8;
+  uint32_t div;
+
+  div = CDC_Uart_Brr(fck, pPort->Coding.bitrate, &over8);
+  if (div == 0U)
+  {
+    return HAL_ERROR;
+  }
+  if (over8 != 0U)
+  {
+    cr1 |= USART_CR1_OVER8;
+  }
+
+  /* The word length counts the parity bit, which with 7 data bits then
+     arrives in bit 7 of RDR */
+  if (pPort->Coding.paritytype != 0U)
+  {
+    cr1 |= USART_CR1_PCE;
+    if (pPort->Coding.paritytype == 1U)
+    {
+      cr1 |= USART_CR1_PS;
+    }
+    if (pPort->Coding.datatype == 8U)
+    {
+      cr1 |= USART_CR1_M0;
+    }
+  }
+  else if (pPort->Coding.datatype == 7U)
+  {
+    cr1 |= USART_CR1_M1;
+  }
+
+  if (pPort->Coding.format == 1U)
+  {
+    cr2 |= USART_CR2_STOP_0 | USART_CR2_STOP_1;
+  }
+  else if (pPort->Coding.format == 2U)
+  {
+    cr2 |= USART_CR2_STOP_1;
+  }
+
+  CLEAR_BIT(uart->CR1, USART_CR1_UE);
+  uart->CR1 = cr1;
+  uart->CR2 = cr2;
+  uart->CR3 = USART_CR3_DMAR | USART_CR3_DMAT | USART_CR3_EIE;
+  uart->BRR = div;
+  uart->ICR = USART_ICR_IDLECF | USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF | USART_ICR_ORECF;
+  SET_BIT(uart->CR1, USART_CR1_UE);
+
+  pPort->RxMask = (pPort->Coding.datatype == 7U) ? 0x7FU : 0xFFU;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  USB to UART: retire the finished TX DMA, hand its buffer back
+  *         to the host and start the next one
+  * @param  Port CDC function index
+  * @retval None
+  */
+static void CDC_Uart_ServiceOut(uint32_t Port)
+{
+  CDC_Uart_PortTypeDef *port = &CDC_UartPorts[Port];
+  uint32_t pending;
+  uint32_t slot;
+
+  if (port->TxDone != 0U)
+  {
+    port->TxDone = 0U;
+    port->TxBusy = 0U;
+    port->Stats.TxBytes += port->OutLen[port->OutOut % port->OutNum];
+    port->OutOut++;
+
+    if (hUsbDeviceFS.pClassDataCmsit[Port] != NULL)
+    {
+      /* CDC_Uart_Receive found no free buffer: this one is next */
+      if (port->OutWait != 0U)
+      {
+        port->OutWait = 0U;
+        (void)USBD_CDC_ReceiveFunc(&hUsbDeviceFS, (uint8_t)Port,
+                                   &CDC_UartOut[Port][(port->OutIn % port->OutNum) * port->OutSize]);
+      }
+      (void)USBD_CDC_GrantCreditFunc(&hUsbDeviceFS, (uint8_t)Port, 1U);
+    }
+  }
+
+  if (port->TxBusy != 0U)
+  {
+    return;
+  }
+
+  /* A new coding waits for the last character to leave the shifter */
+  if (port->CodingPending != 0U)
+  {
+    if ((port->pCfg->Instance->ISR & USART_ISR_TC) == 0U)
+    {
+      return;
+    }
+    port->CodingPending = 0U;
+    if (CDC_Uart_Apply(port) != HAL_OK)
+    {
+      port->Stats.CodingRejected++;
+    }
+  }
+
+  /* Out of range only if a reset raced the last transfer, drop it then */
+  pending = port->OutIn - port->OutOut;
+  if (pending > port->OutNum)
+  {
+    port->OutOut = port->OutIn;
+    pending = 0U;
+  }
+  if (pending == 0U)
+  {
+    return;
+  }
+
+  slot = port->OutOut % port->OutNum;
+  if (port->OutLen[slot] == 0U)
+  {
+    /* A ZLP carries nothing to send, retire it right away */
+    port->TxBusy = 1U;
+    port->TxDone = 1U;
+    SCHED_Signal(CDC_UartTaskId);
+    return;
+  }
+
+  port->TxBusy = 1U;
+  port->pCfg->Instance->ICR = USART_ICR_TCCF;
+  if (HAL_DMA_Start_IT(&port->hdmaTx, (uint32_t)&CDC_UartOut[Port][slot * port->OutSize],
+                       (uint32_t)&port->pCfg->Instance->TDR, port->OutLen[slot]) != HAL_OK)
+  {
+    port->TxBusy = 0U;
+    port->Stats.DmaErrors++;
+  }
+}
+
+/**
+  * @brief  UART to USB: account the finished IN transfer and hand the next
+  *         contiguous part of the ring to the endpoint
+  * @param  Port CDC function index
+  * @retval None
+  */
+static void CDC_Uart_ServiceIn(uint32_t Port)
+{
+  CDC_Uart_PortTypeDef *port = &CDC_UartPorts[Port];
+  uint32_t laps;
+  uint32_t head;
+  uint32_t offset;
+  uint32_t len;
+  uint32_t i;
+
+  if (port->InDone != 0U)
+  {
+    port->InDone = 0U;
+    if (port->InAborted == 0U)
+    {
+      port->RxTail += port->InFlight;
+      port->Stats.RxBytes += port->InFlight;
+    }
+    port->InAborted = 0U;
+    port->InFlight = 0U;
+  }
+
+  /* Write position: a wrap whose interrupt is still pending shows as a
+     step back and is counted here */
+  do
+  {
+    laps = port->RxLaps;
+    head = (laps * CDC_UART_RX_RING_SIZE) +
+           (CDC_UART_RX_RING_SIZE - __HAL_DMA_GET_COUNTER(&port->hdmaRx));
+  } while (laps != port->RxLaps);
+  if ((int32_t)(head - port->RxHead) < 0)
+  {
+    head += CDC_UART_RX_RING_SIZE;
+  }
+  port->RxHead = head;
+
+  if (port->InFlight != 0U)
+  {
+    return;
+  }
+
+  /* What was left of the lap before a restart is stale */
+  if (port->RxResync != 0U)
+  {
+    port->RxResync = 0U;
+    port->RxTail = head;
+  }
+
+  /* The DMA lapped the host: what it overwrote is gone */
+  if ((head - port->RxTail) > CDC_UART_RX_RING_SIZE)
+  {
+    port->Stats.RxOverruns += (head - port->RxTail) - CDC_UART_RX_RING_SIZE;
+    port->RxTail = head - CDC_UART_RX_RING_SIZE;
+  }
+
+  len = head - port->RxTail;
+  if (len == 0U)
+  {
+    return;
+  }
+
+  offset = port->RxTail & (CDC_UART_RX_RING_SIZE - 1U);
+  if (len > (CDC_UART_RX_RING_SIZE - offset))
+  {
+    len = CDC_UART_RX_RING_SIZE - offset;
+  }
+  if (len > CDC_UART_RX_XFER_MAX)
+  {
+    len = CDC_UART_RX_XFER_MAX;
+  }
+
+  /* 7 data bits: the host gets them without the parity bit above */
+  if (port->RxMask != 0xFFU)
+  {
+    for (i = 0U; i < len; i++)
+    {
+      CDC_UartRing[Port][offset + i] &= port->RxMask;
+    }
+  }
+
+  /* Not configured or endpoint busy: the next signal tries again */
+  if (USBD_CDC_TransmitFunc(&hUsbDeviceFS, (uint8_t)Port, &CDC_UartRing[Port][offset], len) == USBD_OK)
+  {
+    port->InFlight = len;
+  }
+}
+
+/**
+  * @brief  Full ring: one more lap, flush
+  * @param  hdma receive DMA handle
+  * @retval None
+  */
+static void CDC_Uart_DmaRxCplt(DMA_HandleTypeDef *hdma)
+{
+  ((CDC_Uart_PortTypeDef *)hdma->Parent)->RxLaps++;
+  SCHED_Signal(CDC_UartTaskId);
+}
+
+/**
+  * @brief  An OUT buffer is on the line
+  * @param  hdma transmit DMA handle
+  * @retval None
+  */
+static void CDC_Uart_DmaTxCplt(DMA_HandleTypeDef *hdma)
+{
+  ((CDC_Uart_PortTypeDef *)hdma->Parent)->TxDone = 1U;
+  SCHED_Signal(CDC_UartTaskId);
+}
+
+/**
+  * @brief  Receive DMA error: the stream stopped, restart the ring from the
+  *         start of a new lap; the task drops what the host has not read
+  * @param  hdma receive DMA handle
+  * @retval None
+  */
+static void CDC_Uart_DmaRxError(DMA_HandleTypeDef *hdma)
+{
+  CDC_Uart_PortTypeDef *port = (CDC_Uart_PortTypeDef *)hdma->Parent;
+  uint32_t index = (uint32_t)(port - CDC_UartPorts);
+
+  port->Stats.DmaErrors++;
+  port->RxLaps++;
+  port->RxResync = 1U;
+  (void)HAL_DMA_Start_IT(hdma, (uint32_t)&port->pCfg->Instance->RDR, (uint32_t)CDC_UartRing[index],
+                         CDC_UART_RX_RING_SIZE);
+  SCHED_Signal(CDC_UartTaskId);
+}
+
+/**
+  * @brief  Transmit DMA error: drop the buffer, it goes back to the host
+  * @param  hdma transmit DMA handle
+  * @retval None
+  */
+static void CDC_Uart_DmaTxError(DMA_HandleTypeDef *hdma)
+{
+  CDC_Uart_PortTypeDef *port = (CDC_Uart_PortTypeDef *)hdma->Parent;
+
+  port->Stats.DmaErrors++;
+  port->TxDone = 1U;
+  SCHED_Signal(CDC_UartTaskId);
+}
+
+/**
+  * @brief  Half ring: flush
+  * @param  hdma receive DMA handle
+  * @retval None
+  */
+static void CDC_Uart_Signal(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  SCHED_Signal(CDC_UartTaskId);
+}
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_uart.h
+  * @brief          : Header for usbd_cdc_uart.c file.
+  *                   CDC to USART bridge, DMA in both directions.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_UART_H
+#define __USBD_CDC_UART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_if.h"
+#include "sched.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* One port per CDC function: USART3 (ST-LINK VCP) on the first, USART6 on the second */
+#define CDC_UART_PORT_NUM         USBD_CDC_FUNC_NUM
+
+#define CDC_UART_RX_RING_SIZE     2048U       /* UART to USB circular DMA ring, power of two */
+#define CDC_UART_RX_XFER_MAX      512U        /* largest IN transfer taken out of the ring */
+#define CDC_UART_OUT_BUF_NUM      2U          /* OUT transfers held per port, each free one a credit */
+#define CDC_UART_OUT_BUF_SIZE     1024U
+
+#define CDC_UART_DEFAULT_BAUD     115200U
+#define CDC_UART_OVERSAMPLING_MIN 8U          /* fastest rate is the kernel clock / 8 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t RxBytes;        /* UART to USB */
+  uint32_t TxBytes;        /* USB to UART */
+  uint32_t RxOverruns;     /* bytes the ring lost before the host read them */
+  uint32_t HwOverruns;     /* USART overrun flags, the DMA fell behind */
+  uint32_t LineErrors;     /* parity, framing and noise errors */
+  uint32_t DmaErrors;
+  uint32_t CodingRejected; /* SET_LINE_CODING values the port cannot do */
+} CDC_Uart_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CDC_Uart_Init(uint32_t TaskId);
+void CDC_Uart_Task(void *pArg);
+uint8_t CDC_Uart_IsBridged(uint32_t Port);
+void CDC_Uart_Start(uint32_t Port);
+int8_t CDC_Uart_Control(uint32_t Port, uint8_t cmd, uint8_t *pbuf, uint16_t length);
+void CDC_Uart_Receive(uint32_t Port, uint8_t *pBuf, uint32_t Len);
+void CDC_Uart_TxCplt(uint32_t Port);
+void CDC_Uart_TxAbort(uint32_t Port);
+void CDC_Uart_GetStats(uint32_t Port, CDC_Uart_StatsTypeDef *pStats);
+
+void CDC_Uart_IRQHandler(uint32_t Port);
+void CDC_Uart_DmaRxIRQHandler(uint32_t Port);
+void CDC_Uart_DmaTxIRQHandler(uint32_t Port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_UART_H */
@@ -197,8 +197,8 @@ __ALIGN_BEGIN uint8_t USBD_FS_BOSDesc[USB_SIZ_BOS_DESC] __ALIGN_END =
   0x7,
   USB_DEVICE_CAPABITY_TYPE,
   0x2,
-  0x2,  /* LPM capability bit set*/
-  0x0,
+  0x0E, /* LPM, BESL and baseline BESL valid */
+  (uint8_t)(USBD_LPM_BESL_BASELINE & 0xFU), /* baseline BESL, deep BESL not given */
   0x0,
   0x0
 };
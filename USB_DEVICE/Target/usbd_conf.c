@@ -25,7 +25,8 @@
 #include "usbd_core.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "irqprio.h"
+#include "clkgov.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -34,6 +35,9 @@
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
+#if (USBD_MAX_EP_NUM > PCD_MAX_EP_NUM)
+#error "USBD_MAX_EP_NUM: endpoints past PCD_MAX_EP_NUM have no PCD state"
+#endif /* USBD_MAX_EP_NUM */
 
 /* USER CODE END PV */
 
@@ -44,6 +48,21 @@ void Error_Handler(void);
 void SystemClock_Config(void);
 
 /* USER CODE BEGIN 0 */
+#if (USBD_LPM_ENABLED == 1U)
+/* Written from the USB interrupt only, bracketed by Seq */
+static USBD_LPM_StatsTypeDef USBD_LPM_Stats;
+
+#define LPM_STATS_BEGIN()  USBD_SEQ_BEGIN(USBD_LPM_Stats.Seq)
+#define LPM_STATS_END()    USBD_SEQ_END(USBD_LPM_Stats.Seq)
+#endif /* USBD_LPM_ENABLED */
+
+/* L1 entered STOP, the clocks must be restored on exit */
+static uint8_t USBD_LPM_Stop;
+
+/* Suspend time, and start of the resume signalling while it is driven */
+static uint32_t USBD_SuspendTick;
+static uint32_t USBD_WakeupTick;
+static __IO uint8_t USBD_WakeupActive;
 
 /* USER CODE END 0 */
 
@@ -99,8 +118,10 @@ void HAL_PCD_MspInit(PCD_HandleTypeDef* pcdHandle)
     __HAL_RCC_USB_OTG_FS_CLK_ENABLE();
 
     /* Peripheral interrupt init */
-    HAL_NVIC_SetPriority(OTG_FS_IRQn, 0, 0);
+    HAL_NVIC_SetPriority(OTG_FS_IRQn, IRQPRIO_USB, 0);
+#if (USBD_POLLING_MODE == 0U)
     HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+#endif /* USBD_POLLING_MODE */
   /* USER CODE BEGIN USB_OTG_FS_MspInit 1 */
 
   /* USER CODE END USB_OTG_FS_MspInit 1 */
@@ -158,6 +179,21 @@ static void PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+#if (USBD_DIRECT_DISPATCH == 1U)
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+  uint32_t classid;
+
+  /* Bound at SetConfiguration: straight to the class handler */
+  if ((epnum < USBD_MAX_EP_NUM) && (pdev->ep_out[epnum].pDataFunc != NULL))
+  {
+    classid = pdev->classId;
+    pdev->classId = pdev->ep_out[epnum].classId;
+    (void)pdev->ep_out[epnum].pDataFunc(pdev, epnum);
+    pdev->classId = classid;
+    return;
+  }
+#endif /* USBD_DIRECT_DISPATCH */
+
   USBD_LL_DataOutStage((USBD_HandleTypeDef*)hpcd->pData, epnum, hpcd->OUT_ep[epnum].xfer_buff);
 }
 
@@ -173,6 +209,20 @@ static void PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+#if (USBD_DIRECT_DISPATCH == 1U)
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+  uint32_t classid;
+
+  if ((epnum < USBD_MAX_EP_NUM) && (pdev->ep_in[epnum].pDataFunc != NULL))
+  {
+    classid = pdev->classId;
+    pdev->classId = pdev->ep_in[epnum].classId;
+    (void)pdev->ep_in[epnum].pDataFunc(pdev, epnum);
+    pdev->classId = classid;
+    return;
+  }
+#endif /* USBD_DIRECT_DISPATCH */
+
   USBD_LL_DataInStage((USBD_HandleTypeDef*)hpcd->pData, epnum, hpcd->IN_ep[epnum].xfer_buff);
 }
 
@@ -239,6 +289,7 @@ void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
   __HAL_PCD_GATE_PHYCLOCK(hpcd);
   /* Enter in STOP mode. */
   /* USER CODE BEGIN 2 */
+  USBD_SuspendTick = HAL_GetTick();
   if (hpcd->Init.low_power_enable)
   {
     /* Set SLEEPDEEP bit and SleepOnExit of Cortex System Control Register. */
@@ -260,7 +311,9 @@ void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
   /* USER CODE BEGIN 3 */
-
+  /* Gated on suspend, and the host may resume before our signalling ends */
+  __HAL_PCD_UNGATE_PHYCLOCK(hpcd);
+  USBD_WakeupActive = 0U;
   /* USER CODE END 3 */
   USBD_LL_Resume((USBD_HandleTypeDef*)hpcd->pData);
 }
@@ -347,7 +400,12 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   hpcd_USB_OTG_FS.Init.phy_itface = PCD_PHY_EMBEDDED;
   hpcd_USB_OTG_FS.Init.Sof_enable = DISABLE;
   hpcd_USB_OTG_FS.Init.low_power_enable = DISABLE;
+#if (USBD_LPM_ENABLED == 1U)
+  /* HAL_PCD_Init then unmasks the LPM interrupt and ACKs L1 tokens */
+  hpcd_USB_OTG_FS.Init.lpm_enable = ENABLE;
+#else
   hpcd_USB_OTG_FS.Init.lpm_enable = DISABLE;
+#endif /* USBD_LPM_ENABLED */
   hpcd_USB_OTG_FS.Init.vbus_sensing_enable = DISABLE;
   hpcd_USB_OTG_FS.Init.use_dedicated_ep1 = DISABLE;
   if (HAL_PCD_Init(&hpcd_USB_OTG_FS) != HAL_OK)
@@ -370,9 +428,17 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   HAL_PCD_RegisterIsoOutIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOOUTIncompleteCallback);
   HAL_PCD_RegisterIsoInIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOINIncompleteCallback);
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
-  HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, 0x80);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, 0x40);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, 0x80);
+  HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, USBD_FS_RX_FIFO_SIZE);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, USBD_FS_TX0_FIFO_SIZE);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, USBD_FS_TX1_FIFO_SIZE);
+#if (USBD_FS_TX3_FIFO_SIZE > 0U)
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 2, 0U);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 3, USBD_FS_TX3_FIFO_SIZE);
+#endif /* USBD_FS_TX3_FIFO_SIZE */
+  /* Pre-fill the EP1 FIFO (0x80 words = 8 packets) as soon as a transfer
+     starts instead of on the first TXFE interrupt. The half empty level is
+     the GAHBCFG.TXFELVL reset value, written here only to make it explicit. */
+  HAL_PCDEx_ConfigTxFiFoRefill(&hpcd_USB_OTG_FS, PCD_TXFIFO_EMPTY_LVL_HALF, ENABLE);
   }
   return USBD_OK;
 }
@@ -466,6 +532,97 @@ USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   return usb_status;
 }
 
+/**
+  * @brief  Re-partitions the packet RAM between the Rx FIFO and the Tx FIFOs.
+  * @note   Only call while no transfer is in progress, e.g. on SetConfiguration.
+  *         The EP3 Tx FIFO keeps its fixed USBD_FS_TX3_FIFO_SIZE share.
+  * @param  pdev: Device handle
+  * @param  rx_size: Rx FIFO depth in 32-bit words
+  * @param  tx0_size: EP0 Tx FIFO depth in 32-bit words
+  * @param  tx1_size: EP1 Tx FIFO depth in 32-bit words
+  * @param  tx2_size: EP2 Tx FIFO depth in 32-bit words, 0 if EP2 IN is unused
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_SetFifoLayout(USBD_HandleTypeDef *pdev, uint16_t rx_size, uint16_t tx0_size, uint16_t tx1_size,
+                                         uint16_t tx2_size)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+
+  if ((rx_size < USBD_FS_RX_FIFO_MIN_SIZE) || (tx0_size < USBD_FS_TX0_FIFO_MIN_SIZE) ||
+      (tx1_size < USBD_FS_TX_FIFO_MIN_SIZE) ||
+      (((uint32_t)rx_size + tx0_size + tx1_size + tx2_size + USBD_FS_TX3_FIFO_SIZE) > USBD_FS_FIFO_TOTAL_SIZE))
+  {
+    return USBD_FAIL;
+  }
+
+  (void)USB_FlushTxFifo(hpcd->Instance, 0x10U);
+  (void)USB_FlushRxFifo(hpcd->Instance);
+
+  HAL_PCDEx_SetRxFiFo(hpcd, rx_size);
+  HAL_PCDEx_SetTxFiFo(hpcd, 0, tx0_size);
+  HAL_PCDEx_SetTxFiFo(hpcd, 1, tx1_size);
+  HAL_PCDEx_SetTxFiFo(hpcd, 2, tx2_size);
+#if (USBD_FS_TX3_FIFO_SIZE > 0U)
+  /* Placed after TX2, so it moves whenever the FIFOs below it change */
+  HAL_PCDEx_SetTxFiFo(hpcd, 3, USBD_FS_TX3_FIFO_SIZE);
+#endif /* USBD_FS_TX3_FIFO_SIZE */
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  Services the USB events pending in the core, see USBD_POLLING_MODE.
+  * @note   Class callbacks then run in the caller's context, not in the
+  *         OTG interrupt.
+  * @param  pdev: Device handle
+  * @param  max_passes: Upper bound on handler passes for this call
+  * @retval Number of passes that found work, 0 when the core was idle
+  */
+uint32_t USBD_LL_Poll(USBD_HandleTypeDef *pdev, uint32_t max_passes)
+{
+  USBD_LL_TrafficBoost(pdev->pData);
+
+  return HAL_PCDEx_Poll(pdev->pData, max_passes);
+}
+
+/**
+  * @brief  Asks the clock governor for full speed on the first sign of host
+  *         traffic, a packet in the Rx FIFO or an IN endpoint event, so the
+  *         ramp up overlaps the transfer instead of following its callback.
+  * @note   Call from the OTG interrupt or the poll loop, before the PCD
+  *         handler reads the events out.
+  * @param  hpcd: PCD handle
+  * @retval None
+  */
+void USBD_LL_TrafficBoost(PCD_HandleTypeDef *hpcd)
+{
+  if ((USB_ReadInterrupts(hpcd->Instance) & (USB_OTG_GINTSTS_RXFLVL | USB_OTG_GINTSTS_IEPINT)) != 0U)
+  {
+    CLKGOV_Boost();
+  }
+}
+
+/**
+  * @brief  Selects when the Tx FIFOs are refilled.
+  * @param  pdev: Device handle
+  * @param  empty_level: 0 to refill at half empty, 1 when completely empty
+  * @param  prefill: 1 to queue packets as soon as a transfer starts
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_SetTxFifoRefill(USBD_HandleTypeDef *pdev, uint8_t empty_level, uint8_t prefill)
+{
+  HAL_StatusTypeDef hal_status = HAL_OK;
+  USBD_StatusTypeDef usb_status = USBD_OK;
+
+  hal_status = HAL_PCDEx_ConfigTxFiFoRefill(pdev->pData,
+                                            (empty_level != 0U) ? PCD_TXFIFO_EMPTY_LVL_COMPLETE : PCD_TXFIFO_EMPTY_LVL_HALF,
+                                            (prefill != 0U) ? ENABLE : DISABLE);
+
+  usb_status =  USBD_Get_USB_Status(hal_status);
+
+  return usb_status;
+}
+
 /**
   * @brief  Flushes an endpoint of the Low Level Driver.
   * @param  pdev: Device handle
@@ -484,6 +641,24 @@ USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   return usb_status;
 }
 
+/**
+  * @brief  Aborts the transfer in progress on an endpoint of the Low Level Driver.
+  * @param  pdev: Device handle
+  * @param  ep_addr: Endpoint number
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_AbortEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  HAL_StatusTypeDef hal_status = HAL_OK;
+  USBD_StatusTypeDef usb_status = USBD_OK;
+
+  hal_status = HAL_PCD_EP_Abort(pdev->pData, ep_addr);
+
+  usb_status =  USBD_Get_USB_Status(hal_status);
+
+  return usb_status;
+}
+
 /**
   * @brief  Sets a Stall condition on an endpoint of the Low Level Driver.
   * @param  pdev: Device handle
@@ -530,13 +705,18 @@ uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
 {
   PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef*) pdev->pData;
 
+  if((ep_addr & 0x0FU) >= PCD_MAX_EP_NUM)
+  {
+    return 0U;
+  }
+
   if((ep_addr & 0x80) == 0x80)
   {
-    return hpcd->IN_ep[ep_addr & 0x7F].is_stall;
+    return hpcd->IN_ep[ep_addr & 0x0FU].is_stall;
   }
   else
   {
-    return hpcd->OUT_ep[ep_addr & 0x7F].is_stall;
+    return hpcd->OUT_ep[ep_addr & 0x0FU].is_stall;
   }
 }
 
@@ -578,6 +758,26 @@ USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, u
   return usb_status;
 }
 
+/**
+  * @brief  Transmits a list of buffers over an endpoint as one transfer.
+  * @param  pdev: Device handle
+  * @param  ep_addr: Endpoint number
+  * @param  pSeg: Pointer to the segment list
+  * @param  SegNum: Number of segments
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_TransmitSeg(USBD_HandleTypeDef *pdev, uint8_t ep_addr, const USBD_SegTypeDef *pSeg, uint32_t SegNum)
+{
+  HAL_StatusTypeDef hal_status = HAL_OK;
+  USBD_StatusTypeDef usb_status = USBD_OK;
+
+  hal_status = HAL_PCD_EP_TransmitSeg(pdev->pData, ep_addr, (const PCD_SegTypeDef *)pSeg, SegNum);
+
+  usb_status =  USBD_Get_USB_Status(hal_status);
+
+  return usb_status;
+}
+
 /**
   * @brief  Prepares an endpoint for reception.
   * @param  pdev: Device handle
@@ -598,6 +798,29 @@ USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_a
   return usb_status;
 }
 
+/**
+  * @brief  Prepares an endpoint for reception into a header and a payload buffer.
+  * @param  pdev: Device handle
+  * @param  ep_addr: Endpoint number
+  * @param  phdr: Pointer to the header buffer
+  * @param  hdr_size: Header size
+  * @param  pbuf: Pointer to the payload buffer
+  * @param  size: Payload size
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_PrepareReceiveSplit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *phdr, uint32_t hdr_size,
+                                               uint8_t *pbuf, uint32_t size)
+{
+  HAL_StatusTypeDef hal_status = HAL_OK;
+  USBD_StatusTypeDef usb_status = USBD_OK;
+
+  hal_status = HAL_PCD_EP_ReceiveSplit(pdev->pData, ep_addr, phdr, hdr_size, pbuf, size);
+
+  usb_status =  USBD_Get_USB_Status(hal_status);
+
+  return usb_status;
+}
+
 /**
   * @brief  Returns the last transferred packet size.
   * @param  pdev: Device handle
@@ -617,11 +840,17 @@ uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   */
 void HAL_PCDEx_LPM_Callback(PCD_HandleTypeDef *hpcd, PCD_LPM_MsgTypeDef msg)
 {
+#if (USBD_LPM_ENABLED == 1U)
+  uint32_t start = DWT->CYCCNT;
+  uint32_t cycles;
+#endif /* USBD_LPM_ENABLED */
+
   switch (msg)
   {
   case PCD_LPM_L0_ACTIVE:
-    if (hpcd->Init.low_power_enable)
+    if (USBD_LPM_Stop != 0U)
     {
+      USBD_LPM_Stop = 0U;
       SystemClockConfig_Resume();
 
       /* Reset SLEEPDEEP bit of Cortex System Control Register. */
@@ -629,22 +858,154 @@ void HAL_PCDEx_LPM_Callback(PCD_HandleTypeDef *hpcd, PCD_LPM_MsgTypeDef msg)
     }
     __HAL_PCD_UNGATE_PHYCLOCK(hpcd);
     USBD_LL_Resume(hpcd->pData);
+
+#if (USBD_LPM_ENABLED == 1U)
+    /* The callback only: the wakeup before it is not seen by the DWT, so
+       this is a lower bound of the exit latency the BESL has to cover */
+    cycles = DWT->CYCCNT - start;
+
+    LPM_STATS_BEGIN();
+    USBD_LPM_Stats.L1Exits++;
+    USBD_LPM_Stats.ResumeCbCycles = cycles;
+    if (cycles > USBD_LPM_Stats.ResumeCbCyclesMax)
+    {
+      USBD_LPM_Stats.ResumeCbCyclesMax = cycles;
+    }
+    LPM_STATS_END();
+#endif /* USBD_LPM_ENABLED */
     break;
 
   case PCD_LPM_L1_ACTIVE:
     __HAL_PCD_GATE_PHYCLOCK(hpcd);
     USBD_LL_Suspend(hpcd->pData);
 
-    /* Enter in STOP mode. */
-    if (hpcd->Init.low_power_enable)
+    /* Only enter STOP when the host allows enough time to restart the PLL,
+       otherwise stay in Sleep so the exit takes microseconds */
+    if ((hpcd->Init.low_power_enable) && (hpcd->BESL >= USBD_LPM_STOP_MIN_BESL))
     {
+      USBD_LPM_Stop = 1U;
       /* Set SLEEPDEEP bit and SleepOnExit of Cortex System Control Register. */
       SCB->SCR |= (uint32_t)((uint32_t)(SCB_SCR_SLEEPDEEP_Msk | SCB_SCR_SLEEPONEXIT_Msk));
     }
+
+#if (USBD_LPM_ENABLED == 1U)
+    cycles = DWT->CYCCNT - start;
+
+    LPM_STATS_BEGIN();
+    USBD_LPM_Stats.L1Entries++;
+    USBD_LPM_Stats.StopEntries += USBD_LPM_Stop;
+    USBD_LPM_Stats.Besl = hpcd->BESL;
+    USBD_LPM_Stats.SuspendCbCycles = cycles;
+    if (cycles > USBD_LPM_Stats.SuspendCbCyclesMax)
+    {
+      USBD_LPM_Stats.SuspendCbCyclesMax = cycles;
+    }
+    LPM_STATS_END();
+#endif /* USBD_LPM_ENABLED */
     break;
   }
 }
 
+/**
+  * @brief  Take a consistent copy of the LPM L1 accounting.
+  * @note   Cycle counts need the DWT cycle counter running, see
+  *         App_CycleCounterInit in main.c.
+  * @param  pdev: Device handle
+  * @param  pStats: destination, all zero when LPM is not enabled
+  * @retval None
+  */
+void USBD_LL_GetLpmStats(USBD_HandleTypeDef *pdev, USBD_LPM_StatsTypeDef *pStats)
+{
+  UNUSED(pdev);
+
+#if (USBD_LPM_ENABLED == 1U)
+  (void)USBD_SeqRead(&USBD_LPM_Stats.Seq, pStats, &USBD_LPM_Stats, sizeof(USBD_LPM_StatsTypeDef));
+#else
+  (void)memset(pStats, 0, sizeof(*pStats));
+#endif /* USBD_LPM_ENABLED */
+}
+
+/**
+  * @brief  Wake a host that suspended the link, L1 or suspend alike.
+  * @note   From suspend the resume signalling lasts USBD_REMOTE_WAKEUP_SIGNAL_MS
+  *         and is ended by USBD_LL_RemoteWakeupPending, which must be called
+  *         until it returns 0. From L1 the core ends it by itself after 50 us.
+  * @param  pdev: Device handle
+  * @retval USBD_OK when signalling started or the link is up, USBD_BUSY when
+  *         the bus has not been idle long enough yet, USBD_FAIL when the
+  *         host did not enable remote wakeup
+  */
+USBD_StatusTypeDef USBD_LL_RemoteWakeup(USBD_HandleTypeDef *pdev)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+  USB_OTG_DeviceTypeDef *dev = (USB_OTG_DeviceTypeDef *)((uint32_t)hpcd->Instance + USB_OTG_DEVICE_BASE);
+
+#if (USBD_REMOTE_WAKEUP_ENABLED == 1U)
+  if (hpcd->LPM_State == LPM_L1)
+  {
+    /* bRemoteWake of the LPM token that put the link in L1 */
+    if ((hpcd->Instance->GLPMCFG & USB_OTG_GLPMCFG_REMWAKE) == 0U)
+    {
+      return USBD_FAIL;
+    }
+    __HAL_PCD_UNGATE_PHYCLOCK(hpcd);
+    dev->DCTL |= USB_OTG_DCTL_RWUSIG;
+    return USBD_OK;
+  }
+
+  if (pdev->dev_state != USBD_STATE_SUSPENDED)
+  {
+    return USBD_OK;
+  }
+
+  if (pdev->dev_remote_wakeup == 0U)
+  {
+    return USBD_FAIL;
+  }
+
+  if ((USBD_WakeupActive != 0U) || ((HAL_GetTick() - USBD_SuspendTick) < USBD_REMOTE_WAKEUP_IDLE_MS))
+  {
+    return USBD_BUSY;
+  }
+
+  __HAL_PCD_UNGATE_PHYCLOCK(hpcd);
+  USBD_WakeupTick = HAL_GetTick();
+  USBD_WakeupActive = 1U;
+
+  return USBD_Get_USB_Status(HAL_PCD_ActivateRemoteWakeup(hpcd));
+#else
+  UNUSED(hpcd);
+  UNUSED(dev);
+  return USBD_FAIL;
+#endif /* USBD_REMOTE_WAKEUP_ENABLED */
+}
+
+/**
+  * @brief  End the resume signalling started by USBD_LL_RemoteWakeup once it
+  *         has lasted long enough.
+  * @param  pdev: Device handle
+  * @retval 1 while still signalling
+  */
+uint32_t USBD_LL_RemoteWakeupPending(USBD_HandleTypeDef *pdev)
+{
+  if (USBD_WakeupActive == 0U)
+  {
+    return 0U;
+  }
+
+  if ((HAL_GetTick() - USBD_WakeupTick) < USBD_REMOTE_WAKEUP_SIGNAL_MS)
+  {
+    return 1U;
+  }
+
+  (void)HAL_PCD_DeActivateRemoteWakeup((PCD_HandleTypeDef *)pdev->pData);
+  USBD_WakeupActive = 0U;
+  /* Not resumed by the host: the bus is idle again from now on */
+  USBD_SuspendTick = HAL_GetTick();
+
+  return 0U;
+}
+
 /**
   * @brief  Delays routine for the USB device library.
   * @param  Delay: Delay in ms
@@ -664,6 +1025,8 @@ void USBD_LL_Delay(uint32_t Delay)
 static void SystemClockConfig_Resume(void)
 {
   SystemClock_Config();
+  /* Back at full speed whatever level the governor had set */
+  CLKGOV_Resync();
 }
 /* USER CODE END 5 */
 /**
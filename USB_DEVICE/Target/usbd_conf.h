@@ -61,18 +61,65 @@
   * @{
   */
 
+/*---------- Bulk functions of the CDC class, 2 builds a two-function device -----------*/
+#define USBD_CDC_FUNC_NUM     1U
 /*---------- -----------*/
-#define USBD_MAX_NUM_INTERFACES     1U
+#define USBD_MAX_SUPPORTED_CLASS     USBD_CDC_FUNC_NUM
+/*---------- -----------*/
+#define USBD_MAX_NUM_INTERFACES     USBD_CDC_FUNC_NUM
 /*---------- -----------*/
 #define USBD_MAX_NUM_CONFIGURATION     1U
+/*---------- Endpoints with state in the device handle, EP0 included: EP3 is the second function -----------*/
+#define USBD_MAX_EP_NUM     ((USBD_CDC_FUNC_NUM > 1U) ? 4U : 3U)
 /*---------- -----------*/
 #define USBD_MAX_STR_DESC_SIZ     512U
 /*---------- -----------*/
 #define USBD_DEBUG_LEVEL     0U
 /*---------- -----------*/
 #define USBD_LPM_ENABLED     1U
+/*---------- Baseline BESL reported in the BOS LPM capability, 0 (125 us) to 15 -----------*/
+#define USBD_LPM_BESL_BASELINE     1U
+/*---------- Smallest BESL for which L1 may enter STOP when low_power_enable is set -----------*/
+#define USBD_LPM_STOP_MIN_BESL     8U
 /*---------- -----------*/
 #define USBD_SELF_POWERED     1U
+/*---------- 1: remote wakeup advertised, see USBD_LL_RemoteWakeup -----------*/
+#define USBD_REMOTE_WAKEUP_ENABLED     1U
+/*---------- Bus idle after suspend before remote wakeup may be signalled, ms -----------*/
+#define USBD_REMOTE_WAKEUP_IDLE_MS     3U
+/*---------- Resume signalling time from suspend, 1 to 15 ms -----------*/
+#define USBD_REMOTE_WAKEUP_SIGNAL_MS     5U
+/*---------- 1: OTG IRQ left disabled, the main loop calls USBD_LL_Poll -----------*/
+#define USBD_POLLING_MODE     0U
+/*---------- 1: bulk/interrupt completions go straight to the handler the class bound -----------*/
+#define USBD_DIRECT_DISPATCH     1U
+/*---------- Handler passes per USBD_LL_Poll call -----------*/
+#define USBD_POLL_MAX_PASSES     8U
+/*---------- FIFO split at power-up, in 32-bit words -----------*/
+#define USBD_FS_RX_FIFO_SIZE     0x80U
+#if (USBD_CDC_FUNC_NUM > 1U)
+/*---------- -----------*/
+#define USBD_FS_TX0_FIFO_SIZE     0x20U
+/*---------- -----------*/
+#define USBD_FS_TX1_FIFO_SIZE     0x60U
+/*---------- EP3 IN of the second function, kept out of every re-partition -----------*/
+#define USBD_FS_TX3_FIFO_SIZE     0x30U
+#else
+/*---------- -----------*/
+#define USBD_FS_TX0_FIFO_SIZE     0x40U
+/*---------- -----------*/
+#define USBD_FS_TX1_FIFO_SIZE     0x80U
+/*---------- -----------*/
+#define USBD_FS_TX3_FIFO_SIZE     0x00U
+#endif /* USBD_CDC_FUNC_NUM */
+/*---------- 1.25 Kbytes of OTG_FS packet RAM -----------*/
+#define USBD_FS_FIFO_TOTAL_SIZE     0x140U
+/*---------- Smallest Rx FIFO: a SETUP plus two max-size packets -----------*/
+#define USBD_FS_RX_FIFO_MIN_SIZE     0x30U
+/*---------- Smallest EP0 Tx FIFO: one control packet -----------*/
+#define USBD_FS_TX0_FIFO_MIN_SIZE     0x10U
+/*---------- Smallest data Tx FIFO: two 16 B packets, so a half-empty FIFO always has room for the next one -----------*/
+#define USBD_FS_TX_FIFO_MIN_SIZE     0x08U
 
 /****************************************/
 /* #define for FS and HS identification */
@@ -150,6 +197,7 @@
   */
 
 /* Exported functions -------------------------------------------------------*/
+void USBD_LL_TrafficBoost(PCD_HandleTypeDef *hpcd);
 
 /**
   * @}